@@ -0,0 +1,62 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 texCoord;
+layout(location = 3) in float texIndex;
+
+out vec4 v_Color;
+out vec2 v_TexCoord;
+flat out int v_TexIndex;
+
+layout(std140) uniform Camera
+{
+    mat4 u_ViewProjection;
+};
+
+void main()
+{
+   gl_Position = u_ViewProjection * vec4(position, 1.0);
+   v_Color = color;
+   v_TexCoord = texCoord;
+   v_TexIndex = int(texIndex);
+};
+
+#shader fragment
+#version 330 core
+
+layout(location = 0) out vec4 color;
+
+in vec4 v_Color;
+in vec2 v_TexCoord;
+flat in int v_TexIndex;
+
+// Must match BatchRenderer2D::MaxTextureSlots
+uniform sampler2D u_Textures[16];
+
+void main()
+{
+    // GLSL 3.30 only allows constant indices into sampler arrays
+    vec4 texColor;
+    switch (v_TexIndex)
+    {
+        case  0: texColor = texture(u_Textures[ 0], v_TexCoord); break;
+        case  1: texColor = texture(u_Textures[ 1], v_TexCoord); break;
+        case  2: texColor = texture(u_Textures[ 2], v_TexCoord); break;
+        case  3: texColor = texture(u_Textures[ 3], v_TexCoord); break;
+        case  4: texColor = texture(u_Textures[ 4], v_TexCoord); break;
+        case  5: texColor = texture(u_Textures[ 5], v_TexCoord); break;
+        case  6: texColor = texture(u_Textures[ 6], v_TexCoord); break;
+        case  7: texColor = texture(u_Textures[ 7], v_TexCoord); break;
+        case  8: texColor = texture(u_Textures[ 8], v_TexCoord); break;
+        case  9: texColor = texture(u_Textures[ 9], v_TexCoord); break;
+        case 10: texColor = texture(u_Textures[10], v_TexCoord); break;
+        case 11: texColor = texture(u_Textures[11], v_TexCoord); break;
+        case 12: texColor = texture(u_Textures[12], v_TexCoord); break;
+        case 13: texColor = texture(u_Textures[13], v_TexCoord); break;
+        case 14: texColor = texture(u_Textures[14], v_TexCoord); break;
+        default: texColor = texture(u_Textures[15], v_TexCoord); break;
+    }
+    color = texColor * v_Color;
+};
@@ -0,0 +1,38 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 texCoord;
+layout(location = 2) in mat4 model; // Per instance, uses locations 2 to 5
+layout(location = 6) in vec4 color; // Per instance
+
+out vec2 v_TexCoord;
+out vec4 v_Color;
+
+layout(std140) uniform Camera
+{
+    mat4 u_ViewProjection;
+};
+
+void main()
+{
+   gl_Position = u_ViewProjection * model * position;
+   v_TexCoord = texCoord;
+   v_Color = color;
+};
+
+#shader fragment
+#version 330 core
+
+layout(location = 0) out vec4 color;
+
+in vec2 v_TexCoord;
+in vec4 v_Color;
+
+uniform sampler2D u_Texture;
+
+void main()
+{
+    vec4 texColor = texture(u_Texture, v_TexCoord);
+    color = texColor * v_Color;
+};
@@ -0,0 +1,21 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec4 position;
+
+uniform mat4 u_MVP; // Model View Projection of the proxy box
+
+void main()
+{
+   gl_Position = u_MVP * position;
+};
+
+#shader fragment
+#version 330 core
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+    color = vec4(1.0); // Color writes are masked off, only the depth test matters
+};
\ No newline at end of file
@@ -0,0 +1,29 @@
+#shader vertex
+#version 330 core
+
+out vec2 v_TexCoord;
+
+void main()
+{
+   // Fullscreen triangle generated from the vertex index, no vertex buffer needed
+   vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+   v_TexCoord = position;
+   gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+};
+
+#shader fragment
+#version 330 core
+
+layout(location = 0) out vec4 color;
+
+in vec2 v_TexCoord;
+
+uniform sampler2D u_Texture;
+uniform float u_Vignette; // Strength of the darkening towards the corners
+
+void main()
+{
+    vec2 fromCenter = v_TexCoord - 0.5;
+    float vignette = 1.0 - u_Vignette * dot(fromCenter, fromCenter) * 2.0;
+    color = vec4(texture(u_Texture, v_TexCoord).rgb * vignette, 1.0);
+};
\ No newline at end of file
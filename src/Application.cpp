@@ -2,17 +2,46 @@
 #include <GLFW/glfw3.h>
 
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <future>
+#include <thread>
+#include <unordered_map>
 
 #include "Renderer.h"
+#include "GLStateCache.h"
 #include "VertexBuffer.h"
 #include "VertexBufferLayout.h"
 #include "IndexBuffer.h"
 #include "VertexArray.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "BatchRenderer2D.h"
+#include "CommandList.h"
+#include "FramePacketQueue.h"
+#include "FrustumCuller.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "RenderGraph.h"
+#include "Framebuffer.h"
+#include "HeadlessContext.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "UniformBufferManager.h"
+#include "UniformTable.h"
+#include "ProgramBinaryCache.h"
+#include "OcclusionQuery.h"
+#include "BufferHeap.h"
+#include "IndirectDrawBuffer.h"
+#include "ThreadPool.h"
 
 // Math imports
 #include "glm/glm.hpp"
@@ -36,42 +65,267 @@ void processInput(GLFWwindow* window, glm::vec3& translation) {
 }
 
 /**
- * @brief Main function that initializes GLFW, creates a window, sets up OpenGL context,
- * and runs the render loop until the window is closed.
+ * @brief Compares uniform location lookups through a std::unordered_map keyed by std::string,
+ * called with string literals as Shader used to, with the hashed UniformTable lookup, and
+ * prints the time per lookup. Needs no OpenGL context.
  *
- * @return int Returns 0 on successful execution, -1 on error.
+ * @param iterations Number of lookups of each kind.
  */
-int main(void)
-{
-	GLFWwindow* window;
+void benchmarkUniformLookup(unsigned int iterations) {
+	const char* names[] = { "u_MVP", "u_Color", "u_Texture", "u_ViewProjection", "u_Vignette", "u_Model", "u_Time", "u_Textures" };
+	const unsigned int nameCount = sizeof(names) / sizeof(names[0]);
+
+	std::unordered_map<std::string, int> map;
+	UniformTable table;
+	for (unsigned int i = 0; i < nameCount; i++) {
+		map[names[i]] = (int)i;
+		table.Insert(UniformId(names[i]).hash, (int)i);
+	}
 
-	/* Initialize the library */
-	if (!glfwInit())
+	/* Same code as the former Shader::GetUniformLocation, without the GL call on a miss */
+	auto mapLookup = [&map](const std::string& name) {
+		if (map.find(name) != map.end())
+			return map[name];
 		return -1;
+	};
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	const UniformId ids[] = { "u_MVP"_u, "u_Color"_u, "u_Texture"_u, "u_ViewProjection"_u, "u_Vignette"_u, "u_Model"_u, "u_Time"_u, "u_Textures"_u };
+	volatile int sink = 0;
 
-	/* Create a windowed mode window and its OpenGL context */
-	window = glfwCreateWindow(640, 480, "Hello World", NULL, NULL);
-	if (!window)
-	{
-		glfwTerminate();
-		return -1;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < iterations; i++)
+		sink = sink + mapLookup(names[i % nameCount]); // Builds a temporary std::string like a literal argument did
+	const double mapNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+	start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < iterations; i++) {
+		int location = -1;
+		table.Find(ids[i % nameCount].hash, location);
+		sink = sink + location;
 	}
+	const double tableNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+	std::cout << "Uniform lookup, " << iterations << " lookups: unordered_map<std::string> " << mapNs << " ns, UniformTable "
+		<< tableNs << " ns (" << (tableNs > 0.0 ? mapNs / tableNs : 0.0) << "x)" << std::endl;
+}
+
+/**
+ * @brief Records drawCount draws (a color, a transform and a draw each) into one CommandList on
+ * the calling thread, then into one CommandList per worker of a ThreadPool, and prints the
+ * average time of each. Needs no OpenGL context: recording only stores object pointers, so the
+ * objects are placeholders that are never dereferenced.
+ *
+ * @param drawCount Number of draws recorded per frame.
+ * @param frames Number of timed frames of each kind, after one untimed frame that sizes the lists.
+ */
+void benchmarkCommandRecording(unsigned int drawCount, unsigned int frames) {
+	alignas(Shader) static unsigned char shaderStorage[sizeof(Shader)];
+	alignas(VertexArray) static unsigned char vaStorage[sizeof(VertexArray)];
+	alignas(IndexBuffer) static unsigned char ibStorage[sizeof(IndexBuffer)];
+	Shader& shader = *reinterpret_cast<Shader*>(shaderStorage);
+	const VertexArray& va = *reinterpret_cast<const VertexArray*>(vaStorage);
+	const IndexBuffer& ib = *reinterpret_cast<const IndexBuffer*>(ibStorage);
+	const glm::mat4 proj = glm::ortho(-2.0f, 2.0f, -1.5f, 1.5f, -1.0f, 1.0f);
+
+	/* The per-draw work of the simulation: build a transform and record the draw */
+	auto record = [&](CommandList& list, size_t begin, size_t end) {
+		list.Reset();
+		list.BindShader(shader);
+		for (size_t i = begin; i < end; i++) {
+			const glm::vec3 position((float)(i % 400) * 0.01f - 2.0f, (float)(i / 400 % 300) * 0.01f - 1.5f, 0.0f);
+			list.SetUniform4f("u_Color"_u, glm::vec4((float)(i % 7) / 7.0f, 0.3f, 0.8f, 1.0f));
+			list.SetUniformMat4f("u_MVP"_u, proj * glm::translate(glm::mat4(1.0f), position));
+			list.Draw(va, ib);
+		}
+	};
+
+	CommandList single;
+	record(single, 0, drawCount);
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int frame = 0; frame < frames; frame++)
+		record(single, 0, drawCount);
+	const double singleMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+	ThreadPool pool;
+	std::vector<CommandList> lists(pool.GetThreadCount());
+	const ThreadPool::Task task = [&](size_t begin, size_t end, unsigned int worker) { record(lists[worker], begin, end); };
+	pool.ParallelFor(drawCount, task);
+	start = std::chrono::steady_clock::now();
+	for (unsigned int frame = 0; frame < frames; frame++)
+		pool.ParallelFor(drawCount, task);
+	const double parallelMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+	unsigned int parallelCommands = 0;
+	for (const CommandList& list : lists)
+		parallelCommands += list.GetCommandCount() - 1; // Without the BindShader of each list
+	std::cout << "Command recording, " << drawCount << " draws: 1 thread " << singleMs << " ms (" << single.GetCommandCount() - 1
+		<< " commands), " << pool.GetThreadCount() << " threads " << parallelMs << " ms (" << parallelCommands << " commands, "
+		<< (parallelMs > 0.0 ? singleMs / parallelMs : 0.0) << "x)" << std::endl;
+}
+
+/**
+ * @brief Culls objectCount random boxes and spheres against a perspective frustum with the
+ * SIMD path and with the one object at a time path of FrustumCuller, on one thread, and
+ * prints the throughput of each in objects per millisecond. Needs no OpenGL context.
+ *
+ * @param objectCount Number of objects.
+ * @param iterations Number of timed culls of each kind.
+ */
+void benchmarkFrustumCulling(unsigned int objectCount, unsigned int iterations) {
+	FrustumCuller culler;
+	unsigned int seed = 12345;
+	auto random = [&seed](float min, float max) {
+		seed = seed * 1664525u + 1013904223u;
+		return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+	};
+	for (unsigned int i = 0; i < objectCount; i++) {
+		const glm::vec3 center(random(-100.0f, 100.0f), random(-100.0f, 100.0f), random(-100.0f, 100.0f));
+		if (i % 2 == 0)
+			culler.AddBox(center - glm::vec3(random(0.1f, 2.0f)), center + glm::vec3(random(0.1f, 2.0f)));
+		else
+			culler.AddSphere(center, random(0.1f, 2.0f));
+	}
+
+	const glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, 0.1f, 150.0f)
+		* glm::lookAt(glm::vec3(0.0f, 0.0f, -50.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	std::vector<unsigned int> visible;
+	auto objectsPerMs = [&](bool useSimd) {
+		culler.SetUseSimd(useSimd);
+		culler.Cull(viewProjection, visible);
+		const auto start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < iterations; i++)
+			culler.Cull(viewProjection, visible);
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return ms > 0.0 ? (double)objectCount * iterations / ms : 0.0;
+	};
+
+	const double simd = objectsPerMs(true);
+	const size_t simdVisible = visible.size();
+	const double scalar = objectsPerMs(false);
+	std::cout << "Frustum culling, " << objectCount << " objects (" << visible.size() << " visible): "
+		<< FrustumCuller::GetSimdWidth() << "-wide SIMD " << simd << " objects/ms, scalar " << scalar << " objects/ms ("
+		<< (scalar > 0.0 ? simd / scalar : 0.0) << "x)" << std::endl;
+	if (simdVisible != visible.size())
+		std::cout << "Warning: the SIMD path found " << simdVisible << " visible objects" << std::endl;
+}
+
+/**
+ * @brief Builds a regular polygon centered on the origin, in the position + texture coordinate
+ * layout of the sprite quad.
+ *
+ * @param sides Number of sides, at least 3.
+ * @param vertices Receives 4 floats per vertex: the center, then one vertex per corner.
+ * @param indices Receives 3 indices per side, relative to the first vertex.
+ */
+void buildPolygon(unsigned int sides, std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+	vertices = { 0.0f, 0.0f, 0.5f, 0.5f };
+	indices.clear();
+	for (unsigned int i = 0; i < sides; i++) {
+		const float angle = 6.2831853f * i / sides;
+		const float x = 0.5f * cosf(angle);
+		const float y = 0.5f * sinf(angle);
+		vertices.insert(vertices.end(), { x, y, x + 0.5f, y + 0.5f });
+		indices.insert(indices.end(), { 0, 1 + i, 1 + (i + 1) % sides });
+	}
+}
+
+/**
+ * @brief Objects of the render thread that the simulation records commands for.
+ */
+struct SpriteResources {
+	const VertexArray* va;
+	const IndexBuffer* ib;
+	Shader* shader;
+	const Texture* texture;
+};
+
+/**
+ * @brief GL state cache, uniform and occlusion counters and GPU time of the last rendered frames, published for the
+ * window title.
+ */
+struct RenderStats {
+	std::atomic<unsigned int> stateCallsSkipped{ 0 };
+	std::atomic<unsigned int> stateCallsIssued{ 0 };
+	std::atomic<unsigned int> uniformsSkipped{ 0 };
+	std::atomic<unsigned int> uniformsUploaded{ 0 };
+	std::atomic<unsigned int> occludedDraws{ 0 };
+	std::atomic<float> gpuFrameMs{ 0.0f };
+	std::atomic<float> pacingWaitMs{ 0.0f };
+};
+
+/**
+ * @brief Uniform block shared by every shader that reads the camera, uploaded once per frame.
+ */
+struct CameraBlock {
+	glm::mat4 viewProjection;
+};
+STD140_BLOCK(CameraBlock, STD140_FIELD(CameraBlock, viewProjection));
+
+/// Uniform buffer binding point of CameraBlock.
+static const unsigned int CameraBinding = 0;
+
+/**
+ * @brief Options of the render thread, from the command line.
+ */
+struct RenderSettings {
+	std::string capturePrefix = "screenshot_"; ///< Path prefix of captured frames, followed by the frame index.
+	unsigned int framesInFlight = 2;           ///< Frames the render thread may be ahead of the GPU.
+	bool multiDrawIndirect = true;             ///< Whether Renderer::MultiDrawIndirect may use glMultiDrawElementsIndirect.
+};
+
+/**
+ * @brief Render thread: owns the OpenGL context, creates the GL resources and draws every
+ * frame packet published by the simulation until the queue is closed.
+ *
+ * @param window The window whose context the thread makes current and presents to, nullptr when headless.
+ * @param headless The context to render with instead of the window's, into an offscreen framebuffer.
+ * @param packets The queue the simulation publishes frame packets to.
+ * @param spriteReady Receives the objects the simulation draws with, or nullptr on failure.
+ * @param renderStats Receives the state cache and uniform counters of each frame.
+ * @param settings Options of the render thread.
+ */
+void renderThread(GLFWwindow* window, const HeadlessContext* headless, FramePacketQueue& packets, std::promise<const SpriteResources*>& spriteReady,
+	RenderStats& renderStats, const RenderSettings& settings)
+{
+	CpuProfiler::SetThreadName("Render");
 
 	/* Make the window's context current */
-	glfwMakeContextCurrent(window);
-	glfwSwapInterval(1);
+	if (headless) {
+		if (!headless->MakeCurrent()) {
+			std::cout << "Error: could not make the headless context current" << std::endl;
+			spriteReady.set_value(nullptr);
+			return;
+		}
+	}
+	else {
+		glfwMakeContextCurrent(window);
+		glfwSwapInterval(1);
+	}
 
-	if (glewInit() != GLEW_OK) {
+	/* A GLX build of GLEW loads the GL entry points before failing to find an X display, which
+	   an EGL context does not need. Any other path must initialize cleanly */
+	const GLenum glewStatus = glewInit();
+	const bool eglWithoutDisplay = headless && MOTOR_HEADLESS_EGL && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY;
+	if (glewStatus != GLEW_OK && !eglWithoutDisplay) {
 		std::cout << "Error!" << std::endl;
+		spriteReady.set_value(nullptr);
+		return;
 	}
 
 	std::cout << glGetString(GL_VERSION) << std::endl;
+	if (headless)
+		std::cout << "Headless context: " << headless->GetBackendName() << ", " << glGetString(GL_RENDERER) << std::endl;
+
+	GLInitDebugOutput();
 
 	{
+		/* Submit every compile up front and decode the textures on workers while the driver compiles */
+		Shader shader("res/Shaders/basic.shader", ShaderCompileMode::Async);
+		Shader instancedShader("res/Shaders/instanced.shader", ShaderCompileMode::Async);
+		Shader postShader("res/Shaders/post.shader", ShaderCompileMode::Async);
+		std::future<TextureImage> marioImage = std::async(std::launch::async, &Texture::Decode, std::string("res/Textures/Mario.png"));
+		std::future<TextureImage> logoImage = std::async(std::launch::async, &Texture::Decode, std::string("res/Textures/ChernoLogo.png"));
+
 		float positions[] = {
 			-0.5f, -0.5f, 0.0f, 0.0f,
 			 0.5f, -0.5f, 1.0f, 0.0f,
@@ -84,7 +338,7 @@ int main(void)
 			2, 3, 0
 		};
 
-		GLCall(glEnable(GL_BLEND));
+		GLStateCache::SetCapability(GL_BLEND, true);
 		GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
 
 		VertexArray va;
@@ -97,65 +351,551 @@ int main(void)
 
 		IndexBuffer ib(indices, 6);
 
-		glm::mat4 proj = glm::ortho(-2.0f, 2.0f, -1.5f, 1.5f, -1.0f, 1.0f);
+		Texture texture(marioImage.get());
+		texture.Bind();
+
+		/* A row of tinted copies of the quad, drawn with one instanced draw call */
+		struct InstanceData {
+			glm::mat4 model;
+			glm::vec4 color;
+		};
+		std::vector<InstanceData> instances;
+		for (int i = 0; i < 8; i++) {
+			glm::mat4 instanceModel = glm::translate(glm::mat4(1.0f), glm::vec3(-1.75f + i * 0.5f, -1.25f, 0.0f));
+			instanceModel = glm::scale(instanceModel, glm::vec3(0.4f));
+			instances.push_back({ instanceModel, glm::vec4(1.0f, i / 7.0f, 1.0f - i / 7.0f, 1.0f) });
+		}
 
-		Shader shader("res/Shaders/basic.shader");
-		shader.Bind();
-		shader.SetUniform4f("u_Color", 0.9f, 0.3f, 0.8f, 1.0f);
+		VertexArray instancedVa;
+		instancedVa.AddBuffer(vb, layout);
+		VertexBuffer instanceVb(instances.data(), (unsigned int)(instances.size() * sizeof(InstanceData)));
+		VertexBufferLayout instanceLayout(1);
+		instanceLayout.Push<glm::mat4>(1);
+		instanceLayout.Push<float>(4);
+		instancedVa.AddBuffer(instanceVb, instanceLayout);
+		ib.Bind();
 
-		Texture texture("res/Textures/Mario.png");
-		texture.Bind();
-		shader.SetUniform1i("u_Texture", 0);
+		/* The row is drawn as two draws of four instances, executed by a single multi-draw indirect call */
+		IndirectDrawBuffer instancedDraws;
+		instancedDraws.AddDraw(6, 0, 0, (unsigned int)instances.size() / 2);
+		instancedDraws.AddDraw(6, 0, 0, (unsigned int)instances.size() - (unsigned int)instances.size() / 2);
 
 		va.Unbind();
 		vb.Unbind();
 		ib.Unbind();
-		shader.Unbind();
+
+		/* The shaders are still compiling: each one gets its constant uniforms the first frame it is
+		   ready, and the draws using it are skipped until then instead of waiting for the link */
+		bool shaderReady = false;
+		bool instancedShaderReady = false;
+		bool postShaderReady = false;
 
 		Renderer renderer;
+		GpuProfiler profiler;
+		renderer.SetProfiler(&profiler);
+		renderer.SetUseMultiDrawIndirect(settings.multiDrawIndirect);
+		UniformBufferManager uniforms;
+
+		BatchRenderer2D batchRenderer(10000, "res/Shaders/batch.shader", CameraBinding);
+		Texture logoTexture(logoImage.get());
+
+		/* A row of polygons packed into one BufferHeap, deliberately small so that replacing them
+		   over time fragments it until it defragments or grows in the middle of a frame */
+		BufferHeap heap(layout, 32, 48, 64);
+		std::vector<BufferHeap::MeshID> heapMeshes;
+		std::vector<float> polygonVertices;
+		std::vector<unsigned int> polygonIndices;
+		for (unsigned int sides = 3; sides < 11; sides++) {
+			buildPolygon(sides, polygonVertices, polygonIndices);
+			heapMeshes.push_back(heap.Add(polygonVertices.data(), (unsigned int)polygonVertices.size() / 4,
+				polygonIndices.data(), (unsigned int)polygonIndices.size()));
+		}
 
-		float r = 0.0f;
-		float increment = 0.05f;
+		/* A column of sprites behind an opaque one, submitted with occlusion queries so that Flush
+		   skips the ones the front sprite hides */
+		const glm::mat4 occluderModel = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(1.4f, 0.2f, 0.5f)), glm::vec3(0.8f));
+		std::vector<glm::mat4> occludeeModels;
+		std::vector<std::unique_ptr<OcclusionQuery>> occlusionQueries;
+		for (int i = 0; i < 3; i++) {
+			occludeeModels.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(1.4f, 0.2f - i * 0.45f, -0.5f)), glm::vec3(0.3f)));
+			occlusionQueries.emplace_back(new OcclusionQuery(glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, 0.5f, 0.0f)));
+		}
+		RenderState occluderState;
+		occluderState.depthTest = true;
+		occluderState.depth = 0.25f;
+		RenderState occludeeState = occluderState;
+		occludeeState.depth = 0.75f;
+
+		RenderGraph graph;
+
+		/* Without a window the frame ends up in an offscreen framebuffer instead of the backbuffer */
+		std::unique_ptr<Framebuffer> offscreen;
+
+		/* Captured frames are read back asynchronously and written out by a worker thread */
+		FrameCapture capture([&settings](const CapturedFrame& frame) {
+			std::ostringstream path;
+			path << settings.capturePrefix << std::setw(5) << std::setfill('0') << frame.frameIndex << ".tga";
+			if (!FrameCapture::WriteTGA(path.str(), frame))
+				std::cout << "Could not write " << path.str() << std::endl;
+		});
+
+		/* Keeps the driver from queuing more than settings.framesInFlight frames */
+		FramePacer pacer(settings.framesInFlight);
+
+		/* The simulation can start recording once these exist */
+		SpriteResources sprite = { &va, &ib, &shader, &texture };
+		spriteReady.set_value(&sprite);
+
+		/* Draw packets until the simulation closes the queue */
+		while (const FramePacket* packet = packets.BeginRead())
+		{
+			PROFILE_SCOPE("RenderFrame");
+			pacer.BeginFrame();
+			renderStats.pacingWaitMs = (float)pacer.GetStats().lastWaitMs;
+			GLStateCache::ResetStats();
+			Shader::ResetUniformStats();
+			renderer.ResetStats();
+			profiler.BeginFrame();
+			uniforms.SetShared(CameraBinding, CameraBlock{ packet->viewProjection });
+
+			/* Set the constant uniforms of each shader once it is linked, and check the vertex layouts
+			   against its inputs once, rather than debugging a blank draw */
+			if (!shaderReady && shader.IsReady()) {
+				shader.Bind();
+				shader.SetUniform4f("u_Color", 0.9f, 0.3f, 0.8f, 1.0f);
+				shader.SetUniform1i("u_Texture", 0);
+				shader.ValidateLayout(layout);
+				shader.ValidateVertexArray(va);
+				shaderReady = true;
+			}
+			if (!instancedShaderReady && instancedShader.IsReady()) {
+				instancedShader.Bind();
+				instancedShader.SetUniform1i("u_Texture", 0);
+				instancedShader.SetUniformBlockBinding("Camera", CameraBinding);
+				instancedShader.ValidateLayout(layout);
+				instancedShader.ValidateLayout(instanceLayout, (unsigned int)layout.GetElements().size());
+				instancedShader.ValidateVertexArray(instancedVa);
+				instancedShaderReady = true;
+			}
+			if (!postShaderReady && postShader.IsReady()) {
+				postShader.Bind();
+				postShader.SetUniform1i("u_Texture", 0);
+				postShader.SetUniform1f("u_Vignette", 0.6f);
+				postShaderReady = true;
+			}
 
-		glm::vec3 translation(0.0f, 0.0f, 0.0f);
+			/* Render here: the scene is drawn offscreen, then post-processed into the window */
+			if (packet->width > 0 && packet->height > 0) {
+				graph.Reset();
+				RenderGraphResource backbuffer;
+				if (headless) {
+					if (!offscreen) {
+						FramebufferSpec offscreenSpec;
+						offscreenSpec.width = packet->width;
+						offscreenSpec.height = packet->height;
+						offscreenSpec.depthFormat = 0;
+						offscreen.reset(new Framebuffer(offscreenSpec));
+					}
+					offscreen->Resize(packet->width, packet->height);
+					backbuffer = graph.ImportFramebuffer(*offscreen);
+				}
+				else {
+					backbuffer = graph.ImportBackbuffer(packet->width, packet->height);
+				}
+				RenderGraphResource sceneColor = 0;
+
+				graph.AddPass("Scene", [&](RenderGraph::Builder& builder) {
+					RenderTargetDesc desc;
+					desc.width = packet->width;
+					desc.height = packet->height;
+					desc.format = GL_RGBA8;
+					sceneColor = builder.Create("SceneColor", desc);
+					desc.format = GL_DEPTH_COMPONENT24;
+					builder.Create("SceneDepth", desc);
+				}, [&](const RenderGraph&) {
+					GpuProfileScope sceneScope(&profiler, "Scene");
+					renderer.Clear();
+
+					/* Every 30 frames one polygon is replaced by one with a different number of sides */
+					if (packet->frameIndex % 30 == 29) {
+						const unsigned int slot = (packet->frameIndex / 30) % heapMeshes.size();
+						heap.Remove(heapMeshes[slot]);
+						buildPolygon(3 + (packet->frameIndex / 30 * 5) % 29, polygonVertices, polygonIndices);
+						heapMeshes[slot] = heap.Add(polygonVertices.data(), (unsigned int)polygonVertices.size() / 4,
+							polygonIndices.data(), (unsigned int)polygonIndices.size());
+					}
+
+					/* Background grid of sprites, drawn by the batch renderer in a single draw call */
+					{
+						GpuProfileScope scope(&profiler, "BatchRenderer2D");
+						batchRenderer.Begin();
+						for (float y = -1.45f; y < 1.5f; y += 0.1f) {
+							for (float x = -1.95f; x < 2.0f; x += 0.1f) {
+								if ((int)((x + 2.0f) * 10.0f + (y + 1.5f) * 10.0f) % 2 == 0)
+									batchRenderer.DrawQuad({ x, y, 0.0f }, { 0.09f, 0.09f }, logoTexture, { 1.0f, 1.0f, 1.0f, 0.3f });
+								else
+									batchRenderer.DrawQuad({ x, y, 0.0f }, { 0.09f, 0.09f }, { (x + 2.0f) / 4.0f, 0.3f, (y + 1.5f) / 3.0f, 0.3f });
+							}
+						}
+						batchRenderer.End();
+					}
+
+					texture.Bind();
+					if (instancedShaderReady) {
+						instancedShader.Bind();
+						renderer.MultiDrawIndirect(instancedVa, ib, instancedShader, instancedDraws);
+					}
+
+					if (!shaderReady)
+						return;
+
+					/* Meshes of the heap, drawn out of its shared buffers. The uniforms below go to the
+					   current program, so the shader is bound before setting them */
+					{
+						GpuProfileScope scope(&profiler, "BufferHeap");
+						shader.Bind();
+						shader.SetUniform4f("u_Color"_u, 1.0f, 1.0f, 1.0f, 1.0f);
+						for (unsigned int i = 0; i < heapMeshes.size(); i++) {
+							const HeapMesh& mesh = heap.Get(heapMeshes[i]);
+							const glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-1.75f + i * 0.5f, 1.2f, 0.0f)), glm::vec3(0.4f));
+							shader.SetUniformMat4f("u_MVP"_u, packet->viewProjection * model);
+							renderer.DrawRange(heap.GetVertexArray(), heap.GetIndexBuffer(), shader, mesh.indexCount, mesh.firstIndex, (int)mesh.baseVertex);
+						}
+					}
+
+					/* Draw list recorded by the simulation, which only uses the basic shader */
+					renderer.Execute(packet->commands);
+
+					/* Occluded sprites, queued and sorted front to back so the opaque one is drawn first */
+					renderer.Submit(va, ib, shader, packet->viewProjection * occluderModel, &texture, occluderState);
+					for (size_t i = 0; i < occludeeModels.size(); i++)
+						renderer.Submit(va, ib, shader, packet->viewProjection * occludeeModels[i], &texture, occludeeState, occlusionQueries[i].get());
+					renderer.Flush();
+				});
+
+				graph.AddPass("Post", [&](RenderGraph::Builder& builder) {
+					builder.Read(sceneColor);
+					builder.Write(backbuffer);
+				}, [&](const RenderGraph& targets) {
+					GpuProfileScope postScope(&profiler, "Post");
+					/* Black until the post-processing shader is linked */
+					if (!postShaderReady) {
+						renderer.Clear();
+						return;
+					}
+					GLStateCache::BindTexture(0, targets.GetTexture(sceneColor));
+					renderer.DrawFullscreen(postShader);
+				});
+
+				graph.Execute();
+
+				if (packet->capture) {
+					if (offscreen)
+						capture.Capture(*offscreen, packet->frameIndex);
+					else
+						capture.CaptureBackbuffer(packet->width, packet->height, packet->frameIndex);
+				}
+			}
+			capture.Poll();
+
+			/* The packet is no longer needed once its commands are issued */
+			packets.EndRead();
+			uniforms.EndFrame();
+
+			const GLStateCache::Stats& stats = GLStateCache::GetStats();
+			renderStats.stateCallsSkipped = stats.hits;
+			renderStats.stateCallsIssued = stats.misses;
+			const Shader::UniformStats& uniformStats = Shader::GetUniformStats();
+			renderStats.uniformsSkipped = uniformStats.skipped + uniformStats.inactive;
+			renderStats.uniformsUploaded = uniformStats.uploads;
+			renderStats.occludedDraws = renderer.GetStats().occludedDraws;
+
+			profiler.EndFrame();
+			if (const GpuPassStats* frameStats = profiler.GetPassStats("Frame"))
+				renderStats.gpuFrameMs = (float)frameStats->lastMs;
+
+			/* Swap front and back buffers, or just submit the frame when headless */
+			if (window) {
+				PROFILE_SCOPE("glfwSwapBuffers");
+				GLCall(glfwSwapBuffers(window));
+			}
+			else {
+				GLCall(glFlush());
+			}
+			pacer.EndFrame();
+		}
+
+		capture.Finish();
+		const FrameCapture::Stats captureStats = capture.GetStats();
+		if (captureStats.capturedFrames > 0) {
+			std::cout << "Captured " << captureStats.encodedFrames << " frames (" << captureStats.readbackStalls
+				<< " read back stalls, " << captureStats.encoderStalls << " encoder stalls)" << std::endl;
+		}
+
+		const FramePacer::Stats& pacingStats = pacer.GetStats();
+		if (headless && pacingStats.frameCount > 0) {
+			std::cout << "Frame pacing: " << pacingStats.waitCount << " of " << pacingStats.frameCount << " frames waited for the GPU, "
+				<< pacingStats.totalWaitMs / pacingStats.frameCount << " ms/frame on average, " << pacingStats.maxWaitMs << " ms at most" << std::endl;
+		}
+		const BufferHeap::Stats heapStats = heap.GetStats();
+		if (headless) {
+			std::cout << "Buffer heap: " << heapStats.meshCount << " meshes in " << heapStats.usedVertices << "/" << heapStats.vertexCapacity
+				<< " vertices, " << heapStats.defragmentCount << " rebuilds, " << heapStats.growCount << " growths" << std::endl;
+		}
+		const Renderer::Stats& rendererStats = renderer.GetStats();
+		if (headless) {
+			std::cout << "Multi-draw indirect: " << rendererStats.multiDrawIndirectCalls << " calls, " << rendererStats.indirectFallbackDraws
+				<< " draws issued one by one, " << rendererStats.emulatedBaseInstanceDraws << " with emulated base instance in the last frame" << std::endl;
+		}
+		const ProgramBinaryCache::Stats& shaderCacheStats = ProgramBinaryCache::GetStats();
+		if (headless && ProgramBinaryCache::IsEnabled()) {
+			std::cout << "Shader cache: " << shaderCacheStats.hits << " programs loaded, " << shaderCacheStats.misses << " compiled, "
+				<< shaderCacheStats.rejected << " rejected by the driver" << std::endl;
+		}
+		pacer.WaitIdle();
+	}
 
-		/* Loop until the user closes the window */
-		while (!glfwWindowShouldClose(window))
+	/* GL resources are gone, release the context for the main thread */
+	if (headless)
+		headless->ReleaseCurrent();
+	else
+		glfwMakeContextCurrent(NULL);
+}
+
+/**
+ * @brief Main function that initializes GLFW, creates a window, starts the render thread
+ * and runs the simulation until the window is closed.
+ *
+ * The main thread handles window events and input and records one frame packet per frame,
+ * while the render thread draws the previous packet, so simulating frame N+1 overlaps
+ * submitting frame N.
+ *
+ * With --headless, no window is created: the render thread uses a HeadlessContext and draws
+ * into an offscreen framebuffer, and the simulation runs --frames frames (600 by default)
+ * without input, then prints the average frame time. --capture PREFIX additionally writes
+ * every headless frame to PREFIX00000.tga, PREFIX00001.tga... In a window, F12 saves a
+ * screenshot the same way (PREFIX defaults to "screenshot_"). --frames-in-flight N bounds how
+ * many frames the GPU may lag behind (2 by default). --bench-uniforms runs the uniform lookup
+ * microbenchmark and exits, --bench-record the single versus multi-threaded command
+ * recording one, --bench-cull the SIMD versus scalar frustum culling one. Linked programs are
+ * cached in shader_cache/ unless --no-shader-cache is given. --no-multi-draw-indirect issues
+ * multi-draw indirect draws one by one.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return int Returns 0 on successful execution, -1 on error.
+ */
+int main(int argc, char** argv)
+{
+	GLFWwindow* window = NULL;
+
+	bool headless = false;
+	unsigned int headlessFrames = 600;
+	bool captureEveryFrame = false;
+	RenderSettings settings;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0)
+			headless = true;
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			headlessFrames = (unsigned int)std::stoul(argv[++i]);
+		else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+			settings.capturePrefix = argv[++i];
+			captureEveryFrame = true;
+		}
+		else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+			settings.framesInFlight = (unsigned int)std::stoul(argv[++i]);
+		else if (strcmp(argv[i], "--no-shader-cache") == 0)
+			ProgramBinaryCache::SetDirectory("");
+		else if (strcmp(argv[i], "--no-multi-draw-indirect") == 0)
+			settings.multiDrawIndirect = false;
+		else if (strcmp(argv[i], "--bench-uniforms") == 0) {
+			benchmarkUniformLookup(10000000);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-cull") == 0) {
+			benchmarkFrustumCulling(1000000, 50);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-record") == 0) {
+			benchmarkCommandRecording(100000, 20);
+			return 0;
+		}
+	}
+	captureEveryFrame = captureEveryFrame && headless;
+	const int headlessWidth = 640;
+	const int headlessHeight = 480;
+
+	/* Initialize the library, which EGL does not need */
+	const bool usesGlfw = !headless || !MOTOR_HEADLESS_EGL;
+	if (usesGlfw && !glfwInit())
+		return -1;
+
+	/* Create a windowed mode window and its OpenGL context, or a context alone */
+	HeadlessContext headlessContext;
+	if (headless) {
+		if (!headlessContext.Create(3, 3, MOTOR_GL_ERROR_CHECK == MOTOR_GL_ERROR_CHECK_ASYNC)) {
+			if (usesGlfw)
+				glfwTerminate();
+			return -1;
+		}
+	}
+	else {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#if MOTOR_GL_ERROR_CHECK == MOTOR_GL_ERROR_CHECK_ASYNC
+		glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE); // Have the driver report errors through KHR_debug
+#endif
+
+		window = glfwCreateWindow(640, 480, "Hello World", NULL, NULL);
+		if (!window)
 		{
-			/* Process input */
-			processInput(window, translation);
+			glfwTerminate();
+			return -1;
+		}
+	}
 
-			/* Update MVP matrix */
-			glm::mat4 model = glm::translate(glm::mat4(1.0f), translation);
-			glm::mat4 mvp = proj * model;
-			shader.Bind();
-			shader.SetUniformMat4f("u_MVP", mvp);
+	CpuProfiler::SetThreadName("Simulation");
 
-			/* Render here */
-			renderer.Clear();
+	/* The render thread owns the context, events stay on the main thread as GLFW requires */
+	FramePacketQueue packets(2);
+	std::promise<const SpriteResources*> spriteReady;
+	RenderStats renderStats;
+	std::thread renderer(renderThread, window, headless ? &headlessContext : nullptr, std::ref(packets), std::ref(spriteReady), std::ref(renderStats),
+		std::cref(settings));
 
-			shader.Bind();
-			shader.SetUniform4f("u_Color", r, 0.3f, 0.8f, 1.0f);
+	const SpriteResources* sprite = spriteReady.get_future().get();
+	if (!sprite) {
+		renderer.join();
+		if (usesGlfw)
+			glfwTerminate();
+		return -1;
+	}
 
-			renderer.Draw(va, ib, shader);
+	glm::mat4 proj = glm::ortho(-2.0f, 2.0f, -1.5f, 1.5f, -1.0f, 1.0f);
 
-			if (r > 1.0f) {
-				increment = -0.05f;
-			}
-			else if (r < 0.0f) {
-				increment = 0.05f;
-			}
+	float r = 0.0f;
+	float increment = 0.05f;
+
+	glm::vec3 translation(0.0f, 0.0f, 0.0f);
+
+	unsigned int frame = 0;
+
+	/* P captures the next frames of every thread into a Chrome trace */
+	const unsigned int profiledFrameCount = 120;
+	unsigned int profiledFramesLeft = 0;
+	bool profileKeyDown = false;
+
+	/* F12 saves a screenshot */
+	bool screenshotKeyDown = false;
+	bool takeScreenshot = false;
+
+	RenderState spriteState;
+	spriteState.blend = true;
 
-			r += increment;
+	/* The sprite is skipped once the arrow keys move it off screen */
+	FrustumCuller culler;
+	culler.AddBox(glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, 0.5f, 0.0f));
+	std::vector<unsigned int> visible;
 
-			/* Swap front and back buffers */
-			GLCall(glfwSwapBuffers(window));
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
 
+	/* Loop until the user closes the window, or for the requested frame count when headless */
+	while (window ? !glfwWindowShouldClose(window) : frame < headlessFrames)
+	{
+		PROFILE_SCOPE("SimulationFrame");
+
+		if (window) {
 			/* Poll for and process events */
-			GLCall(glfwPollEvents());
+			glfwPollEvents();
+
+			bool profileKeyPressed = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+			if (profileKeyPressed && !profileKeyDown && profiledFramesLeft == 0) {
+				CpuProfiler::BeginCapture();
+				profiledFramesLeft = profiledFrameCount;
+			}
+			profileKeyDown = profileKeyPressed;
+
+			bool screenshotKeyPressed = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+			takeScreenshot = screenshotKeyPressed && !screenshotKeyDown;
+			screenshotKeyDown = screenshotKeyPressed;
+
+			/* Process input */
+			processInput(window, translation);
+		}
+
+		/* Update MVP matrix */
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), translation);
+		glm::mat4 mvp = proj * model;
+
+		/* Waits only while the render thread is still busy with both packets */
+		FramePacket* packet = packets.BeginWrite();
+		if (!packet)
+			break; // The queue was closed, no frame will be rendered anymore
+		packet->frameIndex = frame;
+		if (window) {
+			glfwGetFramebufferSize(window, &packet->width, &packet->height);
+		}
+		else {
+			packet->width = headlessWidth;
+			packet->height = headlessHeight;
+		}
+		packet->viewProjection = proj;
+		packet->capture = captureEveryFrame || takeScreenshot;
+
+		culler.SetBox(0, translation - glm::vec3(0.5f, 0.5f, 0.0f), translation + glm::vec3(0.5f, 0.5f, 0.0f));
+		culler.Cull(proj, visible);
+
+		CommandList& commands = packet->commands;
+		if (!visible.empty()) {
+			commands.SetState(spriteState);
+			commands.BindShader(*sprite->shader);
+			commands.BindTexture(*sprite->texture);
+			commands.SetUniform4f("u_Color"_u, glm::vec4(r, 0.3f, 0.8f, 1.0f));
+			commands.SetUniformMat4f("u_MVP"_u, mvp);
+			commands.Draw(*sprite->va, *sprite->ib);
+		}
+		packets.EndWrite();
+
+		if (r > 1.0f) {
+			increment = -0.05f;
+		}
+		else if (r < 0.0f) {
+			increment = 0.05f;
+		}
+
+		r += increment;
+
+		if (profiledFramesLeft > 0 && --profiledFramesLeft == 0) {
+			CpuProfiler::EndCapture();
+			if (CpuProfiler::WriteChromeTrace("profile.json"))
+				std::cout << "Wrote profile.json" << std::endl;
+		}
+
+		/* Show how many redundant state changes the cache skipped in the last rendered frame */
+		if (frame++ % 60 == 0 && window) {
+			std::string title = "Hello World | GL state calls skipped: " + std::to_string(renderStats.stateCallsSkipped)
+				+ " issued: " + std::to_string(renderStats.stateCallsIssued)
+				+ " | uniforms skipped: " + std::to_string(renderStats.uniformsSkipped)
+				+ " uploaded: " + std::to_string(renderStats.uniformsUploaded)
+				+ " | occluded draws: " + std::to_string(renderStats.occludedDraws)
+				+ " | GPU: " + std::to_string(renderStats.gpuFrameMs.load()) + " ms"
+				+ " | pacing wait: " + std::to_string(renderStats.pacingWaitMs.load()) + " ms";
+			glfwSetWindowTitle(window, title.c_str());
 		}
 	}
 
-	glfwTerminate();
+	packets.Close();
+	renderer.join();
+
+	if (headless) {
+		const double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		std::cout << "Rendered " << frame << " frames at " << headlessWidth << "x" << headlessHeight << " in " << totalMs << " ms ("
+			<< (frame ? totalMs / frame : 0.0) << " ms/frame, last GPU frame " << renderStats.gpuFrameMs.load() << " ms, "
+			<< renderStats.occludedDraws << " occluded draws)" << std::endl;
+	}
+
+	if (usesGlfw)
+		glfwTerminate();
 	return 0;
 }
\ No newline at end of file
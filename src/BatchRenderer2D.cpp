@@ -0,0 +1,216 @@
+#include "BatchRenderer2D.h"
+#include "VertexBufferLayout.h"
+#include "GLStateCache.h"
+#include "Renderer.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+/**
+ * @brief Constructs a BatchRenderer2D and allocates its buffers.
+ *
+ * @param maxQuads Number of quads that fit in one batch.
+ * @param shaderPath Path to the batch shader.
+ * @param cameraBinding Uniform buffer binding point of the Camera block the shader reads its
+ * view projection matrix from, uploaded with UniformBufferManager::SetShared.
+ */
+BatchRenderer2D::BatchRenderer2D(unsigned int maxQuads, const std::string& shaderPath, unsigned int cameraBinding)
+	: m_maxQuads(maxQuads),
+	m_vb(GL_ARRAY_BUFFER, maxQuads * 4 * sizeof(QuadVertex)),
+	m_ib(CreateIndexBuffer(maxQuads)),
+	m_shader(shaderPath),
+	m_whiteTexture(1, 1, "\xFF\xFF\xFF\xFF"),
+	m_textureSlots(),
+	m_textureSlotCount(1),
+	m_textureSlotLimit(MaxTextureSlots)
+{
+	VertexBufferLayout layout;
+	layout.Push<float>(3); // position
+	layout.Push<float>(4); // color
+	layout.Push<float>(2); // texCoord
+	layout.Push<float>(1); // texIndex
+	m_va.AddBuffer(m_vb, layout);
+	m_shader.ValidateLayout(layout);
+	m_shader.ValidateVertexArray(m_va);
+
+	// Slot i samples unit i, for as many slots as both the GPU and the sampler array allow
+	m_shader.SetUniformBlockBinding("Camera", cameraBinding);
+	const UniformHandle<int> textures = m_shader.GetUniform<int>("u_Textures"_u);
+	int maxTextureUnits;
+	GLCall(glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxTextureUnits));
+	m_textureSlotLimit = std::min({ (unsigned int)maxTextureUnits, (unsigned int)std::max(textures.arraySize, 1), MaxTextureSlots });
+
+	int samplers[MaxTextureSlots];
+	for (unsigned int i = 0; i < MaxTextureSlots; i++)
+		samplers[i] = i;
+	m_shader.Bind();
+	m_shader.SetArray(textures, m_textureSlotLimit, samplers);
+
+	m_textureSlots[0] = &m_whiteTexture;
+	m_vertices.reserve(maxQuads * 4);
+}
+
+/**
+ * @brief Starts a new scene, drawn with the camera currently in the Camera block.
+ */
+void BatchRenderer2D::Begin()
+{
+	m_vertices.clear();
+	m_textureSlotCount = 1;
+}
+
+/**
+ * @brief Adds a colored quad to the batch.
+ *
+ * @param position Center of the quad.
+ * @param size Width and height of the quad.
+ * @param color Color of the quad.
+ */
+void BatchRenderer2D::DrawQuad(const glm::vec3& position, const glm::vec2& size, const glm::vec4& color)
+{
+	FlushIfFull();
+	AddQuad(position, size, color, 0.0f);
+}
+
+/**
+ * @brief Adds a textured quad to the batch.
+ *
+ * @param position Center of the quad.
+ * @param size Width and height of the quad.
+ * @param texture Texture of the quad.
+ * @param tint Color the texture is multiplied with.
+ */
+void BatchRenderer2D::DrawQuad(const glm::vec3& position, const glm::vec2& size, const Texture& texture,
+	const glm::vec4& tint)
+{
+	FlushIfFull();
+	float texIndex = GetTextureSlot(texture);
+	AddQuad(position, size, tint, texIndex);
+}
+
+/**
+ * @brief Ends the scene, draws what is left in the batch and fences the vertices of the scene.
+ */
+void BatchRenderer2D::End()
+{
+	Flush();
+	m_vb.EndFrame();
+}
+
+/**
+ * @brief Uploads the current batch, draws it and starts a new, empty batch.
+ */
+void BatchRenderer2D::Flush()
+{
+	if (m_vertices.empty())
+		return;
+
+	// Aligning on the vertex size makes the range start on a whole vertex
+	const unsigned int size = (unsigned int)(m_vertices.size() * sizeof(QuadVertex));
+	StreamingRange range = m_vb.Allocate(size, sizeof(QuadVertex));
+	if (!range.data) {
+		std::cout << "Warning: batch of " << m_vertices.size() / 4 << " quads does not fit in the vertex buffer, skipped" << std::endl;
+		m_vertices.clear();
+		m_textureSlotCount = 1;
+		return;
+	}
+	memcpy(range.data, m_vertices.data(), size);
+	m_vb.Commit(range);
+
+	for (unsigned int i = 0; i < m_textureSlotCount; i++)
+		m_textureSlots[i]->Bind(i);
+
+	GLStateCache::SetCapability(GL_BLEND, true);
+	m_shader.Bind();
+	m_va.Bind();
+	unsigned int indexCount = (unsigned int)(m_vertices.size() / 4 * 6);
+	GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr, range.offset / sizeof(QuadVertex)));
+
+	m_stats.drawCalls++;
+	m_stats.quadCount += (unsigned int)(m_vertices.size() / 4);
+
+	m_vertices.clear();
+	m_textureSlotCount = 1;
+}
+
+/**
+ * @brief Flushes the batch if it has no room for another quad.
+ */
+void BatchRenderer2D::FlushIfFull()
+{
+	if (m_vertices.size() >= m_maxQuads * 4)
+		Flush();
+}
+
+/**
+ * @brief Gets the slot of a texture in the current batch, adding it if needed.
+ *
+ * @param texture The texture to look up.
+ * @return float The texture slot as stored in QuadVertex::texIndex.
+ */
+float BatchRenderer2D::GetTextureSlot(const Texture& texture)
+{
+	for (unsigned int i = 1; i < m_textureSlotCount; i++) {
+		if (m_textureSlots[i] == &texture)
+			return (float)i;
+	}
+
+	if (m_textureSlotCount >= m_textureSlotLimit)
+		Flush();
+
+	m_textureSlots[m_textureSlotCount] = &texture;
+	return (float)m_textureSlotCount++;
+}
+
+/**
+ * @brief Writes the four vertices of a quad. The batch must not be full.
+ *
+ * @param position Center of the quad.
+ * @param size Width and height of the quad.
+ * @param color Color of the quad.
+ * @param texIndex Texture slot of the quad.
+ */
+void BatchRenderer2D::AddQuad(const glm::vec3& position, const glm::vec2& size, const glm::vec4& color, float texIndex)
+{
+	const glm::vec2 half = size * 0.5f;
+	m_vertices.push_back({ { position.x - half.x, position.y - half.y, position.z }, color, { 0.0f, 0.0f }, texIndex });
+	m_vertices.push_back({ { position.x + half.x, position.y - half.y, position.z }, color, { 1.0f, 0.0f }, texIndex });
+	m_vertices.push_back({ { position.x + half.x, position.y + half.y, position.z }, color, { 1.0f, 1.0f }, texIndex });
+	m_vertices.push_back({ { position.x - half.x, position.y + half.y, position.z }, color, { 0.0f, 1.0f }, texIndex });
+}
+
+/**
+ * @brief Generates the indices of maxQuads quads, two triangles each.
+ *
+ * @param maxQuads Number of quads.
+ * @return std::vector<unsigned int> The indices.
+ */
+std::vector<unsigned int> BatchRenderer2D::GenerateQuadIndices(unsigned int maxQuads)
+{
+	std::vector<unsigned int> indices(maxQuads * 6);
+	for (unsigned int quad = 0, offset = 0; quad < maxQuads; quad++, offset += 4) {
+		indices[quad * 6 + 0] = offset + 0;
+		indices[quad * 6 + 1] = offset + 1;
+		indices[quad * 6 + 2] = offset + 2;
+		indices[quad * 6 + 3] = offset + 2;
+		indices[quad * 6 + 4] = offset + 3;
+		indices[quad * 6 + 5] = offset + 0;
+	}
+	return indices;
+}
+
+/**
+ * @brief Creates the shared index buffer with the vertex array of the batch bound.
+ *
+ * IndexBuffer binds itself to GL_ELEMENT_ARRAY_BUFFER, which is vertex array state. Binding the
+ * batch's vertex array first attaches the index buffer to it instead of to whatever vertex
+ * array was bound when the batch renderer was created.
+ *
+ * @param maxQuads Number of quads.
+ * @return IndexBuffer* The new index buffer.
+ */
+IndexBuffer* BatchRenderer2D::CreateIndexBuffer(unsigned int maxQuads)
+{
+	m_va.Bind();
+	return new IndexBuffer(GenerateQuadIndices(maxQuads).data(), maxQuads * 6);
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "StreamingBuffer.h"
+#include "IndexBuffer.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "glm/glm.hpp"
+
+/**
+ * @brief Vertex written by BatchRenderer2D for each corner of a quad.
+ */
+struct QuadVertex {
+	glm::vec3 position; ///< Position of the corner.
+	glm::vec4 color;    ///< Color the texture is multiplied with.
+	glm::vec2 texCoord; ///< Texture coordinate of the corner.
+	float texIndex;     ///< Index of the texture slot to sample from.
+};
+
+/**
+ * @brief Renders large numbers of 2D quads in as few draw calls as possible.
+ *
+ * Quads are written into a CPU-side vertex array and copied into a range of a persistently
+ * mapped StreamingBuffer when the batch is flushed, then drawn with that range's offset as the
+ * base vertex. All batches share a pre-generated index buffer, and up to
+ * MaxTextureSlots textures are bound at once, so a flush is only needed when the buffer is
+ * full, the texture slots are exhausted, or End is called.
+ */
+class BatchRenderer2D {
+public:
+	/**
+	 * @brief Draw statistics since the last ResetStats.
+	 */
+	struct Stats {
+		unsigned int drawCalls = 0; ///< Number of draw calls issued.
+		unsigned int quadCount = 0; ///< Number of quads drawn.
+	};
+
+	/// Maximum number of texture slots. Slot 0 always holds a white texture.
+	static const unsigned int MaxTextureSlots = 16;
+
+private:
+	unsigned int m_maxQuads;                    ///< Number of quads that fit in one batch.
+	VertexArray m_va;                           ///< Vertex array describing QuadVertex.
+	StreamingBuffer m_vb;                       ///< Streaming vertex buffer the batches are written to.
+	std::unique_ptr<IndexBuffer> m_ib;          ///< Shared index buffer for m_maxQuads quads.
+	Shader m_shader;                            ///< Shader sampling the texture slots.
+	Texture m_whiteTexture;                     ///< 1x1 white texture used by untextured quads.
+	std::vector<QuadVertex> m_vertices;         ///< Vertices of the current batch.
+	const Texture* m_textureSlots[MaxTextureSlots]; ///< Textures used by the current batch.
+	unsigned int m_textureSlotCount;            ///< Number of texture slots used by the current batch.
+	unsigned int m_textureSlotLimit;            ///< Number of texture slots the GPU and the shader support, at most MaxTextureSlots.
+	Stats m_stats;                              ///< Draw statistics.
+
+public:
+	/**
+	 * @brief Constructs a BatchRenderer2D and allocates its buffers.
+	 *
+	 * @param maxQuads Number of quads that fit in one batch.
+	 * @param shaderPath Path to the batch shader.
+	 * @param cameraBinding Uniform buffer binding point of the Camera block the shader reads its
+	 * view projection matrix from, uploaded with UniformBufferManager::SetShared.
+	 */
+	BatchRenderer2D(unsigned int maxQuads = 10000, const std::string& shaderPath = "res/Shaders/batch.shader",
+		unsigned int cameraBinding = 0);
+
+	/**
+	 * @brief Starts a new scene, drawn with the camera currently in the Camera block.
+	 */
+	void Begin();
+
+	/**
+	 * @brief Adds a colored quad to the batch.
+	 *
+	 * @param position Center of the quad.
+	 * @param size Width and height of the quad.
+	 * @param color Color of the quad.
+	 */
+	void DrawQuad(const glm::vec3& position, const glm::vec2& size, const glm::vec4& color);
+
+	/**
+	 * @brief Adds a textured quad to the batch.
+	 *
+	 * The texture must stay alive until the batch is flushed.
+	 *
+	 * @param position Center of the quad.
+	 * @param size Width and height of the quad.
+	 * @param texture Texture of the quad.
+	 * @param tint Color the texture is multiplied with.
+	 */
+	void DrawQuad(const glm::vec3& position, const glm::vec2& size, const Texture& texture,
+		const glm::vec4& tint = glm::vec4(1.0f));
+
+	/**
+	 * @brief Ends the scene, draws what is left in the batch and fences the vertices of the scene.
+	 */
+	void End();
+
+	/**
+	 * @brief Gets the draw statistics since the last ResetStats.
+	 *
+	 * @return const Stats& The statistics.
+	 */
+	inline const Stats& GetStats() const { return m_stats; }
+
+	/**
+	 * @brief Gets the streaming statistics of the vertex buffer.
+	 *
+	 * @return const StreamingBuffer::Stats& The statistics.
+	 */
+	inline const StreamingBuffer::Stats& GetStreamingStats() const { return m_vb.GetStats(); }
+
+	/**
+	 * @brief Resets the draw statistics, typically once per frame.
+	 */
+	inline void ResetStats() { m_stats = Stats(); }
+
+private:
+	/**
+	 * @brief Uploads the current batch, draws it and starts a new, empty batch.
+	 */
+	void Flush();
+
+	/**
+	 * @brief Flushes the batch if it has no room for another quad.
+	 */
+	void FlushIfFull();
+
+	/**
+	 * @brief Gets the slot of a texture in the current batch, adding it if needed.
+	 *
+	 * Flushes the batch first if all slots are in use.
+	 *
+	 * @param texture The texture to look up.
+	 * @return float The texture slot as stored in QuadVertex::texIndex.
+	 */
+	float GetTextureSlot(const Texture& texture);
+
+	/**
+	 * @brief Writes the four vertices of a quad. The batch must not be full.
+	 *
+	 * @param position Center of the quad.
+	 * @param size Width and height of the quad.
+	 * @param color Color of the quad.
+	 * @param texIndex Texture slot of the quad.
+	 */
+	void AddQuad(const glm::vec3& position, const glm::vec2& size, const glm::vec4& color, float texIndex);
+
+	/**
+	 * @brief Generates the indices of maxQuads quads, two triangles each.
+	 *
+	 * @param maxQuads Number of quads.
+	 * @return std::vector<unsigned int> The indices.
+	 */
+	static std::vector<unsigned int> GenerateQuadIndices(unsigned int maxQuads);
+
+	/**
+	 * @brief Creates the shared index buffer with the vertex array of the batch bound.
+	 *
+	 * @param maxQuads Number of quads.
+	 * @return IndexBuffer* The new index buffer.
+	 */
+	IndexBuffer* CreateIndexBuffer(unsigned int maxQuads);
+};
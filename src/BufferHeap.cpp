@@ -0,0 +1,261 @@
+#include "BufferHeap.h"
+#include "IndirectDrawBuffer.h"
+#include "GLStateCache.h"
+#include "Renderer.h"
+#include <algorithm>
+
+/**
+ * @brief Constructs a BufferHeap and allocates its buffers.
+ *
+ * @param layout Per-vertex layout shared by every mesh of the heap.
+ * @param vertexCapacity Initial size of the vertex buffer, in vertices.
+ * @param indexCapacity Initial size of the index buffer, in indices.
+ * @param maxMeshes Maximum number of live meshes.
+ */
+BufferHeap::BufferHeap(const VertexBufferLayout& layout, unsigned int vertexCapacity, unsigned int indexCapacity, unsigned int maxMeshes)
+	: m_layout(layout), m_maxMeshes(maxMeshes),
+	m_vb(new VertexBuffer(nullptr, vertexCapacity * layout.GetStride())), m_ib(CreateIndexBuffer(indexCapacity)),
+	m_vertexAllocator(vertexCapacity, maxMeshes), m_indexAllocator(indexCapacity, maxMeshes)
+{
+	m_va.AddBuffer(*m_vb, m_layout, 0);
+	m_stats.vertexCapacity = vertexCapacity;
+	m_stats.indexCapacity = indexCapacity;
+}
+
+/**
+ * @brief Copies a mesh into the heap. If either buffer has no free range large enough, the
+ * heap is defragmented when the free space would suffice once packed, and grown to at least
+ * twice its size otherwise.
+ *
+ * @param vertices Pointer to vertexCount vertices in the layout of the heap.
+ * @param vertexCount Number of vertices, greater than 0.
+ * @param indices Pointer to indexCount indices, relative to the first vertex of the mesh.
+ * @param indexCount Number of indices, greater than 0.
+ * @return MeshID ID of the mesh, InvalidMesh if the maximum number of meshes is reached.
+ */
+BufferHeap::MeshID BufferHeap::Add(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+	ASSERT(vertexCount > 0 && indexCount > 0);
+	if (vertexCount == 0 || indexCount == 0 || m_stats.meshCount >= m_maxMeshes)
+		return InvalidMesh;
+
+	OffsetAllocation vertexRange = m_vertexAllocator.Allocate(vertexCount);
+	OffsetAllocation indexRange = m_indexAllocator.Allocate(indexCount);
+	if (!vertexRange.IsValid() || !indexRange.IsValid()) {
+		if (vertexRange.IsValid())
+			m_vertexAllocator.Free(vertexRange);
+		if (indexRange.IsValid())
+			m_indexAllocator.Free(indexRange);
+
+		const OffsetAllocator::Stats vertexStats = m_vertexAllocator.GetStats();
+		const OffsetAllocator::Stats indexStats = m_indexAllocator.GetStats();
+		if (vertexStats.freeSize >= vertexCount && indexStats.freeSize >= indexCount) {
+			Defragment();
+		}
+		else {
+			const unsigned int vertexCapacity = m_vertexAllocator.GetSize();
+			const unsigned int indexCapacity = m_indexAllocator.GetSize();
+			Grow(std::max(vertexCapacity * 2, vertexCapacity - vertexStats.freeSize + vertexCount),
+				std::max(indexCapacity * 2, indexCapacity - indexStats.freeSize + indexCount));
+		}
+
+		// The free space is now a single range at the end of each buffer
+		vertexRange = m_vertexAllocator.Allocate(vertexCount);
+		indexRange = m_indexAllocator.Allocate(indexCount);
+		ASSERT(vertexRange.IsValid() && indexRange.IsValid());
+	}
+
+	MeshID id;
+	if (!m_freeIDs.empty()) {
+		id = m_freeIDs.back();
+		m_freeIDs.pop_back();
+	}
+	else {
+		id = (MeshID)m_meshes.size();
+		m_meshes.emplace_back();
+	}
+
+	MeshSlot& slot = m_meshes[id];
+	slot.vertices = vertexRange;
+	slot.indices = indexRange;
+	slot.live = true;
+	slot.mesh.baseVertex = vertexRange.offset;
+	slot.mesh.vertexCount = vertexCount;
+	slot.mesh.firstIndex = indexRange.offset;
+	slot.mesh.indexCount = indexCount;
+	m_stats.meshCount++;
+
+	// GL_COPY_WRITE_BUFFER does not touch the element buffer of the bound vertex array
+	const unsigned int stride = m_layout.GetStride();
+	GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, m_vb->GetRendererID());
+	GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)vertexRange.offset * stride, (GLsizeiptr)vertexCount * stride, vertices));
+	GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, m_ib->GetRendererID());
+	GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)indexRange.offset * sizeof(unsigned int), (GLsizeiptr)indexCount * sizeof(unsigned int), indices));
+	GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return id;
+}
+
+/**
+ * @brief Removes a mesh and frees its ranges. The ID may be reused by a later Add.
+ *
+ * @param id ID of a live mesh.
+ */
+void BufferHeap::Remove(MeshID id)
+{
+	ASSERT(id < m_meshes.size() && m_meshes[id].live);
+	if (id >= m_meshes.size() || !m_meshes[id].live)
+		return;
+
+	MeshSlot& slot = m_meshes[id];
+	m_vertexAllocator.Free(slot.vertices);
+	m_indexAllocator.Free(slot.indices);
+	slot = MeshSlot();
+	m_freeIDs.push_back(id);
+	m_stats.meshCount--;
+}
+
+/**
+ * @brief Gets where a mesh currently lives in the buffers.
+ *
+ * @param id ID of a live mesh.
+ * @return const HeapMesh& Ranges of the mesh, valid until the next Add, Defragment or Grow.
+ */
+const HeapMesh& BufferHeap::Get(MeshID id) const
+{
+	ASSERT(id < m_meshes.size() && m_meshes[id].live);
+	return m_meshes[id].mesh;
+}
+
+/**
+ * @brief Records a draw of a mesh into an IndirectDrawBuffer.
+ *
+ * @param draws The buffer to record into.
+ * @param id ID of a live mesh.
+ * @param instanceCount Number of instances to draw.
+ * @return unsigned int The first instance row of the draw, where its per-draw data goes.
+ */
+unsigned int BufferHeap::AddDraw(IndirectDrawBuffer& draws, MeshID id, unsigned int instanceCount) const
+{
+	const HeapMesh& mesh = Get(id);
+	return draws.AddDraw(mesh.indexCount, mesh.firstIndex, (int)mesh.baseVertex, instanceCount);
+}
+
+/**
+ * @brief Packs the live meshes at the start of the buffers, leaving the free space in one range.
+ */
+void BufferHeap::Defragment()
+{
+	Rebuild(m_vertexAllocator.GetSize(), m_indexAllocator.GetSize());
+}
+
+/**
+ * @brief Reallocates the buffers with a larger capacity, packing the live meshes at their start.
+ *
+ * @param vertexCapacity New size of the vertex buffer in vertices, at least the used vertices.
+ * @param indexCapacity New size of the index buffer in indices, at least the used indices.
+ */
+void BufferHeap::Grow(unsigned int vertexCapacity, unsigned int indexCapacity)
+{
+	const Stats stats = GetStats();
+	ASSERT(vertexCapacity >= stats.usedVertices && indexCapacity >= stats.usedIndices);
+	Rebuild(std::max(vertexCapacity, stats.usedVertices), std::max(indexCapacity, stats.usedIndices));
+	m_stats.growCount++;
+}
+
+/**
+ * @brief Gets the occupancy of the heap and its counters.
+ *
+ * @return Stats The statistics.
+ */
+BufferHeap::Stats BufferHeap::GetStats() const
+{
+	const OffsetAllocator::Stats vertexStats = m_vertexAllocator.GetStats();
+	const OffsetAllocator::Stats indexStats = m_indexAllocator.GetStats();
+
+	Stats stats = m_stats;
+	stats.vertexCapacity = m_vertexAllocator.GetSize();
+	stats.usedVertices = stats.vertexCapacity - vertexStats.freeSize;
+	stats.indexCapacity = m_indexAllocator.GetSize();
+	stats.usedIndices = stats.indexCapacity - indexStats.freeSize;
+	stats.freeVertexRanges = vertexStats.freeRangeCount;
+	return stats;
+}
+
+/**
+ * @brief Creates an empty index buffer with the vertex array of the heap bound.
+ *
+ * IndexBuffer binds itself to GL_ELEMENT_ARRAY_BUFFER, which is vertex array state. With the
+ * heap's own vertex array bound, the binding lands where the heap's draws expect it instead of
+ * in whatever vertex array was bound when the heap grew, such as the one of BatchRenderer2D.
+ *
+ * @param indexCapacity Size of the index buffer, in indices.
+ * @return IndexBuffer* The new index buffer.
+ */
+IndexBuffer* BufferHeap::CreateIndexBuffer(unsigned int indexCapacity)
+{
+	m_va.Bind();
+	return new IndexBuffer(nullptr, indexCapacity);
+}
+
+/**
+ * @brief Allocates new buffers and allocators and copies the live meshes to their start,
+ * in their current vertex order.
+ *
+ * The copies run on the GPU in command order, so draws already issued from the old buffers
+ * are unaffected, and the driver keeps the old storage alive until they are done.
+ *
+ * @param vertexCapacity Size of the new vertex buffer, in vertices.
+ * @param indexCapacity Size of the new index buffer, in indices.
+ */
+void BufferHeap::Rebuild(unsigned int vertexCapacity, unsigned int indexCapacity)
+{
+	std::vector<MeshID> order;
+	order.reserve(m_stats.meshCount);
+	for (MeshID id = 0; id < m_meshes.size(); id++) {
+		if (m_meshes[id].live)
+			order.push_back(id);
+	}
+	std::sort(order.begin(), order.end(), [this](MeshID a, MeshID b) {
+		return m_meshes[a].vertices.offset < m_meshes[b].vertices.offset;
+	});
+
+	const unsigned int stride = m_layout.GetStride();
+	std::unique_ptr<VertexBuffer> vb(new VertexBuffer(nullptr, vertexCapacity * stride));
+	std::unique_ptr<IndexBuffer> ib(CreateIndexBuffer(indexCapacity));
+	OffsetAllocator vertexAllocator(vertexCapacity, m_maxMeshes);
+	OffsetAllocator indexAllocator(indexCapacity, m_maxMeshes);
+
+	// A fresh allocator hands out consecutive ranges from offset 0
+	GLStateCache::BindBuffer(GL_COPY_READ_BUFFER, m_vb->GetRendererID());
+	GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, vb->GetRendererID());
+	for (MeshID id : order) {
+		MeshSlot& slot = m_meshes[id];
+		const OffsetAllocation range = vertexAllocator.Allocate(slot.mesh.vertexCount);
+		GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)slot.vertices.offset * stride,
+			(GLintptr)range.offset * stride, (GLsizeiptr)slot.mesh.vertexCount * stride));
+		slot.vertices = range;
+		slot.mesh.baseVertex = range.offset;
+	}
+
+	GLStateCache::BindBuffer(GL_COPY_READ_BUFFER, m_ib->GetRendererID());
+	GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, ib->GetRendererID());
+	for (MeshID id : order) {
+		MeshSlot& slot = m_meshes[id];
+		const OffsetAllocation range = indexAllocator.Allocate(slot.mesh.indexCount);
+		GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)slot.indices.offset * sizeof(unsigned int),
+			(GLintptr)range.offset * sizeof(unsigned int), (GLsizeiptr)slot.mesh.indexCount * sizeof(unsigned int)));
+		slot.indices = range;
+		slot.mesh.firstIndex = range.offset;
+	}
+	GLStateCache::BindBuffer(GL_COPY_READ_BUFFER, 0);
+	GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	m_vb = std::move(vb);
+	m_ib = std::move(ib);
+	m_vertexAllocator = std::move(vertexAllocator);
+	m_indexAllocator = std::move(indexAllocator);
+
+	// Point the existing attributes at the new buffer, the vertex array keeps its ID
+	m_va.AddBuffer(*m_vb, m_layout, 0);
+	m_stats.defragmentCount++;
+}
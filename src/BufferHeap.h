@@ -0,0 +1,183 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "OffsetAllocator.h"
+#include "VertexArray.h"
+#include "VertexBufferLayout.h"
+#include "IndexBuffer.h"
+
+class IndirectDrawBuffer;
+
+/**
+ * @brief Where a mesh of a BufferHeap lives in the heap's shared buffers.
+ */
+struct HeapMesh {
+	unsigned int baseVertex = 0;  ///< Offset of the first vertex of the mesh, in vertices.
+	unsigned int vertexCount = 0; ///< Number of vertices of the mesh.
+	unsigned int firstIndex = 0;  ///< Offset of the first index of the mesh, in indices.
+	unsigned int indexCount = 0;  ///< Number of indices of the mesh.
+};
+
+/**
+ * @brief BufferHeap class that packs many small meshes of one vertex format into a single
+ * vertex buffer and a single index buffer.
+ *
+ * Each mesh is a range of both buffers handed out by an OffsetAllocator, so meshes can be
+ * added and removed at any time in constant time. Indices stay relative to the mesh's first
+ * vertex and draws pass baseVertex and firstIndex, so one vertex array serves every mesh of
+ * the heap and any set of them can be merged into one IndirectDrawBuffer, with no vertex array
+ * or buffer bind between draws.
+ *
+ * When a mesh does not fit, the heap first defragments if there is enough free space in
+ * total, and otherwise grows. Both rebuild the buffers with the live meshes packed at the
+ * start, copied on the GPU with glCopyBufferSubData. Meshes keep their ID but move, so HeapMesh
+ * ranges must be fetched again after Add, Defragment or Grow.
+ */
+class BufferHeap {
+public:
+	typedef unsigned int MeshID; ///< Identifies a mesh of the heap.
+	static const MeshID InvalidMesh = 0xFFFFFFFF; ///< ID returned when a mesh could not be added.
+
+	/**
+	 * @brief Occupancy of the heap and counters since construction.
+	 */
+	struct Stats {
+		unsigned int meshCount = 0;        ///< Number of live meshes.
+		unsigned int vertexCapacity = 0;   ///< Size of the vertex buffer, in vertices.
+		unsigned int usedVertices = 0;     ///< Vertices used by live meshes.
+		unsigned int indexCapacity = 0;    ///< Size of the index buffer, in indices.
+		unsigned int usedIndices = 0;      ///< Indices used by live meshes.
+		unsigned int freeVertexRanges = 0; ///< Number of free ranges of the vertex buffer, 1 when not fragmented.
+		unsigned int defragmentCount = 0;  ///< Times the buffers were compacted, including growths.
+		unsigned int growCount = 0;        ///< Times the buffers were reallocated larger.
+	};
+
+private:
+	/**
+	 * @brief A mesh and the allocations backing it.
+	 */
+	struct MeshSlot {
+		HeapMesh mesh;              ///< Ranges of the mesh.
+		OffsetAllocation vertices;  ///< Allocation in the vertex buffer.
+		OffsetAllocation indices;   ///< Allocation in the index buffer.
+		bool live = false;          ///< Whether the slot holds a mesh.
+	};
+
+	VertexBufferLayout m_layout; ///< Per-vertex layout of every mesh
+	unsigned int m_maxMeshes; ///< Maximum number of live meshes
+	VertexArray m_va; ///< Vertex array reading m_vb with m_layout, created first so m_ib can be bound to it
+	std::unique_ptr<VertexBuffer> m_vb; ///< Shared vertex buffer
+	std::unique_ptr<IndexBuffer> m_ib; ///< Shared index buffer
+	OffsetAllocator m_vertexAllocator; ///< Allocator of m_vb, in vertices
+	OffsetAllocator m_indexAllocator; ///< Allocator of m_ib, in indices
+	std::vector<MeshSlot> m_meshes; ///< Meshes indexed by ID
+	std::vector<MeshID> m_freeIDs; ///< IDs of the empty slots of m_meshes
+	Stats m_stats; ///< Counters since construction
+
+public:
+	/**
+	 * @brief Constructs a BufferHeap and allocates its buffers.
+	 *
+	 * @param layout Per-vertex layout shared by every mesh of the heap.
+	 * @param vertexCapacity Initial size of the vertex buffer, in vertices.
+	 * @param indexCapacity Initial size of the index buffer, in indices.
+	 * @param maxMeshes Maximum number of live meshes.
+	 */
+	BufferHeap(const VertexBufferLayout& layout, unsigned int vertexCapacity, unsigned int indexCapacity, unsigned int maxMeshes = 4096);
+
+	BufferHeap(const BufferHeap&) = delete;
+	BufferHeap& operator=(const BufferHeap&) = delete;
+
+	/**
+	 * @brief Copies a mesh into the heap, defragmenting or growing the buffers if needed.
+	 *
+	 * @param vertices Pointer to vertexCount vertices in the layout of the heap.
+	 * @param vertexCount Number of vertices, greater than 0.
+	 * @param indices Pointer to indexCount indices, relative to the first vertex of the mesh.
+	 * @param indexCount Number of indices, greater than 0.
+	 * @return MeshID ID of the mesh, InvalidMesh if the maximum number of meshes is reached.
+	 */
+	MeshID Add(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+
+	/**
+	 * @brief Removes a mesh and frees its ranges. The ID may be reused by a later Add.
+	 *
+	 * @param id ID of a live mesh.
+	 */
+	void Remove(MeshID id);
+
+	/**
+	 * @brief Gets where a mesh currently lives in the buffers.
+	 *
+	 * @param id ID of a live mesh.
+	 * @return const HeapMesh& Ranges of the mesh, valid until the next Add, Defragment or Grow.
+	 */
+	const HeapMesh& Get(MeshID id) const;
+
+	/**
+	 * @brief Records a draw of a mesh into an IndirectDrawBuffer.
+	 *
+	 * The draws must be executed with the vertex array and index buffer of this heap.
+	 *
+	 * @param draws The buffer to record into.
+	 * @param id ID of a live mesh.
+	 * @param instanceCount Number of instances to draw.
+	 * @return unsigned int The first instance row of the draw, where its per-draw data goes.
+	 */
+	unsigned int AddDraw(IndirectDrawBuffer& draws, MeshID id, unsigned int instanceCount = 1) const;
+
+	/**
+	 * @brief Packs the live meshes at the start of the buffers, leaving the free space in one range.
+	 */
+	void Defragment();
+
+	/**
+	 * @brief Reallocates the buffers with a larger capacity, packing the live meshes at their start.
+	 *
+	 * @param vertexCapacity New size of the vertex buffer in vertices, at least the used vertices.
+	 * @param indexCapacity New size of the index buffer in indices, at least the used indices.
+	 */
+	void Grow(unsigned int vertexCapacity, unsigned int indexCapacity);
+
+	/**
+	 * @brief Gets the vertex array that reads every mesh of the heap.
+	 *
+	 * @return const VertexArray& The vertex array.
+	 */
+	inline const VertexArray& GetVertexArray() const { return m_va; }
+
+	/**
+	 * @brief Gets the index buffer shared by every mesh of the heap.
+	 *
+	 * @return const IndexBuffer& The index buffer.
+	 */
+	inline const IndexBuffer& GetIndexBuffer() const { return *m_ib; }
+
+	/**
+	 * @brief Gets the occupancy of the heap and its counters.
+	 *
+	 * @return Stats The statistics.
+	 */
+	Stats GetStats() const;
+
+private:
+	/**
+	 * @brief Creates an empty index buffer with the vertex array of the heap bound, so binding it
+	 * to GL_ELEMENT_ARRAY_BUFFER does not replace the element buffer of another vertex array.
+	 *
+	 * @param indexCapacity Size of the index buffer, in indices.
+	 * @return IndexBuffer* The new index buffer.
+	 */
+	IndexBuffer* CreateIndexBuffer(unsigned int indexCapacity);
+
+	/**
+	 * @brief Allocates new buffers and allocators and copies the live meshes to their start,
+	 * in their current vertex order.
+	 *
+	 * @param vertexCapacity Size of the new vertex buffer, in vertices.
+	 * @param indexCapacity Size of the new index buffer, in indices.
+	 */
+	void Rebuild(unsigned int vertexCapacity, unsigned int indexCapacity);
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Renderer.h"
+#include "UniformId.h"
+#include "glm/glm.hpp"
+
+class Texture;
+
+/**
+ * @brief Kinds of commands stored in a CommandList.
+ */
+enum class CommandType : uint8_t {
+	BindShader,
+	BindTexture,
+	SetState,
+	SetUniform1i,
+	SetUniform4f,
+	SetUniformMat4f,
+	Draw,
+};
+
+/// Payload of CommandType::BindShader.
+struct BindShaderCommand {
+	Shader* shader;
+};
+
+/// Payload of CommandType::BindTexture.
+struct BindTextureCommand {
+	const Texture* texture;
+	unsigned int slot;
+};
+
+/// Payload of CommandType::SetUniform1i. The uniform belongs to the last bound shader.
+struct SetUniform1iCommand {
+	UniformId name;
+	int value;
+};
+
+/// Payload of CommandType::SetUniform4f. The uniform belongs to the last bound shader.
+struct SetUniform4fCommand {
+	UniformId name;
+	glm::vec4 value;
+};
+
+/// Payload of CommandType::SetUniformMat4f. The uniform belongs to the last bound shader.
+struct SetUniformMat4fCommand {
+	UniformId name;
+	glm::mat4 value;
+};
+
+/// Payload of CommandType::Draw. Draws with the last bound shader.
+struct DrawCommand {
+	const VertexArray* va;
+	const IndexBuffer* ib;
+	unsigned int instanceCount; ///< 0 for a non-instanced draw.
+};
+
+/**
+ * @brief CommandList class that records rendering commands for later execution.
+ *
+ * Recording only appends to a byte stream and never touches OpenGL, so any thread can record
+ * its own CommandList. Renderer::Execute replays lists on the thread that owns the context.
+ * Commands refer to engine objects and uniform names by pointer, which must stay alive (and,
+ * for names, unchanged) until the list has been executed.
+ */
+class CommandList {
+private:
+	std::vector<unsigned char> m_buffer; ///< Packed commands, each a CommandType followed by its payload
+	unsigned int m_commandCount; ///< Number of recorded commands
+
+public:
+	/**
+	 * @brief Constructs an empty CommandList.
+	 */
+	CommandList()
+		: m_commandCount(0) {}
+
+	/**
+	 * @brief Records binding a shader. Following uniform and draw commands use it.
+	 *
+	 * @param shader The shader to bind.
+	 */
+	void BindShader(Shader& shader) { Write(CommandType::BindShader, BindShaderCommand{ &shader }); }
+
+	/**
+	 * @brief Records binding a texture to a texture slot.
+	 *
+	 * @param texture The texture to bind.
+	 * @param slot The texture slot to bind it to.
+	 */
+	void BindTexture(const Texture& texture, unsigned int slot = 0) { Write(CommandType::BindTexture, BindTextureCommand{ &texture, slot }); }
+
+	/**
+	 * @brief Records changing the fixed-function state. The depth field is ignored.
+	 *
+	 * @param state The state to apply.
+	 */
+	void SetState(const RenderState& state) { Write(CommandType::SetState, state); }
+
+	/**
+	 * @brief Records setting an integer uniform of the last bound shader.
+	 *
+	 * @param name The hashed name of the uniform, such as "u_MVP"_u. The name must outlive the execution of the list.
+	 * @param value The value to set.
+	 */
+	void SetUniform1i(UniformId name, int value) { Write(CommandType::SetUniform1i, SetUniform1iCommand{ name, value }); }
+
+	/**
+	 * @brief Records setting a vec4 uniform of the last bound shader.
+	 *
+	 * @param name The hashed name of the uniform, such as "u_MVP"_u. The name must outlive the execution of the list.
+	 * @param value The value to set.
+	 */
+	void SetUniform4f(UniformId name, const glm::vec4& value) { Write(CommandType::SetUniform4f, SetUniform4fCommand{ name, value }); }
+
+	/**
+	 * @brief Records setting a mat4 uniform of the last bound shader.
+	 *
+	 * @param name The hashed name of the uniform, such as "u_MVP"_u. The name must outlive the execution of the list.
+	 * @param value The value to set.
+	 */
+	void SetUniformMat4f(UniformId name, const glm::mat4& value) { Write(CommandType::SetUniformMat4f, SetUniformMat4fCommand{ name, value }); }
+
+	/**
+	 * @brief Records drawing a vertex array with the last bound shader.
+	 *
+	 * @param va The vertex array to draw.
+	 * @param ib The index buffer to use for drawing.
+	 * @param instanceCount Number of instances to draw, 0 for a non-instanced draw.
+	 */
+	void Draw(const VertexArray& va, const IndexBuffer& ib, unsigned int instanceCount = 0) { Write(CommandType::Draw, DrawCommand{ &va, &ib, instanceCount }); }
+
+	/**
+	 * @brief Removes all commands but keeps the allocated memory for the next frame.
+	 */
+	void Reset()
+	{
+		m_buffer.clear();
+		m_commandCount = 0;
+	}
+
+	/**
+	 * @brief Gets the packed command stream.
+	 *
+	 * @return const std::vector<unsigned char>& The commands.
+	 */
+	inline const std::vector<unsigned char>& GetBuffer() const { return m_buffer; }
+
+	/**
+	 * @brief Gets the number of recorded commands.
+	 *
+	 * @return unsigned int Number of commands.
+	 */
+	inline unsigned int GetCommandCount() const { return m_commandCount; }
+
+	/**
+	 * @brief Reads the payload of a command from the stream.
+	 *
+	 * @tparam T Payload type of the command.
+	 * @param offset Offset of the payload, advanced past it.
+	 * @return T The payload.
+	 */
+	template<typename T>
+	T Read(size_t& offset) const
+	{
+		T payload;
+		std::memcpy(&payload, m_buffer.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return payload;
+	}
+
+private:
+	/**
+	 * @brief Appends a command to the stream.
+	 *
+	 * @tparam T Payload type of the command.
+	 * @param type Kind of the command.
+	 * @param payload Payload of the command.
+	 */
+	template<typename T>
+	void Write(CommandType type, const T& payload)
+	{
+		const size_t offset = m_buffer.size();
+		m_buffer.resize(offset + 1 + sizeof(T));
+		m_buffer[offset] = (unsigned char)type;
+		std::memcpy(m_buffer.data() + offset + 1, &payload, sizeof(T));
+		m_commandCount++;
+	}
+};
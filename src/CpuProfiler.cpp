@@ -0,0 +1,224 @@
+#include "CpuProfiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief A zone recorded by a thread.
+ */
+struct ProfileEvent {
+	const char* name; ///< Name of the zone.
+	int64_t start;    ///< Start of the zone, in nanoseconds.
+	int64_t end;      ///< End of the zone, in nanoseconds.
+};
+
+/**
+ * @brief Zones of one thread. Only the owning thread writes to it.
+ */
+struct ProfileThreadBuffer {
+	std::vector<ProfileEvent> events;       ///< EventsPerThread slots
+	std::atomic<unsigned int> count{ 0 };   ///< Number of slots written in this capture, published with release
+	std::atomic<unsigned int> capture{ 0 }; ///< Capture the slots belong to
+	std::atomic<unsigned int> dropped{ 0 }; ///< Zones that did not fit in this capture
+	std::atomic<const char*> name{ nullptr }; ///< Name of the thread, or nullptr
+};
+
+/// Every buffer ever created, so threads that exited still show up in the trace.
+static std::vector<std::unique_ptr<ProfileThreadBuffer>> s_buffers;
+/// Guards s_buffers, only taken when a thread records its first zone or a trace is written.
+static std::mutex s_buffersMutex;
+/// Index of the current capture, odd while capturing.
+static std::atomic<unsigned int> s_capture{ 0 };
+/// Time BeginCapture was called, the origin of exported timestamps.
+static std::atomic<int64_t> s_captureStart{ 0 };
+/// Buffer of the calling thread.
+static thread_local ProfileThreadBuffer* t_buffer = nullptr;
+
+/**
+ * @brief Gets the buffer of the calling thread, creating it on first use.
+ *
+ * @return ProfileThreadBuffer& The buffer.
+ */
+static ProfileThreadBuffer& GetThreadBuffer()
+{
+	if (!t_buffer) {
+		std::unique_ptr<ProfileThreadBuffer> buffer(new ProfileThreadBuffer());
+		buffer->events.resize(CpuProfiler::EventsPerThread);
+		t_buffer = buffer.get();
+
+		std::lock_guard<std::mutex> lock(s_buffersMutex);
+		s_buffers.push_back(std::move(buffer));
+	}
+	return *t_buffer;
+}
+
+/**
+ * @brief Writes a string as a JSON string literal.
+ *
+ * @param stream The stream to write to.
+ * @param text The string.
+ */
+static void WriteJsonString(std::ostream& stream, const char* text)
+{
+	stream << '"';
+	for (const char* c = text; *c; c++) {
+		if (*c == '"' || *c == '\\')
+			stream << '\\';
+		stream << *c;
+	}
+	stream << '"';
+}
+
+/**
+ * @brief Discards the previous capture and starts recording zones.
+ */
+void CpuProfiler::BeginCapture()
+{
+	if (IsCapturing())
+		return;
+
+	s_captureStart.store(Now(), std::memory_order_relaxed);
+	// Buffers notice the new capture index and reset themselves on their next zone
+	s_capture.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Stops recording zones. Zones that already began are still recorded when they end.
+ */
+void CpuProfiler::EndCapture()
+{
+	if (IsCapturing())
+		s_capture.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Tells whether zones are being recorded.
+ *
+ * @return true between BeginCapture and EndCapture.
+ */
+bool CpuProfiler::IsCapturing()
+{
+	return (s_capture.load(std::memory_order_relaxed) & 1) != 0;
+}
+
+/**
+ * @brief Writes the zones of the last capture as Chrome trace_event JSON.
+ *
+ * @param path Path of the JSON file.
+ * @return true if the file was written.
+ */
+bool CpuProfiler::WriteChromeTrace(const std::string& path)
+{
+	std::ofstream stream(path);
+	if (!stream) {
+		std::cout << "Failed to write profile " << path << std::endl;
+		return false;
+	}
+
+	// Zones recorded after EndCapture still carry the index of the capture they began in
+	const unsigned int capture = s_capture.load(std::memory_order_acquire) | 1;
+	const unsigned int lastCapture = IsCapturing() ? capture : capture - 2;
+	const int64_t origin = s_captureStart.load(std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+	stream << std::fixed << std::setprecision(3); // Microseconds with nanosecond precision
+	stream << "{\"traceEvents\":[";
+	bool first = true;
+	for (size_t tid = 0; tid < s_buffers.size(); tid++) {
+		const ProfileThreadBuffer& buffer = *s_buffers[tid];
+		if (const char* name = buffer.name.load(std::memory_order_relaxed)) {
+			stream << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid
+				<< ",\"args\":{\"name\":";
+			WriteJsonString(stream, name);
+			stream << "}}";
+			first = false;
+		}
+
+		if (buffer.capture.load(std::memory_order_acquire) != lastCapture)
+			continue;
+
+		const unsigned int count = buffer.count.load(std::memory_order_acquire);
+		for (unsigned int i = 0; i < count; i++) {
+			const ProfileEvent& event = buffer.events[i];
+			stream << (first ? "" : ",") << "\n{\"name\":";
+			WriteJsonString(stream, event.name);
+			stream << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+				<< ",\"ts\":" << (event.start - origin) / 1000.0
+				<< ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+			first = false;
+		}
+	}
+	stream << "\n]}\n";
+	return (bool)stream;
+}
+
+/**
+ * @brief Names the calling thread in exported traces.
+ *
+ * @param name Name of the thread, which must stay valid until the trace is written.
+ */
+void CpuProfiler::SetThreadName(const char* name)
+{
+	GetThreadBuffer().name.store(name, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Records a zone of the calling thread.
+ *
+ * @param name Name of the zone, which must stay valid until the trace is written.
+ * @param start Start of the zone, from Now.
+ * @param end End of the zone, from Now.
+ */
+void CpuProfiler::Record(const char* name, int64_t start, int64_t end)
+{
+	ProfileThreadBuffer& buffer = GetThreadBuffer();
+
+	// A zone that began during the capture and ends after it belongs to that capture
+	unsigned int capture = s_capture.load(std::memory_order_acquire);
+	if (!(capture & 1))
+		capture--;
+	if (buffer.capture.load(std::memory_order_relaxed) != capture) {
+		buffer.count.store(0, std::memory_order_relaxed);
+		buffer.dropped.store(0, std::memory_order_relaxed);
+		buffer.capture.store(capture, std::memory_order_release);
+	}
+
+	const unsigned int index = buffer.count.load(std::memory_order_relaxed);
+	if (index == EventsPerThread) {
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.events[index] = { name, start, end };
+	buffer.count.store(index + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Gets the current time of the profiler clock.
+ *
+ * @return int64_t Time in nanoseconds.
+ */
+int64_t CpuProfiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Gets the number of zones dropped because a thread's buffer was full.
+ *
+ * @return unsigned int Number of dropped zones in the last capture.
+ */
+unsigned int CpuProfiler::GetDroppedCount()
+{
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+	unsigned int dropped = 0;
+	for (const std::unique_ptr<ProfileThreadBuffer>& buffer : s_buffers)
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+	return dropped;
+}
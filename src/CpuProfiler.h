@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+ * CPU profiling.
+ *
+ * MOTOR_PROFILE selects whether PROFILE_SCOPE and PROFILE_FUNCTION are compiled in. They are
+ * by default, in every configuration: outside of a capture a zone costs one relaxed atomic
+ * load, so production builds can still be profiled. Define MOTOR_PROFILE to 0 to remove them.
+ */
+#ifndef MOTOR_PROFILE
+	#define MOTOR_PROFILE 1
+#endif
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if MOTOR_PROFILE
+	#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name) // Profile until the end of the scope
+	#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#else
+	#define PROFILE_SCOPE(name) do { } while (0)
+	#define PROFILE_FUNCTION() do { } while (0)
+#endif
+
+/**
+ * @brief CpuProfiler class that records timed zones of every thread and exports them as a
+ * Chrome trace (chrome://tracing, Perfetto).
+ *
+ * Each thread writes its zones into its own fixed-size buffer, which only that thread ever
+ * modifies, so recording takes no lock. Zones are only recorded between BeginCapture and
+ * EndCapture; a thread whose buffer is full drops further zones until the next capture.
+ */
+class CpuProfiler {
+public:
+	/// Number of zones each thread can record per capture.
+	static const unsigned int EventsPerThread = 1 << 16;
+
+	/**
+	 * @brief Discards the previous capture and starts recording zones.
+	 */
+	static void BeginCapture();
+
+	/**
+	 * @brief Stops recording zones. Zones that already began are still recorded when they end.
+	 */
+	static void EndCapture();
+
+	/**
+	 * @brief Tells whether zones are being recorded.
+	 *
+	 * @return true between BeginCapture and EndCapture.
+	 */
+	static bool IsCapturing();
+
+	/**
+	 * @brief Writes the zones of the last capture as Chrome trace_event JSON.
+	 *
+	 * Should be called after EndCapture, once the zones of interest have ended.
+	 *
+	 * @param path Path of the JSON file.
+	 * @return true if the file was written.
+	 */
+	static bool WriteChromeTrace(const std::string& path);
+
+	/**
+	 * @brief Names the calling thread in exported traces.
+	 *
+	 * @param name Name of the thread, which must stay valid until the trace is written.
+	 */
+	static void SetThreadName(const char* name);
+
+	/**
+	 * @brief Records a zone of the calling thread.
+	 *
+	 * @param name Name of the zone, which must stay valid until the trace is written.
+	 * @param start Start of the zone, from Now.
+	 * @param end End of the zone, from Now.
+	 */
+	static void Record(const char* name, int64_t start, int64_t end);
+
+	/**
+	 * @brief Gets the current time of the profiler clock.
+	 *
+	 * @return int64_t Time in nanoseconds.
+	 */
+	static int64_t Now();
+
+	/**
+	 * @brief Gets the number of zones dropped because a thread's buffer was full.
+	 *
+	 * @return unsigned int Number of dropped zones in the last capture.
+	 */
+	static unsigned int GetDroppedCount();
+};
+
+/**
+ * @brief CpuProfileScope class that records a zone from its construction to its destruction.
+ *
+ * Use through PROFILE_SCOPE and PROFILE_FUNCTION.
+ */
+class CpuProfileScope {
+private:
+	const char* m_name; ///< Name of the zone, nullptr if no capture was running when it began
+	int64_t m_start; ///< Start of the zone
+
+public:
+	/**
+	 * @brief Begins a zone if a capture is running.
+	 *
+	 * @param name Name of the zone. String literals are expected.
+	 */
+	CpuProfileScope(const char* name)
+		: m_name(CpuProfiler::IsCapturing() ? name : nullptr), m_start(m_name ? CpuProfiler::Now() : 0) {}
+
+	/**
+	 * @brief Ends the zone.
+	 */
+	~CpuProfileScope()
+	{
+		if (m_name)
+			CpuProfiler::Record(m_name, m_start, CpuProfiler::Now());
+	}
+
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+};
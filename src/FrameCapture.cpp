@@ -0,0 +1,331 @@
+#include "FrameCapture.h"
+#include "Framebuffer.h"
+#include "Renderer.h"
+#include "GLStateCache.h"
+#include "CpuProfiler.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+/**
+ * @brief Constructs a FrameCapture and starts its worker.
+ *
+ * @param encoder Called on the worker thread for every captured frame, in capture order.
+ * @param ringSize Number of pixel pack buffers, the number of reads that can be in flight.
+ */
+FrameCapture::FrameCapture(const Encoder& encoder, unsigned int ringSize)
+	: m_slots(ringSize > 0 ? ringSize : 1), m_oldest(0), m_pending(0), m_encoder(encoder), m_encoding(false), m_stop(false)
+{
+	for (Slot& slot : m_slots) {
+		GLCall(glGenBuffers(1, &slot.buffer));
+	}
+	m_worker = std::thread(&FrameCapture::WorkerLoop, this);
+}
+
+/**
+ * @brief Finishes every capture, stops the worker and deletes the pixel pack buffers.
+ */
+FrameCapture::~FrameCapture()
+{
+	Finish();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_changed.notify_all();
+	m_worker.join();
+
+	for (Slot& slot : m_slots) {
+		GLCall(glDeleteBuffers(1, &slot.buffer));
+		GLStateCache::OnBufferDeleted(slot.buffer);
+	}
+}
+
+/**
+ * @brief Starts reading back the first color attachment of a framebuffer.
+ *
+ * @param framebuffer The framebuffer.
+ * @param frameIndex Index passed on to the encoder.
+ */
+void FrameCapture::Capture(const Framebuffer& framebuffer, uint64_t frameIndex)
+{
+	const FramebufferSpec& spec = framebuffer.GetSpec();
+	Read(framebuffer.GetResolvedRendererID(), GL_COLOR_ATTACHMENT0, spec.width, spec.height, frameIndex);
+}
+
+/**
+ * @brief Starts reading back the back buffer of the default framebuffer. Call before swapping.
+ *
+ * @param width Width of the default framebuffer.
+ * @param height Height of the default framebuffer.
+ * @param frameIndex Index passed on to the encoder.
+ */
+void FrameCapture::CaptureBackbuffer(int width, int height, uint64_t frameIndex)
+{
+	Read(0, GL_BACK, width, height, frameIndex);
+}
+
+/**
+ * @brief Hands every read back that has completed to the encoder, without waiting.
+ */
+void FrameCapture::Poll()
+{
+	// Fences signal in submission order, so the first one still pending ends the scan
+	while (m_pending > 0 && ResolveOldest(false)) {
+	}
+	for (Slot& slot : m_slots)
+		Unmap(slot, false);
+}
+
+/**
+ * @brief Waits for every pending read back and for the encoder to finish them.
+ */
+void FrameCapture::Finish()
+{
+	while (m_pending > 0)
+		ResolveOldest(true);
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_changed.wait(lock, [this] { return m_queue.empty() && !m_encoding; });
+	}
+	for (Slot& slot : m_slots)
+		Unmap(slot, true);
+}
+
+/**
+ * @brief Gets the capture statistics.
+ *
+ * @return Stats A copy of the statistics.
+ */
+FrameCapture::Stats FrameCapture::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+/**
+ * @brief Writes a captured frame as an uncompressed 32-bit TGA file.
+ *
+ * TGA stores BGRA pixels bottom row first, which is exactly how they are read back.
+ *
+ * @param path Path of the file.
+ * @param frame The frame.
+ * @return true if the file was written.
+ */
+bool FrameCapture::WriteTGA(const std::string& path, const CapturedFrame& frame)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	unsigned char header[18] = {};
+	header[2] = 2; // Uncompressed true color
+	header[12] = (unsigned char)(frame.width & 0xFF);
+	header[13] = (unsigned char)(frame.width >> 8);
+	header[14] = (unsigned char)(frame.height & 0xFF);
+	header[15] = (unsigned char)(frame.height >> 8);
+	header[16] = 32; // Bits per pixel
+	header[17] = 8;  // Alpha bits, origin at the bottom left
+	file.write((const char*)header, sizeof(header));
+	file.write((const char*)frame.pixels.data(), (std::streamsize)frame.pixels.size());
+	return (bool)file;
+}
+
+/**
+ * @brief Reads a color buffer of a framebuffer into the next slot.
+ *
+ * @param framebuffer Renderer ID of the framebuffer, 0 for the default one.
+ * @param readBuffer Color buffer to read.
+ * @param width Width of the area to read.
+ * @param height Height of the area to read.
+ * @param frameIndex Index passed on to the encoder.
+ */
+void FrameCapture::Read(unsigned int framebuffer, GLenum readBuffer, int width, int height, uint64_t frameIndex)
+{
+	PROFILE_FUNCTION();
+
+	// Every buffer is still in flight: the oldest read has to be waited for
+	if (m_pending == m_slots.size()) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stats.readbackStalls++;
+		}
+		ResolveOldest(true);
+	}
+
+	Slot& slot = m_slots[(m_oldest + m_pending) % m_slots.size()];
+	Unmap(slot, true);
+	const size_t size = (size_t)width * height * 4;
+	GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	if (slot.capacity < size) {
+		GLCall(glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ));
+		slot.capacity = size;
+	}
+
+	// The read framebuffer and its read buffer are put back afterwards
+	GLint previousFramebuffer = 0;
+	GLint previousReadBuffer = GL_NONE;
+	GLCall(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer));
+	GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer));
+	GLCall(glGetIntegerv(GL_READ_BUFFER, &previousReadBuffer));
+
+	// With a pack buffer bound the read only records a copy, it does not wait for the frame
+	GLCall(glReadBuffer(readBuffer));
+	GLCall(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+	GLCall(glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr));
+	GLCall(slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	GLCall(glReadBuffer((GLenum)previousReadBuffer));
+	GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, (unsigned int)previousFramebuffer));
+
+	slot.width = width;
+	slot.height = height;
+	slot.frameIndex = frameIndex;
+	m_pending++;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.capturedFrames++;
+}
+
+/**
+ * @brief Maps the oldest pending slot and queues its pixels for the worker.
+ *
+ * The worker copies the pixels out of the mapped buffer, so the render thread never touches
+ * them. A slot that cannot be mapped drops its frame.
+ *
+ * @param wait Whether to wait for the fence of the slot.
+ * @return true if the slot was resolved, false if its fence has not signalled yet.
+ */
+bool FrameCapture::ResolveOldest(bool wait)
+{
+	Slot& slot = m_slots[m_oldest];
+	if (wait) {
+		// Flush on the first wait, in case the fence has not been submitted yet
+		GLenum result;
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		do {
+			GLCall(result = glClientWaitSync(slot.fence, flags, 1000000000ull));
+			flags = 0;
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+	else {
+		GLenum result;
+		GLCall(result = glClientWaitSync(slot.fence, 0, 0));
+		if (result == GL_TIMEOUT_EXPIRED)
+			return false;
+	}
+	GLCall(glDeleteSync(slot.fence));
+	slot.fence = nullptr;
+
+	const unsigned int slotIndex = m_oldest;
+	m_oldest = (m_oldest + 1) % m_slots.size();
+	m_pending--;
+
+	const size_t size = (size_t)slot.width * slot.height * 4;
+	GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	GLCall(slot.mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+	GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (!slot.mapped) {
+		std::cout << "Warning: could not map the read back of frame " << slot.frameIndex << ", the frame is dropped" << std::endl;
+		return true;
+	}
+
+	QueuedFrame queued;
+	queued.frame.frameIndex = slot.frameIndex;
+	queued.frame.width = slot.width;
+	queued.frame.height = slot.height;
+	queued.mapped = slot.mapped;
+	queued.slot = slotIndex;
+	{
+		// Wait if the encoder has fallen too far behind
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_queue.size() >= MaxQueuedFrames) {
+			m_stats.encoderStalls++;
+			m_changed.wait(lock, [this] { return m_queue.size() < MaxQueuedFrames; });
+		}
+		slot.copied = false;
+		m_queue.push_back(std::move(queued));
+	}
+	m_changed.notify_all();
+	return true;
+}
+
+/**
+ * @brief Unmaps a slot once the worker has copied its pixels.
+ *
+ * @param slot The slot.
+ * @param wait Whether to wait for the worker.
+ * @return true if the slot is unmapped, false if the worker still reads it.
+ */
+bool FrameCapture::Unmap(Slot& slot, bool wait)
+{
+	if (!slot.mapped)
+		return true;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!slot.copied) {
+			if (!wait)
+				return false;
+			m_stats.encoderStalls++;
+			m_changed.wait(lock, [&slot] { return slot.copied; });
+		}
+	}
+
+	GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	GLCall(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+	GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.mapped = nullptr;
+	return true;
+}
+
+/**
+ * @brief Body of the worker thread.
+ */
+void FrameCapture::WorkerLoop()
+{
+	CpuProfiler::SetThreadName("FrameCapture");
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_changed.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+		if (m_queue.empty())
+			return;
+
+		QueuedFrame queued = std::move(m_queue.front());
+		m_queue.pop_front();
+		m_encoding = true;
+		CapturedFrame& frame = queued.frame;
+		if (!m_freePixels.empty()) {
+			frame.pixels.swap(m_freePixels.back());
+			m_freePixels.pop_back();
+		}
+		lock.unlock();
+
+		{
+			// Copied here rather than on the render thread, which unmaps the buffer afterwards
+			PROFILE_SCOPE("CopyFrame");
+			const size_t size = (size_t)frame.width * frame.height * 4;
+			frame.pixels.resize(size);
+			memcpy(frame.pixels.data(), queued.mapped, size);
+		}
+		lock.lock();
+		m_slots[queued.slot].copied = true;
+		m_changed.notify_all();
+		lock.unlock();
+
+		{
+			PROFILE_SCOPE("EncodeFrame");
+			m_encoder(frame);
+		}
+
+		lock.lock();
+		m_encoding = false;
+		m_stats.encodedFrames++;
+		m_freePixels.push_back(std::move(frame.pixels));
+		m_changed.notify_all();
+	}
+}
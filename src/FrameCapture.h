@@ -0,0 +1,189 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+class Framebuffer;
+
+/**
+ * @brief Pixels of a captured frame, handed to the encoder.
+ */
+struct CapturedFrame {
+	uint64_t frameIndex = 0;           ///< Index given to Capture.
+	int width = 0;                     ///< Width in pixels.
+	int height = 0;                    ///< Height in pixels.
+	std::vector<unsigned char> pixels; ///< BGRA8 pixels, bottom row first, as OpenGL reads them.
+};
+
+/**
+ * @brief FrameCapture class that reads frames back without stalling the render thread.
+ *
+ * Capture issues glReadPixels into the next pixel pack buffer of a ring and places a fence
+ * behind it, so the copy runs asynchronously on the GPU. Poll, called once per frame, maps
+ * the buffers whose fences have signalled, usually a frame or two later, and hands the mapped
+ * pixels to a worker thread that copies them out and runs the encoder; the buffer is unmapped
+ * by a later Poll once the worker is done with it. The render thread only waits when every
+ * buffer of the ring is still in flight or still being copied, or the encoder has fallen
+ * MaxQueuedFrames frames behind; both are counted as stalls.
+ *
+ * All methods must be called on the thread that owns the OpenGL context.
+ */
+class FrameCapture {
+public:
+	/// Turns a captured frame into a file or a stream. Runs on the worker thread.
+	typedef std::function<void(const CapturedFrame& frame)> Encoder;
+
+	/**
+	 * @brief Capture statistics.
+	 */
+	struct Stats {
+		unsigned int capturedFrames = 0; ///< Frames read back with Capture.
+		unsigned int encodedFrames = 0;  ///< Frames the encoder finished.
+		unsigned int readbackStalls = 0; ///< Captures that waited for a pixel buffer still in flight.
+		unsigned int encoderStalls = 0;  ///< Read backs that waited for the encoder to catch up.
+	};
+
+	/// Frames that may wait for the encoder before read backs wait for it.
+	static const unsigned int MaxQueuedFrames = 8;
+
+private:
+	/**
+	 * @brief A pixel pack buffer of the ring.
+	 */
+	struct Slot {
+		unsigned int buffer = 0;  ///< Renderer ID of the pixel pack buffer.
+		size_t capacity = 0;      ///< Size of the buffer's storage in bytes.
+		GLsync fence = nullptr;   ///< Fence placed after the read, nullptr when the slot is free.
+		int width = 0;            ///< Width of the pending read.
+		int height = 0;           ///< Height of the pending read.
+		uint64_t frameIndex = 0;  ///< Frame index of the pending read.
+		const void* mapped = nullptr; ///< Storage mapped for the worker, nullptr when unmapped.
+		bool copied = false;      ///< Whether the worker is done with mapped. Guarded by m_mutex.
+	};
+
+	/**
+	 * @brief A frame waiting for the worker.
+	 */
+	struct QueuedFrame {
+		CapturedFrame frame;  ///< The frame, pixels not copied yet.
+		const void* mapped;   ///< Mapped pixels of the frame.
+		unsigned int slot;    ///< Slot the pixels are mapped from.
+	};
+
+	std::vector<Slot> m_slots; ///< Ring of pixel pack buffers
+	unsigned int m_oldest; ///< Oldest slot with a pending read
+	unsigned int m_pending; ///< Number of slots with a pending read
+	Encoder m_encoder; ///< Encoder run by the worker
+
+	std::thread m_worker; ///< Thread running the encoder
+	std::mutex m_mutex; ///< Guards the fields below
+	std::condition_variable m_changed; ///< Signals queued, encoded and stop
+	std::deque<QueuedFrame> m_queue; ///< Frames waiting for the encoder
+	std::vector<std::vector<unsigned char>> m_freePixels; ///< Pixel vectors the encoder is done with, reused to avoid allocations
+	bool m_encoding; ///< Whether the worker is running the encoder
+	bool m_stop; ///< Whether the worker should exit
+	Stats m_stats; ///< Capture statistics
+
+public:
+	/**
+	 * @brief Constructs a FrameCapture and starts its worker.
+	 *
+	 * @param encoder Called on the worker thread for every captured frame, in capture order.
+	 * @param ringSize Number of pixel pack buffers, the number of reads that can be in flight.
+	 */
+	FrameCapture(const Encoder& encoder, unsigned int ringSize = 3);
+
+	/**
+	 * @brief Finishes every capture, stops the worker and deletes the pixel pack buffers.
+	 */
+	~FrameCapture();
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	/**
+	 * @brief Starts reading back the first color attachment of a framebuffer (the resolved
+	 * one with MSAA, which must be resolved first).
+	 *
+	 * @param framebuffer The framebuffer.
+	 * @param frameIndex Index passed on to the encoder.
+	 */
+	void Capture(const Framebuffer& framebuffer, uint64_t frameIndex);
+
+	/**
+	 * @brief Starts reading back the back buffer of the default framebuffer. Call before swapping.
+	 *
+	 * @param width Width of the default framebuffer.
+	 * @param height Height of the default framebuffer.
+	 * @param frameIndex Index passed on to the encoder.
+	 */
+	void CaptureBackbuffer(int width, int height, uint64_t frameIndex);
+
+	/**
+	 * @brief Hands every read back that has completed to the encoder, without waiting.
+	 */
+	void Poll();
+
+	/**
+	 * @brief Waits for every pending read back and for the encoder to finish them.
+	 */
+	void Finish();
+
+	/**
+	 * @brief Gets the capture statistics.
+	 *
+	 * @return Stats A copy of the statistics.
+	 */
+	Stats GetStats();
+
+	/**
+	 * @brief Writes a captured frame as an uncompressed 32-bit TGA file.
+	 *
+	 * @param path Path of the file.
+	 * @param frame The frame.
+	 * @return true if the file was written.
+	 */
+	static bool WriteTGA(const std::string& path, const CapturedFrame& frame);
+
+private:
+	/**
+	 * @brief Reads a color buffer of a framebuffer into the next slot.
+	 *
+	 * @param framebuffer Renderer ID of the framebuffer, 0 for the default one.
+	 * @param readBuffer Color buffer to read.
+	 * @param width Width of the area to read.
+	 * @param height Height of the area to read.
+	 * @param frameIndex Index passed on to the encoder.
+	 */
+	void Read(unsigned int framebuffer, GLenum readBuffer, int width, int height, uint64_t frameIndex);
+
+	/**
+	 * @brief Maps the oldest pending slot and queues its pixels for the worker.
+	 *
+	 * @param wait Whether to wait for the fence of the slot.
+	 * @return true if the slot was resolved, false if its fence has not signalled yet.
+	 */
+	bool ResolveOldest(bool wait);
+
+	/**
+	 * @brief Unmaps a slot once the worker has copied its pixels.
+	 *
+	 * @param slot The slot.
+	 * @param wait Whether to wait for the worker.
+	 * @return true if the slot is unmapped, false if the worker still reads it.
+	 */
+	bool Unmap(Slot& slot, bool wait);
+
+	/**
+	 * @brief Body of the worker thread.
+	 */
+	void WorkerLoop();
+};
@@ -0,0 +1,112 @@
+#include "FramePacer.h"
+#include "Renderer.h"
+#include "CpuProfiler.h"
+
+#include <chrono>
+
+/**
+ * @brief Constructs a FramePacer.
+ *
+ * @param maxFramesInFlight Number of frames the CPU may be ahead of the GPU, at least 1.
+ */
+FramePacer::FramePacer(unsigned int maxFramesInFlight)
+	: m_fences(maxFramesInFlight > 0 ? maxFramesInFlight : 1, nullptr), m_frame(0), m_inFrame(false)
+{
+}
+
+/**
+ * @brief Destroys the FramePacer and deletes its fences without waiting for them.
+ */
+FramePacer::~FramePacer()
+{
+	for (GLsync fence : m_fences) {
+		if (fence) {
+			GLCall(glDeleteSync(fence));
+		}
+	}
+}
+
+/**
+ * @brief Waits until the GPU has finished the frame that last used the current frame slot.
+ */
+void FramePacer::BeginFrame()
+{
+	PROFILE_FUNCTION();
+	ASSERT(!m_inFrame);
+
+	const double waitMs = WaitAndDelete(m_fences[GetFrameSlot()]);
+	m_stats.frameCount++;
+	m_stats.lastWaitMs = waitMs;
+	if (waitMs > 0.0) {
+		m_stats.waitCount++;
+		m_stats.totalWaitMs += waitMs;
+		if (waitMs > m_stats.maxWaitMs)
+			m_stats.maxWaitMs = waitMs;
+	}
+	m_inFrame = true;
+}
+
+/**
+ * @brief Places the fence of the current frame, after its last command.
+ */
+void FramePacer::EndFrame()
+{
+	ASSERT(m_inFrame);
+
+	GLsync& fence = m_fences[GetFrameSlot()];
+	GLCall(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	m_frame++;
+	m_inFrame = false;
+}
+
+/**
+ * @brief Waits until the GPU has finished every frame.
+ */
+void FramePacer::WaitIdle()
+{
+	for (GLsync& fence : m_fences)
+		WaitAndDelete(fence);
+}
+
+/**
+ * @brief Changes the number of frames in flight. Waits for every frame first.
+ *
+ * @param maxFramesInFlight Number of frames the CPU may be ahead of the GPU, at least 1.
+ */
+void FramePacer::SetMaxFramesInFlight(unsigned int maxFramesInFlight)
+{
+	ASSERT(!m_inFrame);
+
+	WaitIdle();
+	m_fences.assign(maxFramesInFlight > 0 ? maxFramesInFlight : 1, nullptr);
+}
+
+/**
+ * @brief Waits for a fence, flushing the commands before it if needed, and deletes it.
+ *
+ * @param fence The fence, set to nullptr. nullptr does nothing.
+ * @return double Time waited in milliseconds, 0 if the fence had already signalled.
+ */
+double FramePacer::WaitAndDelete(GLsync& fence)
+{
+	if (!fence)
+		return 0.0;
+
+	GLenum result;
+	GLCall(result = glClientWaitSync(fence, 0, 0));
+	double waitMs = 0.0;
+	if (result == GL_TIMEOUT_EXPIRED) {
+		// Flush on the first wait, in case the fence has not been submitted yet
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		do {
+			GLCall(result = glClientWaitSync(fence, flags, 1000000000ull));
+			flags = 0;
+		} while (result == GL_TIMEOUT_EXPIRED);
+		waitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	GLCall(glDeleteSync(fence));
+	fence = nullptr;
+	return waitMs;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+/**
+ * @brief FramePacer class that bounds how many frames the GPU can lag behind the CPU.
+ *
+ * EndFrame places a fence behind the commands of each frame. BeginFrame waits for the fence
+ * of the frame MaxFramesInFlight frames back, so the driver never queues more than that many
+ * frames whatever the swap interval, which keeps input latency bounded and predictable.
+ * Per-frame resources (streaming buffers, readback buffers...) can be reused once their
+ * frame slot comes around again: GetFrameSlot tells which one the current frame owns.
+ *
+ * Must be used on the thread that owns the OpenGL context.
+ */
+class FramePacer {
+public:
+	/**
+	 * @brief Pacing statistics since the last ResetStats.
+	 */
+	struct Stats {
+		unsigned int frameCount = 0;  ///< Frames begun.
+		unsigned int waitCount = 0;   ///< Frames that had to wait for the GPU.
+		double lastWaitMs = 0.0;      ///< Time the last frame waited.
+		double totalWaitMs = 0.0;     ///< Time all frames waited.
+		double maxWaitMs = 0.0;       ///< Longest wait of a frame.
+	};
+
+private:
+	std::vector<GLsync> m_fences; ///< Fence of each frame slot, nullptr when the slot's frame is done
+	uint64_t m_frame; ///< Index of the current frame
+	bool m_inFrame; ///< Whether BeginFrame was called without EndFrame
+	Stats m_stats; ///< Pacing statistics
+
+public:
+	/**
+	 * @brief Constructs a FramePacer.
+	 *
+	 * @param maxFramesInFlight Number of frames the CPU may be ahead of the GPU, at least 1.
+	 */
+	FramePacer(unsigned int maxFramesInFlight = 2);
+
+	/**
+	 * @brief Destroys the FramePacer and deletes its fences without waiting for them.
+	 */
+	~FramePacer();
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	/**
+	 * @brief Waits until the GPU has finished the frame that last used the current frame slot.
+	 */
+	void BeginFrame();
+
+	/**
+	 * @brief Places the fence of the current frame, after its last command (usually after the swap).
+	 */
+	void EndFrame();
+
+	/**
+	 * @brief Waits until the GPU has finished every frame.
+	 */
+	void WaitIdle();
+
+	/**
+	 * @brief Changes the number of frames in flight. Waits for every frame first.
+	 *
+	 * @param maxFramesInFlight Number of frames the CPU may be ahead of the GPU, at least 1.
+	 */
+	void SetMaxFramesInFlight(unsigned int maxFramesInFlight);
+
+	/**
+	 * @brief Gets the number of frames the CPU may be ahead of the GPU.
+	 *
+	 * @return unsigned int The number of frame slots.
+	 */
+	inline unsigned int GetMaxFramesInFlight() const { return (unsigned int)m_fences.size(); }
+
+	/**
+	 * @brief Gets the slot of the current frame, in [0, GetMaxFramesInFlight()). Resources of a
+	 * slot are no longer used by the GPU once BeginFrame returned.
+	 *
+	 * @return unsigned int The frame slot.
+	 */
+	inline unsigned int GetFrameSlot() const { return (unsigned int)(m_frame % m_fences.size()); }
+
+	/**
+	 * @brief Gets the index of the current frame.
+	 *
+	 * @return uint64_t The frame index.
+	 */
+	inline uint64_t GetFrameIndex() const { return m_frame; }
+
+	/**
+	 * @brief Gets the pacing statistics.
+	 *
+	 * @return const Stats& The statistics.
+	 */
+	inline const Stats& GetStats() const { return m_stats; }
+
+	/**
+	 * @brief Resets the pacing statistics.
+	 */
+	inline void ResetStats() { m_stats = Stats(); }
+
+	/**
+	 * @brief Waits for a fence, flushing the commands before it if needed, and deletes it.
+	 *
+	 * @param fence The fence, set to nullptr. nullptr does nothing.
+	 * @return double Time waited in milliseconds, 0 if the fence had already signalled.
+	 */
+	static double WaitAndDelete(GLsync& fence);
+};
@@ -0,0 +1,85 @@
+#include "FramePacketQueue.h"
+
+/**
+ * @brief Constructs a FramePacketQueue.
+ *
+ * @param packetCount Number of packets in the ring, 2 for double and 3 for triple buffering.
+ */
+FramePacketQueue::FramePacketQueue(unsigned int packetCount)
+	: m_packets(packetCount < 2 ? 2 : packetCount), m_readIndex(0), m_ready(0), m_inUse(0), m_closed(false)
+{
+}
+
+/**
+ * @brief Waits for a free packet for the simulation to fill.
+ *
+ * @return FramePacket* The packet to fill, or nullptr if the queue was closed.
+ */
+FramePacket* FramePacketQueue::BeginWrite()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_changed.wait(lock, [this] { return m_closed || m_inUse < m_packets.size(); });
+	if (m_closed)
+		return nullptr;
+
+	// Packets in use are the ones following the read index, the next one is free
+	FramePacket& packet = m_packets[(m_readIndex + m_inUse) % m_packets.size()];
+	packet.commands.Reset();
+	return &packet;
+}
+
+/**
+ * @brief Publishes the packet returned by BeginWrite to the render thread.
+ */
+void FramePacketQueue::EndWrite()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_inUse++;
+		m_ready++;
+	}
+	m_changed.notify_all();
+}
+
+/**
+ * @brief Waits for the oldest published packet.
+ *
+ * @return const FramePacket* The packet to draw, or nullptr once the queue is closed and
+ * every published packet was drawn.
+ */
+const FramePacket* FramePacketQueue::BeginRead()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_changed.wait(lock, [this] { return m_closed || m_ready > 0; });
+	if (m_ready == 0)
+		return nullptr;
+
+	const unsigned int acquired = m_inUse - m_ready; // Packets already being read
+	m_ready--;
+	return &m_packets[(m_readIndex + acquired) % m_packets.size()];
+}
+
+/**
+ * @brief Gives the packet returned by BeginRead back to the simulation.
+ */
+void FramePacketQueue::EndRead()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_readIndex = (m_readIndex + 1) % m_packets.size();
+		m_inUse--;
+	}
+	m_changed.notify_all();
+}
+
+/**
+ * @brief Closes the queue, waking up both threads. Published packets can still be read.
+ */
+void FramePacketQueue::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+	}
+	m_changed.notify_all();
+}
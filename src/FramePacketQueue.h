@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "CommandList.h"
+#include "glm/glm.hpp"
+
+/**
+ * @brief Everything the render thread needs to draw one frame, produced by the simulation.
+ *
+ * A packet is written by the simulation thread only and becomes read-only once published.
+ */
+struct FramePacket {
+	uint64_t frameIndex = 0;         ///< Index of the simulated frame.
+	int width = 0;                   ///< Width of the window's framebuffer.
+	int height = 0;                  ///< Height of the window's framebuffer.
+	glm::mat4 viewProjection;        ///< Camera of the frame.
+	bool capture = false;            ///< Whether the render thread reads the finished frame back.
+	CommandList commands;            ///< Draw list of the frame, with its per-draw uniform data.
+};
+
+/**
+ * @brief FramePacketQueue class that hands frame packets from the simulation thread to the
+ * render thread.
+ *
+ * The queue owns a ring of packets. While the render thread draws packet N, the simulation
+ * fills packet N+1 (and N+2 with three packets), and only waits when every packet is either
+ * published or being drawn. Packets are reused, so their allocations survive between frames.
+ */
+class FramePacketQueue {
+private:
+	std::vector<FramePacket> m_packets; ///< Ring of packets
+	std::mutex m_mutex; ///< Guards the fields below
+	std::condition_variable m_changed; ///< Signals publish, release and close
+	unsigned int m_readIndex; ///< Oldest published packet
+	unsigned int m_ready; ///< Number of packets published but not yet acquired for reading
+	unsigned int m_inUse; ///< Number of packets published and not yet released
+	bool m_closed; ///< Whether the queue was closed
+
+public:
+	/**
+	 * @brief Constructs a FramePacketQueue.
+	 *
+	 * @param packetCount Number of packets in the ring, 2 for double and 3 for triple buffering.
+	 */
+	FramePacketQueue(unsigned int packetCount = 2);
+
+	/**
+	 * @brief Waits for a free packet for the simulation to fill.
+	 *
+	 * @return FramePacket* The packet to fill, or nullptr if the queue was closed.
+	 */
+	FramePacket* BeginWrite();
+
+	/**
+	 * @brief Publishes the packet returned by BeginWrite to the render thread.
+	 */
+	void EndWrite();
+
+	/**
+	 * @brief Waits for the oldest published packet.
+	 *
+	 * @return const FramePacket* The packet to draw, or nullptr once the queue is closed and
+	 * every published packet was drawn.
+	 */
+	const FramePacket* BeginRead();
+
+	/**
+	 * @brief Gives the packet returned by BeginRead back to the simulation.
+	 */
+	void EndRead();
+
+	/**
+	 * @brief Closes the queue, waking up both threads. Published packets can still be read.
+	 */
+	void Close();
+};
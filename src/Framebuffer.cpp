@@ -0,0 +1,387 @@
+#include "Framebuffer.h"
+#include "Renderer.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+
+/**
+ * @brief Makes the framebuffer bound to GL_DRAW_FRAMEBUFFER draw into its first color
+ * attachments, or into none.
+ *
+ * @param colorCount Number of color attachments, at most 16 are drawn.
+ */
+static void DrawToColorAttachments(size_t colorCount)
+{
+	GLenum drawBuffers[16];
+	const GLsizei count = (GLsizei)std::min<size_t>(colorCount, 16);
+	for (GLsizei i = 0; i < count; i++)
+		drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+
+	if (count > 0) {
+		GLCall(glDrawBuffers(count, drawBuffers));
+	}
+	else {
+		GLCall(glDrawBuffer(GL_NONE));
+	}
+}
+
+/**
+ * @brief Constructs a Framebuffer and creates its attachments.
+ *
+ * @param spec Size, formats and sample count of the attachments.
+ */
+Framebuffer::Framebuffer(const FramebufferSpec& spec)
+	: m_rendererID(0), m_resolveID(0), m_spec(spec), m_depthAttachment(0), m_ownsAttachments(true)
+{
+	GLCall(glGenFramebuffers(1, &m_rendererID));
+	CreateAttachments();
+}
+
+/**
+ * @brief Constructs a Framebuffer without attachments, to be given some with Attach.
+ */
+Framebuffer::Framebuffer()
+	: m_rendererID(0), m_resolveID(0), m_depthAttachment(0), m_ownsAttachments(false)
+{
+	m_spec.colorFormats.clear();
+	m_spec.depthFormat = 0;
+	GLCall(glGenFramebuffers(1, &m_rendererID));
+}
+
+/**
+ * @brief Destroys the Framebuffer and deletes the attachments it owns.
+ */
+Framebuffer::~Framebuffer()
+{
+	DeleteAttachments();
+	GLCall(glDeleteFramebuffers(1, &m_rendererID));
+}
+
+/**
+ * @brief Renders into single-sampled textures owned by the caller, replacing the current
+ * attachments. Does nothing if the same textures are already attached.
+ *
+ * @param width Width of the textures.
+ * @param height Height of the textures.
+ * @param colorTextures Renderer IDs of the color textures, attached in order.
+ * @param depthTexture Renderer ID of the depth texture, 0 for none.
+ * @param depthFormat Sized format of the depth texture.
+ */
+void Framebuffer::Attach(int width, int height, const std::vector<unsigned int>& colorTextures, unsigned int depthTexture,
+	unsigned int depthFormat)
+{
+	if (!m_ownsAttachments && width == m_spec.width && height == m_spec.height && colorTextures == m_colorAttachments
+		&& depthTexture == m_depthAttachment && (!depthTexture || depthFormat == m_spec.depthFormat))
+		return;
+
+	const size_t previousColorCount = m_colorAttachments.size();
+	DeleteAttachments();
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_rendererID));
+
+	// Detach what is not replaced, the depth attachment is always rewritten below
+	for (size_t i = colorTextures.size(); i < previousColorCount; i++) {
+		GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, (GLenum)(GL_COLOR_ATTACHMENT0 + i), GL_TEXTURE_2D, 0, 0));
+	}
+	for (size_t i = 0; i < colorTextures.size(); i++) {
+		GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, (GLenum)(GL_COLOR_ATTACHMENT0 + i), GL_TEXTURE_2D, colorTextures[i], 0));
+	}
+	GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0));
+	if (depthTexture) {
+		GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, GetDepthAttachmentPoint(depthFormat), GL_TEXTURE_2D, depthTexture, 0));
+	}
+
+	m_spec.width = width;
+	m_spec.height = height;
+	m_spec.colorFormats.assign(colorTextures.size(), 0); // Formats of external textures are not tracked
+	m_spec.depthFormat = depthTexture ? depthFormat : 0;
+	m_spec.samples = 1;
+	m_colorAttachments = colorTextures;
+	m_depthAttachment = depthTexture;
+	m_ownsAttachments = false;
+	Finish();
+}
+
+/**
+ * @brief Recreates the owned attachments at a new size. Does nothing if the size is unchanged.
+ *
+ * @param width New width in pixels.
+ * @param height New height in pixels.
+ */
+void Framebuffer::Resize(int width, int height)
+{
+	if (!m_ownsAttachments || (width == m_spec.width && height == m_spec.height))
+		return;
+
+	DeleteAttachments();
+	m_spec.width = width;
+	m_spec.height = height;
+	CreateAttachments();
+}
+
+/**
+ * @brief Binds the framebuffer and sets the viewport to its size.
+ */
+void Framebuffer::Bind() const
+{
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_rendererID));
+	GLCall(glViewport(0, 0, m_spec.width, m_spec.height));
+}
+
+/**
+ * @brief Binds the default framebuffer.
+ */
+void Framebuffer::Unbind() const
+{
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+/**
+ * @brief Resolves the multisampled color attachments into their single-sampled textures.
+ * Does nothing without MSAA.
+ *
+ * The read buffer of the framebuffer and the draw buffers of the resolved one are put back
+ * to their defaults, and the framebuffer is left bound.
+ */
+void Framebuffer::Resolve() const
+{
+	if (!m_resolveID)
+		return;
+
+	GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_rendererID));
+	GLCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_resolveID));
+	for (size_t i = 0; i < m_colorAttachments.size(); i++) {
+		const GLenum attachment = (GLenum)(GL_COLOR_ATTACHMENT0 + i);
+		GLCall(glReadBuffer(attachment));
+		GLCall(glDrawBuffers(1, &attachment));
+		GLCall(glBlitFramebuffer(0, 0, m_spec.width, m_spec.height, 0, 0, m_spec.width, m_spec.height,
+			GL_COLOR_BUFFER_BIT, GL_NEAREST));
+	}
+	GLCall(glReadBuffer(GL_COLOR_ATTACHMENT0));
+	DrawToColorAttachments(m_resolveTextures.size());
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_rendererID));
+}
+
+/**
+ * @brief Tells the driver the contents of the attachments are no longer needed.
+ *
+ * @param color Whether to invalidate the color attachments.
+ * @param depth Whether to invalidate the depth attachment.
+ */
+void Framebuffer::Invalidate(bool color, bool depth) const
+{
+	if (!GLEW_VERSION_4_3 && !GLEW_ARB_invalidate_subdata)
+		return;
+
+	std::vector<GLenum> attachments;
+	if (color) {
+		for (size_t i = 0; i < m_colorAttachments.size(); i++)
+			attachments.push_back((GLenum)(GL_COLOR_ATTACHMENT0 + i));
+	}
+	if (depth && m_depthAttachment)
+		attachments.push_back(GetDepthAttachmentPoint(m_spec.depthFormat));
+	if (attachments.empty())
+		return;
+
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_rendererID));
+	GLCall(glInvalidateFramebuffer(GL_FRAMEBUFFER, (GLsizei)attachments.size(), attachments.data()));
+}
+
+/**
+ * @brief Gets a color texture that can be sampled, the resolved one with MSAA.
+ *
+ * @param index Index of the color attachment.
+ * @return unsigned int Renderer ID of the texture.
+ */
+unsigned int Framebuffer::GetColorAttachment(unsigned int index) const
+{
+	return m_resolveID ? m_resolveTextures[index] : m_colorAttachments[index];
+}
+
+/**
+ * @brief Creates a single-sampled texture usable as an attachment.
+ *
+ * @param desc Size and format of the texture.
+ * @return unsigned int Renderer ID of the texture.
+ */
+unsigned int Framebuffer::CreateTexture(const RenderTargetDesc& desc)
+{
+	// The pixel format and type only describe the (absent) upload data, but must match the format
+	const bool depth = IsDepthFormat(desc.format);
+	GLenum format = GL_RGBA;
+	GLenum type = GL_UNSIGNED_BYTE;
+	if (desc.format == GL_DEPTH24_STENCIL8) {
+		format = GL_DEPTH_STENCIL;
+		type = GL_UNSIGNED_INT_24_8;
+	}
+	else if (desc.format == GL_DEPTH32F_STENCIL8) {
+		format = GL_DEPTH_STENCIL;
+		type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+	}
+	else if (depth) {
+		format = GL_DEPTH_COMPONENT;
+		type = GL_FLOAT;
+	}
+
+	unsigned int texture;
+	GLCall(glGenTextures(1, &texture));
+	GLStateCache::BindTexture(GLStateCache::GetActiveTexture(), texture);
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, depth ? GL_NEAREST : GL_LINEAR));
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, depth ? GL_NEAREST : GL_LINEAR));
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	GLCall(glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, format, type, nullptr));
+	GLStateCache::BindTexture(GLStateCache::GetActiveTexture(), 0);
+	return texture;
+}
+
+/**
+ * @brief Deletes a texture created by CreateTexture.
+ *
+ * @param texture Renderer ID of the texture.
+ */
+void Framebuffer::DeleteTexture(unsigned int texture)
+{
+	GLCall(glDeleteTextures(1, &texture));
+	GLStateCache::OnTextureDeleted(texture);
+}
+
+/**
+ * @brief Tells whether a format is a depth or depth-stencil format.
+ *
+ * @param format Sized internal format.
+ * @return true for depth formats.
+ */
+bool Framebuffer::IsDepthFormat(unsigned int format)
+{
+	switch (format) {
+	case GL_DEPTH_COMPONENT16:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32:
+	case GL_DEPTH_COMPONENT32F:
+	case GL_DEPTH24_STENCIL8:
+	case GL_DEPTH32F_STENCIL8:
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Gets the attachment point of a depth format.
+ *
+ * @param format Sized depth format.
+ * @return unsigned int GL_DEPTH_STENCIL_ATTACHMENT for formats with stencil, GL_DEPTH_ATTACHMENT otherwise.
+ */
+unsigned int Framebuffer::GetDepthAttachmentPoint(unsigned int format)
+{
+	return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+}
+
+/**
+ * @brief Creates the attachments described by m_spec and attaches them.
+ */
+void Framebuffer::CreateAttachments()
+{
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_rendererID));
+	const bool multisampled = m_spec.samples > 1;
+
+	for (size_t i = 0; i < m_spec.colorFormats.size(); i++) {
+		const GLenum attachment = (GLenum)(GL_COLOR_ATTACHMENT0 + i);
+		unsigned int id;
+		if (multisampled) {
+			GLCall(glGenRenderbuffers(1, &id));
+			GLCall(glBindRenderbuffer(GL_RENDERBUFFER, id));
+			GLCall(glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_spec.samples, m_spec.colorFormats[i], m_spec.width, m_spec.height));
+			GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, id));
+		}
+		else {
+			RenderTargetDesc desc;
+			desc.width = m_spec.width;
+			desc.height = m_spec.height;
+			desc.format = m_spec.colorFormats[i];
+			id = CreateTexture(desc);
+			GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, id, 0));
+		}
+		m_colorAttachments.push_back(id);
+	}
+
+	if (m_spec.depthFormat) {
+		const GLenum attachment = GetDepthAttachmentPoint(m_spec.depthFormat);
+		if (multisampled) {
+			GLCall(glGenRenderbuffers(1, &m_depthAttachment));
+			GLCall(glBindRenderbuffer(GL_RENDERBUFFER, m_depthAttachment));
+			GLCall(glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_spec.samples, m_spec.depthFormat, m_spec.width, m_spec.height));
+			GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, m_depthAttachment));
+		}
+		else {
+			RenderTargetDesc desc;
+			desc.width = m_spec.width;
+			desc.height = m_spec.height;
+			desc.format = m_spec.depthFormat;
+			m_depthAttachment = CreateTexture(desc);
+			GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, m_depthAttachment, 0));
+		}
+	}
+	Finish();
+
+	// Multisampled colors are resolved into textures of a second framebuffer
+	if (multisampled && !m_spec.colorFormats.empty()) {
+		GLCall(glGenFramebuffers(1, &m_resolveID));
+		GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_resolveID));
+		for (size_t i = 0; i < m_spec.colorFormats.size(); i++) {
+			RenderTargetDesc desc;
+			desc.width = m_spec.width;
+			desc.height = m_spec.height;
+			desc.format = m_spec.colorFormats[i];
+			m_resolveTextures.push_back(CreateTexture(desc));
+			GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, (GLenum)(GL_COLOR_ATTACHMENT0 + i), GL_TEXTURE_2D, m_resolveTextures.back(), 0));
+		}
+		DrawToColorAttachments(m_resolveTextures.size());
+		GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_rendererID));
+	}
+}
+
+/**
+ * @brief Deletes the owned attachments.
+ */
+void Framebuffer::DeleteAttachments()
+{
+	if (m_ownsAttachments) {
+		const bool multisampled = m_spec.samples > 1;
+		for (unsigned int id : m_colorAttachments) {
+			if (multisampled) {
+				GLCall(glDeleteRenderbuffers(1, &id));
+			}
+			else {
+				DeleteTexture(id);
+			}
+		}
+		if (m_depthAttachment && multisampled) {
+			GLCall(glDeleteRenderbuffers(1, &m_depthAttachment));
+		}
+		else if (m_depthAttachment) {
+			DeleteTexture(m_depthAttachment);
+		}
+		for (unsigned int id : m_resolveTextures)
+			DeleteTexture(id);
+		if (m_resolveID) {
+			GLCall(glDeleteFramebuffers(1, &m_resolveID));
+		}
+	}
+
+	m_colorAttachments.clear();
+	m_depthAttachment = 0;
+	m_resolveTextures.clear();
+	m_resolveID = 0;
+}
+
+/**
+ * @brief Selects the draw buffers of the attached colors and checks completeness.
+ */
+void Framebuffer::Finish() const
+{
+	DrawToColorAttachments(m_colorAttachments.size());
+
+	GLenum status;
+	GLCall(status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+	ASSERT(status == GL_FRAMEBUFFER_COMPLETE);
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+/**
+ * @brief Size and format of a single render target texture.
+ */
+struct RenderTargetDesc {
+	int width = 0;             ///< Width in pixels.
+	int height = 0;            ///< Height in pixels.
+	unsigned int format = 0;   ///< Sized internal format, such as GL_RGBA8 or GL_DEPTH24_STENCIL8.
+
+	bool operator==(const RenderTargetDesc& other) const
+	{
+		return width == other.width && height == other.height && format == other.format;
+	}
+};
+
+/**
+ * @brief Attachments of a Framebuffer.
+ */
+struct FramebufferSpec {
+	int width = 0;                                          ///< Width in pixels.
+	int height = 0;                                         ///< Height in pixels.
+	std::vector<unsigned int> colorFormats = { GL_RGBA8 };  ///< Sized format of each color attachment.
+	unsigned int depthFormat = GL_DEPTH24_STENCIL8;         ///< Sized format of the depth attachment, 0 for none.
+	int samples = 1;                                        ///< Samples per pixel, above 1 for MSAA.
+
+	bool operator==(const FramebufferSpec& other) const
+	{
+		return width == other.width && height == other.height && colorFormats == other.colorFormats
+			&& depthFormat == other.depthFormat && samples == other.samples;
+	}
+};
+
+/**
+ * @brief Framebuffer class to manage OpenGL framebuffer objects (FBOs) for offscreen rendering.
+ *
+ * A Framebuffer either creates and owns attachments from a FramebufferSpec, or renders into
+ * textures owned by someone else (see Attach). Single-sampled attachments are textures that
+ * can be sampled directly. Multisampled attachments are renderbuffers: Resolve blits them into
+ * single-sampled textures, which are the ones GetColorAttachment returns.
+ */
+class Framebuffer {
+private:
+	unsigned int m_rendererID; ///< Renderer ID of the framebuffer object
+	unsigned int m_resolveID; ///< Renderer ID of the framebuffer holding the resolved textures, 0 without MSAA
+	FramebufferSpec m_spec; ///< Attachments of the framebuffer
+	std::vector<unsigned int> m_colorAttachments; ///< Color textures, or renderbuffers with MSAA
+	unsigned int m_depthAttachment; ///< Depth texture, or renderbuffer with MSAA, 0 for none
+	std::vector<unsigned int> m_resolveTextures; ///< Single-sampled color textures written by Resolve
+	bool m_ownsAttachments; ///< Whether the attachments are deleted with the framebuffer
+
+public:
+	/**
+	 * @brief Constructs a Framebuffer and creates its attachments.
+	 *
+	 * @param spec Size, formats and sample count of the attachments.
+	 */
+	Framebuffer(const FramebufferSpec& spec);
+
+	/**
+	 * @brief Constructs a Framebuffer without attachments, to be given some with Attach.
+	 */
+	Framebuffer();
+
+	/**
+	 * @brief Destroys the Framebuffer and deletes the attachments it owns.
+	 */
+	~Framebuffer();
+
+	Framebuffer(const Framebuffer&) = delete;
+	Framebuffer& operator=(const Framebuffer&) = delete;
+
+	/**
+	 * @brief Renders into single-sampled textures owned by the caller, replacing the current
+	 * attachments. Does nothing if the same textures are already attached.
+	 *
+	 * @param width Width of the textures.
+	 * @param height Height of the textures.
+	 * @param colorTextures Renderer IDs of the color textures, attached in order.
+	 * @param depthTexture Renderer ID of the depth texture, 0 for none.
+	 * @param depthFormat Sized format of the depth texture.
+	 */
+	void Attach(int width, int height, const std::vector<unsigned int>& colorTextures, unsigned int depthTexture = 0,
+		unsigned int depthFormat = GL_DEPTH24_STENCIL8);
+
+	/**
+	 * @brief Recreates the owned attachments at a new size. Does nothing if the size is unchanged.
+	 *
+	 * @param width New width in pixels.
+	 * @param height New height in pixels.
+	 */
+	void Resize(int width, int height);
+
+	/**
+	 * @brief Binds the framebuffer and sets the viewport to its size.
+	 */
+	void Bind() const;
+
+	/**
+	 * @brief Binds the default framebuffer.
+	 */
+	void Unbind() const;
+
+	/**
+	 * @brief Resolves the multisampled color attachments into their single-sampled textures.
+	 * Does nothing without MSAA.
+	 */
+	void Resolve() const;
+
+	/**
+	 * @brief Tells the driver the contents of the attachments are no longer needed.
+	 *
+	 * @param color Whether to invalidate the color attachments.
+	 * @param depth Whether to invalidate the depth attachment.
+	 */
+	void Invalidate(bool color, bool depth) const;
+
+	/**
+	 * @brief Gets a color texture that can be sampled, the resolved one with MSAA.
+	 *
+	 * @param index Index of the color attachment.
+	 * @return unsigned int Renderer ID of the texture.
+	 */
+	unsigned int GetColorAttachment(unsigned int index = 0) const;
+
+	/**
+	 * @brief Gets the depth attachment.
+	 *
+	 * @return unsigned int Renderer ID of the depth texture, or renderbuffer with MSAA, 0 for none.
+	 */
+	inline unsigned int GetDepthAttachment() const { return m_depthAttachment; }
+
+	/**
+	 * @brief Gets the size and formats of the attachments.
+	 *
+	 * @return const FramebufferSpec& The specification.
+	 */
+	inline const FramebufferSpec& GetSpec() const { return m_spec; }
+
+	/**
+	 * @brief Gets the renderer ID of the framebuffer object.
+	 *
+	 * @return unsigned int The renderer ID.
+	 */
+	inline unsigned int GetRendererID() const { return m_rendererID; }
+
+	/**
+	 * @brief Gets the framebuffer object the sampleable color textures are attached to: the
+	 * resolve target with MSAA, the framebuffer itself otherwise.
+	 *
+	 * @return unsigned int The renderer ID.
+	 */
+	inline unsigned int GetResolvedRendererID() const { return m_resolveID ? m_resolveID : m_rendererID; }
+
+	/**
+	 * @brief Creates a single-sampled texture usable as an attachment.
+	 *
+	 * @param desc Size and format of the texture.
+	 * @return unsigned int Renderer ID of the texture.
+	 */
+	static unsigned int CreateTexture(const RenderTargetDesc& desc);
+
+	/**
+	 * @brief Deletes a texture created by CreateTexture.
+	 *
+	 * @param texture Renderer ID of the texture.
+	 */
+	static void DeleteTexture(unsigned int texture);
+
+	/**
+	 * @brief Tells whether a format is a depth or depth-stencil format.
+	 *
+	 * @param format Sized internal format.
+	 * @return true for depth formats.
+	 */
+	static bool IsDepthFormat(unsigned int format);
+
+	/**
+	 * @brief Gets the attachment point of a depth format.
+	 *
+	 * @param format Sized depth format.
+	 * @return unsigned int GL_DEPTH_STENCIL_ATTACHMENT for formats with stencil, GL_DEPTH_ATTACHMENT otherwise.
+	 */
+	static unsigned int GetDepthAttachmentPoint(unsigned int format);
+
+private:
+	/**
+	 * @brief Creates the attachments described by m_spec and attaches them.
+	 */
+	void CreateAttachments();
+
+	/**
+	 * @brief Deletes the owned attachments.
+	 */
+	void DeleteAttachments();
+
+	/**
+	 * @brief Selects the draw buffers of the attached colors and checks completeness.
+	 */
+	void Finish() const;
+};
@@ -0,0 +1,258 @@
+#include "FrustumCuller.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define CULL_SIMD_WIDTH 8
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define CULL_SIMD_WIDTH 4
+#else
+	#define CULL_SIMD_WIDTH 1
+#endif
+
+/// Objects are split across threads in blocks of this size, a multiple of every SIMD width.
+static const size_t BlockSize = 8;
+
+/**
+ * @brief Adds an axis-aligned bounding box.
+ *
+ * @param min Minimum corner of the box.
+ * @param max Maximum corner of the box.
+ * @return unsigned int Index of the object.
+ */
+unsigned int FrustumCuller::AddBox(const glm::vec3& min, const glm::vec3& max)
+{
+	const unsigned int index = (unsigned int)m_radius.size();
+	m_centerX.push_back(0.0f);
+	m_centerY.push_back(0.0f);
+	m_centerZ.push_back(0.0f);
+	m_extentX.push_back(0.0f);
+	m_extentY.push_back(0.0f);
+	m_extentZ.push_back(0.0f);
+	m_radius.push_back(0.0f);
+	SetBox(index, min, max);
+	return index;
+}
+
+/**
+ * @brief Adds a bounding sphere.
+ *
+ * @param center Center of the sphere.
+ * @param radius Radius of the sphere.
+ * @return unsigned int Index of the object.
+ */
+unsigned int FrustumCuller::AddSphere(const glm::vec3& center, float radius)
+{
+	const unsigned int index = AddBox(center, center);
+	m_radius[index] = radius;
+	return index;
+}
+
+/**
+ * @brief Replaces the bounds of an object with an axis-aligned bounding box.
+ *
+ * @param index Index of the object.
+ * @param min Minimum corner of the box.
+ * @param max Maximum corner of the box.
+ */
+void FrustumCuller::SetBox(unsigned int index, const glm::vec3& min, const glm::vec3& max)
+{
+	const glm::vec3 center = (min + max) * 0.5f;
+	const glm::vec3 extent = (max - min) * 0.5f;
+	m_centerX[index] = center.x;
+	m_centerY[index] = center.y;
+	m_centerZ[index] = center.z;
+	m_extentX[index] = extent.x;
+	m_extentY[index] = extent.y;
+	m_extentZ[index] = extent.z;
+	m_radius[index] = 0.0f;
+}
+
+/**
+ * @brief Replaces the bounds of an object with a bounding sphere.
+ *
+ * @param index Index of the object.
+ * @param center Center of the sphere.
+ * @param radius Radius of the sphere.
+ */
+void FrustumCuller::SetSphere(unsigned int index, const glm::vec3& center, float radius)
+{
+	SetBox(index, center, center);
+	m_radius[index] = radius;
+}
+
+/**
+ * @brief Removes all objects.
+ */
+void FrustumCuller::Clear()
+{
+	m_centerX.clear();
+	m_centerY.clear();
+	m_centerZ.clear();
+	m_extentX.clear();
+	m_extentY.clear();
+	m_extentZ.clear();
+	m_radius.clear();
+}
+
+/**
+ * @brief Gets the number of objects the SIMD path tests per instruction.
+ *
+ * @return unsigned int 8 with AVX, 4 with SSE, 1 when the target has no SIMD path.
+ */
+unsigned int FrustumCuller::GetSimdWidth()
+{
+	return CULL_SIMD_WIDTH;
+}
+
+/**
+ * @brief Finds the objects that intersect the view frustum.
+ *
+ * @param viewProjection The view projection matrix the frustum is extracted from.
+ * @param visible Receives the indices of the visible objects, in increasing order.
+ * @param pool Thread pool to split large object counts across, or nullptr.
+ */
+void FrustumCuller::Cull(const glm::mat4& viewProjection, std::vector<unsigned int>& visible, ThreadPool* pool)
+{
+	glm::vec4 planes[6];
+	ExtractPlanes(viewProjection, planes);
+
+	visible.clear();
+	const size_t count = GetObjectCount();
+	if (!pool || pool->GetThreadCount() == 1 || count < ParallelThreshold) {
+		CullRange(planes, 0, count, visible);
+		return;
+	}
+
+	// Chunks are whole blocks so that every SIMD load stays aligned to the start of a chunk
+	m_workerVisible.resize(pool->GetThreadCount());
+	const size_t blockCount = (count + BlockSize - 1) / BlockSize;
+	pool->ParallelFor(blockCount, [&](size_t begin, size_t end, unsigned int worker) {
+		std::vector<unsigned int>& workerVisible = m_workerVisible[worker];
+		workerVisible.clear();
+		CullRange(planes, begin * BlockSize, std::min(end * BlockSize, count), workerVisible);
+	});
+
+	// Workers cover consecutive ranges, so appending in worker order keeps the indices sorted
+	for (const std::vector<unsigned int>& workerVisible : m_workerVisible)
+		visible.insert(visible.end(), workerVisible.begin(), workerVisible.end());
+}
+
+/**
+ * @brief Extracts the six normalized clip planes of a view projection matrix.
+ *
+ * @param viewProjection The view projection matrix.
+ * @param planes Receives the left, right, bottom, top, near and far planes.
+ */
+void FrustumCuller::ExtractPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+	// Rows of the matrix, glm stores columns
+	const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+	// -w <= x, y, z <= w in OpenGL clip space
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row3 + row2;
+	planes[5] = row3 - row2;
+
+	// Normalized planes give true distances, which the sphere radius is compared against
+	for (int i = 0; i < 6; i++)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+/**
+ * @brief Appends the visible objects of a range, which must start at a multiple of 8.
+ *
+ * An object is outside when, for some plane, the signed distance of its center is below minus
+ * its projected extent (the extents weighted by the absolute plane normal) and its radius.
+ *
+ * @param planes The frustum planes.
+ * @param begin First object of the range.
+ * @param end Object past the end of the range.
+ * @param visible Receives the indices of the visible objects.
+ */
+void FrustumCuller::CullRange(const glm::vec4 planes[6], size_t begin, size_t end, std::vector<unsigned int>& visible) const
+{
+	size_t i = begin;
+
+#if CULL_SIMD_WIDTH == 8
+	for (; m_useSimd && i + 8 <= end; i += 8) {
+		const __m256 cx = _mm256_loadu_ps(&m_centerX[i]);
+		const __m256 cy = _mm256_loadu_ps(&m_centerY[i]);
+		const __m256 cz = _mm256_loadu_ps(&m_centerZ[i]);
+		const __m256 ex = _mm256_loadu_ps(&m_extentX[i]);
+		const __m256 ey = _mm256_loadu_ps(&m_extentY[i]);
+		const __m256 ez = _mm256_loadu_ps(&m_extentZ[i]);
+		const __m256 radius = _mm256_loadu_ps(&m_radius[i]);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = planes[p];
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_set1_ps(plane.w));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.y), cy));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), cz));
+			__m256 reach = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.x)), ex), radius);
+			reach = _mm256_add_ps(reach, _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.y)), ey));
+			reach = _mm256_add_ps(reach, _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.z)), ez));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+
+		const int mask = _mm256_movemask_ps(inside);
+		for (int j = 0; j < 8; j++) {
+			if (mask & (1 << j))
+				visible.push_back((unsigned int)(i + j));
+		}
+	}
+#elif CULL_SIMD_WIDTH == 4
+	for (; m_useSimd && i + 4 <= end; i += 4) {
+		const __m128 cx = _mm_loadu_ps(&m_centerX[i]);
+		const __m128 cy = _mm_loadu_ps(&m_centerY[i]);
+		const __m128 cz = _mm_loadu_ps(&m_centerZ[i]);
+		const __m128 ex = _mm_loadu_ps(&m_extentX[i]);
+		const __m128 ey = _mm_loadu_ps(&m_extentY[i]);
+		const __m128 ez = _mm_loadu_ps(&m_extentZ[i]);
+		const __m128 radius = _mm_loadu_ps(&m_radius[i]);
+
+		__m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = planes[p];
+			__m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_set1_ps(plane.w));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), cy));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), cz));
+			__m128 reach = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane.x)), ex), radius);
+			reach = _mm_add_ps(reach, _mm_mul_ps(_mm_set1_ps(std::fabs(plane.y)), ey));
+			reach = _mm_add_ps(reach, _mm_mul_ps(_mm_set1_ps(std::fabs(plane.z)), ez));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+		}
+
+		const int mask = _mm_movemask_ps(inside);
+		for (int j = 0; j < 4; j++) {
+			if (mask & (1 << j))
+				visible.push_back((unsigned int)(i + j));
+		}
+	}
+#endif
+
+	// Objects left over after the last full SIMD block, or all of them without SIMD
+	for (; i < end; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			const glm::vec4& plane = planes[p];
+			const float distance = plane.x * m_centerX[i] + plane.y * m_centerY[i] + plane.z * m_centerZ[i] + plane.w;
+			const float reach = std::fabs(plane.x) * m_extentX[i] + std::fabs(plane.y) * m_extentY[i]
+				+ std::fabs(plane.z) * m_extentZ[i] + m_radius[i];
+			inside = distance + reach >= 0.0f;
+		}
+		if (inside)
+			visible.push_back((unsigned int)i);
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+class ThreadPool;
+
+/**
+ * @brief FrustumCuller class that tests bounding volumes against the view frustum.
+ *
+ * Bounds are stored as structure of arrays (one array per component) so that the test runs
+ * on several objects per instruction: 8 with AVX, 4 with SSE, and one at a time on other
+ * targets. Boxes and spheres share the same representation, a center with half extents plus
+ * a radius, so both kinds can be mixed in one culler. Bounds are in world space.
+ */
+class FrustumCuller {
+public:
+	/// Number of objects below which Cull does not use the thread pool.
+	static const size_t ParallelThreshold = 4096;
+
+private:
+	std::vector<float> m_centerX; ///< X of the centers
+	std::vector<float> m_centerY; ///< Y of the centers
+	std::vector<float> m_centerZ; ///< Z of the centers
+	std::vector<float> m_extentX; ///< Half size of the boxes along X, 0 for spheres
+	std::vector<float> m_extentY; ///< Half size of the boxes along Y, 0 for spheres
+	std::vector<float> m_extentZ; ///< Half size of the boxes along Z, 0 for spheres
+	std::vector<float> m_radius;  ///< Radius of the spheres, 0 for boxes
+	std::vector<std::vector<unsigned int>> m_workerVisible; ///< Visible objects found by each worker
+	bool m_useSimd = true; ///< Whether CullRange tests several objects per instruction
+
+public:
+	/**
+	 * @brief Adds an axis-aligned bounding box.
+	 *
+	 * @param min Minimum corner of the box.
+	 * @param max Maximum corner of the box.
+	 * @return unsigned int Index of the object.
+	 */
+	unsigned int AddBox(const glm::vec3& min, const glm::vec3& max);
+
+	/**
+	 * @brief Adds a bounding sphere.
+	 *
+	 * @param center Center of the sphere.
+	 * @param radius Radius of the sphere.
+	 * @return unsigned int Index of the object.
+	 */
+	unsigned int AddSphere(const glm::vec3& center, float radius);
+
+	/**
+	 * @brief Replaces the bounds of an object with an axis-aligned bounding box.
+	 *
+	 * @param index Index of the object.
+	 * @param min Minimum corner of the box.
+	 * @param max Maximum corner of the box.
+	 */
+	void SetBox(unsigned int index, const glm::vec3& min, const glm::vec3& max);
+
+	/**
+	 * @brief Replaces the bounds of an object with a bounding sphere.
+	 *
+	 * @param index Index of the object.
+	 * @param center Center of the sphere.
+	 * @param radius Radius of the sphere.
+	 */
+	void SetSphere(unsigned int index, const glm::vec3& center, float radius);
+
+	/**
+	 * @brief Removes all objects.
+	 */
+	void Clear();
+
+	/**
+	 * @brief Gets the number of objects.
+	 *
+	 * @return size_t Number of objects.
+	 */
+	inline size_t GetObjectCount() const { return m_radius.size(); }
+
+	/**
+	 * @brief Selects between the SIMD path and the one object at a time path, for comparisons.
+	 *
+	 * @param useSimd Whether to test GetSimdWidth() objects per instruction. True by default.
+	 */
+	inline void SetUseSimd(bool useSimd) { m_useSimd = useSimd; }
+
+	/**
+	 * @brief Gets the number of objects the SIMD path tests per instruction.
+	 *
+	 * @return unsigned int 8 with AVX, 4 with SSE, 1 when the target has no SIMD path.
+	 */
+	static unsigned int GetSimdWidth();
+
+	/**
+	 * @brief Finds the objects that intersect the view frustum.
+	 *
+	 * @param viewProjection The view projection matrix the frustum is extracted from.
+	 * @param visible Receives the indices of the visible objects, in increasing order.
+	 * @param pool Thread pool to split large object counts across, or nullptr.
+	 */
+	void Cull(const glm::mat4& viewProjection, std::vector<unsigned int>& visible, ThreadPool* pool = nullptr);
+
+	/**
+	 * @brief Extracts the six normalized clip planes of a view projection matrix.
+	 *
+	 * A point p is inside plane i when dot(planes[i], vec4(p, 1)) >= 0.
+	 *
+	 * @param viewProjection The view projection matrix.
+	 * @param planes Receives the left, right, bottom, top, near and far planes.
+	 */
+	static void ExtractPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+
+private:
+	/**
+	 * @brief Appends the visible objects of a range, which must start at a multiple of 8.
+	 *
+	 * @param planes The frustum planes.
+	 * @param begin First object of the range.
+	 * @param end Object past the end of the range.
+	 * @param visible Receives the indices of the visible objects.
+	 */
+	void CullRange(const glm::vec4 planes[6], size_t begin, size_t end, std::vector<unsigned int>& visible) const;
+};
@@ -0,0 +1,82 @@
+#include "GLDebug.h"
+#include <iostream>
+
+/// Call site reported before the first GLCall.
+static const GLCallSite NoCallSite = { "(none)", "", 0 };
+
+std::atomic<const GLCallSite*> g_lastGLCall{ &NoCallSite };
+
+/// Whether debug messages are delivered inside the failing call, on the thread that made it.
+static bool s_synchronousOutput = false;
+
+/**
+ * @brief Clears all OpenGL errors by calling glGetError until no errors are left.
+ */
+void GLClearError() {
+	while (glGetError() != GL_NO_ERROR);
+}
+
+/**
+ * @brief Logs OpenGL errors with details of the function, file, and line number.
+ *
+ * @param function The name of the function where the error occurred.
+ * @param file The file where the error occurred.
+ * @param line The line number where the error occurred.
+ * @return true if no errors, false if there were errors.
+ */
+bool GLLogCall(const char* function, const char* file, int line) {
+	while (GLenum error = glGetError()) {
+		std::cout << "[OpenGL Error] (" << error << "): " << function << " " << file << ": " << line << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Receives KHR_debug messages and logs them with the most recent GLCall.
+ *
+ * Asynchronous messages may arrive on a driver thread, where breaking into the debugger would
+ * not show the failing call, so errors only break with synchronous output.
+ */
+static void GLAPIENTRY GLDebugMessageCallback(GLenum /*source*/, GLenum type, GLuint id, GLenum /*severity*/,
+	GLsizei /*length*/, const GLchar* message, const void* /*userParam*/)
+{
+	const GLCallSite& site = *g_lastGLCall.load(std::memory_order_relaxed);
+	const char* kind = type == GL_DEBUG_TYPE_ERROR ? "Error" : "Debug";
+	std::cout << "[OpenGL " << kind << "] (" << id << "): " << message << std::endl;
+	std::cout << "    " << (s_synchronousOutput ? "in " : "near ") << site.function << " " << site.file << ": " << site.line << std::endl;
+
+	if (type == GL_DEBUG_TYPE_ERROR && s_synchronousOutput)
+		ASSERT(false);
+}
+
+/**
+ * @brief Installs the KHR_debug message callback when GLCall uses asynchronous error checking.
+ *
+ * @param synchronous Whether messages are delivered inside the failing call.
+ * @return true if debug output is active, false otherwise.
+ */
+bool GLInitDebugOutput(bool synchronous)
+{
+#if MOTOR_GL_ERROR_CHECK == MOTOR_GL_ERROR_CHECK_ASYNC
+	if (!GLEW_VERSION_4_3 && !GLEW_KHR_debug) {
+		std::cout << "Warning: KHR_debug is not supported, OpenGL errors will not be reported!" << std::endl;
+		return false;
+	}
+
+	glEnable(GL_DEBUG_OUTPUT);
+	s_synchronousOutput = synchronous;
+	if (synchronous)
+		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	else
+		glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+	glDebugMessageCallback(GLDebugMessageCallback, nullptr);
+	// Notifications are informational chatter (buffer placement and the like)
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+	return true;
+#else
+	return false;
+#endif
+}
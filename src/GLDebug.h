@@ -0,0 +1,95 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <atomic>
+
+/*
+ * OpenGL error checking.
+ *
+ * MOTOR_GL_ERROR_CHECK selects how GLCall checks the wrapped call:
+ * - MOTOR_GL_ERROR_CHECK_NONE: GLCall expands to the bare call. Default in release builds.
+ * - MOTOR_GL_ERROR_CHECK_ASYNC: errors are reported by the driver through a KHR_debug message
+ *   callback (see GLInitDebugOutput). GLCall only records its call site so the callback can
+ *   say which call failed, with one relaxed atomic store. Default in debug builds.
+ * - MOTOR_GL_ERROR_CHECK_SYNC: glGetError is polled before and after every call. Exact but
+ *   forces a round trip to the driver per call, so it has to be requested explicitly.
+ */
+#define MOTOR_GL_ERROR_CHECK_NONE  0
+#define MOTOR_GL_ERROR_CHECK_ASYNC 1
+#define MOTOR_GL_ERROR_CHECK_SYNC  2
+
+#ifndef MOTOR_GL_ERROR_CHECK
+	#ifdef NDEBUG
+		#define MOTOR_GL_ERROR_CHECK MOTOR_GL_ERROR_CHECK_NONE
+	#else
+		#define MOTOR_GL_ERROR_CHECK MOTOR_GL_ERROR_CHECK_ASYNC
+	#endif
+#endif
+
+#if defined(_MSC_VER)
+	#define DEBUG_BREAK() __debugbreak()
+#elif defined(__GNUC__) || defined(__clang__)
+	#include <csignal>
+	#define DEBUG_BREAK() std::raise(SIGTRAP)
+#else
+	#include <cstdlib>
+	#define DEBUG_BREAK() std::abort()
+#endif
+
+#ifdef NDEBUG
+	#define ASSERT(x) do { (void)(x); } while (0) // Still evaluate x, for its side effects
+#else
+	#define ASSERT(x) do { if (!(x)) DEBUG_BREAK(); } while (0) // Break debugging if x returns false
+#endif
+
+#if MOTOR_GL_ERROR_CHECK == MOTOR_GL_ERROR_CHECK_SYNC
+	#define GLCall(x) do { GLClearError(); x; if (!GLLogCall(#x, __FILE__, __LINE__)) ASSERT(false); } while (0) // Wrap a function with an error boundary
+#elif MOTOR_GL_ERROR_CHECK == MOTOR_GL_ERROR_CHECK_ASYNC
+	#define GLCall(x) do { static const GLCallSite glCallSite = { #x, __FILE__, __LINE__ }; \
+		g_lastGLCall.store(&glCallSite, std::memory_order_relaxed); x; } while (0) // Remember the call site for the debug callback
+#else
+	#define GLCall(x) x
+#endif
+
+/**
+ * @brief Location of a wrapped OpenGL call.
+ */
+struct GLCallSite {
+	const char* function; ///< Source text of the call.
+	const char* file;     ///< File the call is in.
+	int line;             ///< Line the call is on.
+};
+
+/// Most recent GLCall, used to attribute debug messages. Shared by every thread because the
+/// driver may deliver asynchronous messages on a thread of its own.
+extern std::atomic<const GLCallSite*> g_lastGLCall;
+
+/**
+ * @brief Clears all OpenGL errors.
+ */
+void GLClearError();
+
+/**
+ * @brief Logs OpenGL errors with details of the function, file, and line number..
+ *
+ * @param function The name of the function where the error occurred.
+ * @param file The file where the error occurred.
+ * @param line The line number where the error occurred.
+ * @return true if no errors, false if there were errors.
+ */
+bool GLLogCall(const char* function, const char* file, int line);
+
+/**
+ * @brief Installs the KHR_debug message callback when GLCall uses asynchronous error checking.
+ *
+ * Must be called once the context is current and GLEW is initialized. The context should be
+ * created with GLFW_OPENGL_DEBUG_CONTEXT so that the driver actually generates messages.
+ *
+ * @param synchronous Whether messages are delivered inside the failing call. This makes the
+ * reported call site exact and lets errors break into the debugger in the failing call, but
+ * stops the driver from processing calls on its own thread. Otherwise the reported call site is
+ * only the last GLCall issued before the message, and errors are logged without breaking.
+ * @return true if debug output is active, false if error checking is not asynchronous or the
+ * context does not support KHR_debug.
+ */
+bool GLInitDebugOutput(bool synchronous = false);
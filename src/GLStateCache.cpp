@@ -0,0 +1,337 @@
+#include "GLStateCache.h"
+#include "Renderer.h"
+
+/// Value of a shadowed binding whose real state is not known.
+static const unsigned int Unknown = 0xFFFFFFFF;
+
+/// Number of shadowed capabilities, see GLStateCache::GetCapabilitySlot.
+static const int CapabilityCount = 4;
+
+/**
+ * @brief A range of a buffer bound to an indexed binding point.
+ */
+struct BufferRangeBinding {
+	unsigned int buffer; ///< Renderer ID of the buffer.
+	unsigned int offset; ///< Offset of the range in bytes.
+	unsigned int size;   ///< Size of the range in bytes.
+
+	bool operator==(const BufferRangeBinding& other) const {
+		return buffer == other.buffer && offset == other.offset && size == other.size;
+	}
+};
+
+/**
+ * @brief The shadowed state of the current context.
+ *
+ * Zero-initialized, which matches the default state of a newly created context.
+ */
+static struct {
+	unsigned int program;
+	unsigned int vertexArray;
+	unsigned int arrayBuffer;
+	unsigned int elementArrayBuffer;
+	unsigned int drawIndirectBuffer;
+	unsigned int activeTexture;
+	unsigned int textures[GLStateCache::MaxTextureUnits];
+	BufferRangeBinding uniformBuffers[GLStateCache::MaxUniformBufferBindings];
+	int capabilities[CapabilityCount]; ///< 1 enabled, 0 disabled, -1 unknown.
+	int colorMasked; ///< 1 if color writes are masked off, 0 if not, -1 unknown.
+	int depthMasked; ///< 1 if depth writes are masked off, 0 if not, -1 unknown.
+	GLStateCache::Stats stats;
+} s_state;
+
+/**
+ * @brief Counts a call and tells whether it has to reach OpenGL.
+ *
+ * @param cached The shadowed value, updated to value on a miss.
+ * @param value The requested value.
+ * @return true if the state changes and the call must be issued.
+ */
+template<typename T>
+static bool Update(T& cached, T value) {
+	if (cached == value) {
+		s_state.stats.hits++;
+		return false;
+	}
+	s_state.stats.misses++;
+	cached = value;
+	return true;
+}
+
+/**
+ * @brief Makes the given program current (glUseProgram).
+ *
+ * @param program Renderer ID of the program, or 0 for none.
+ */
+void GLStateCache::UseProgram(unsigned int program)
+{
+	if (Update(s_state.program, program)) {
+		GLCall(glUseProgram(program));
+	}
+}
+
+/**
+ * @brief Binds the given vertex array object (glBindVertexArray).
+ *
+ * @param vertexArray Renderer ID of the VAO, or 0 for none.
+ */
+void GLStateCache::BindVertexArray(unsigned int vertexArray)
+{
+	if (Update(s_state.vertexArray, vertexArray)) {
+		GLCall(glBindVertexArray(vertexArray));
+		s_state.elementArrayBuffer = Unknown; // The element buffer binding is part of the VAO state
+	}
+}
+
+/**
+ * @brief Binds a buffer to a target (glBindBuffer).
+ *
+ * @param target The buffer target.
+ * @param buffer Renderer ID of the buffer, or 0 for none.
+ */
+void GLStateCache::BindBuffer(unsigned int target, unsigned int buffer)
+{
+	unsigned int* cached = nullptr;
+	if (target == GL_ARRAY_BUFFER)
+		cached = &s_state.arrayBuffer;
+	else if (target == GL_ELEMENT_ARRAY_BUFFER)
+		cached = &s_state.elementArrayBuffer;
+	else if (target == GL_DRAW_INDIRECT_BUFFER)
+		cached = &s_state.drawIndirectBuffer;
+
+	if (!cached) {
+		s_state.stats.misses++;
+		GLCall(glBindBuffer(target, buffer));
+	}
+	else if (Update(*cached, buffer)) {
+		GLCall(glBindBuffer(target, buffer));
+	}
+}
+
+/**
+ * @brief Binds a range of a buffer to an indexed binding point (glBindBufferRange).
+ *
+ * @param target The indexed buffer target.
+ * @param index The binding point.
+ * @param buffer Renderer ID of the buffer.
+ * @param offset Offset of the range in bytes.
+ * @param size Size of the range in bytes.
+ */
+void GLStateCache::BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, unsigned int offset, unsigned int size)
+{
+	if (target != GL_UNIFORM_BUFFER || index >= MaxUniformBufferBindings) {
+		s_state.stats.misses++;
+		GLCall(glBindBufferRange(target, index, buffer, offset, size));
+	}
+	else if (Update(s_state.uniformBuffers[index], BufferRangeBinding{ buffer, offset, size })) {
+		GLCall(glBindBufferRange(target, index, buffer, offset, size));
+	}
+}
+
+/**
+ * @brief Selects the active texture unit (glActiveTexture).
+ *
+ * @param unit Zero-based index of the texture unit.
+ */
+void GLStateCache::ActiveTexture(unsigned int unit)
+{
+	if (Update(s_state.activeTexture, unit)) {
+		GLCall(glActiveTexture(GL_TEXTURE0 + unit));
+	}
+}
+
+/**
+ * @brief Binds a 2D texture to a texture unit, changing the active unit only if needed.
+ *
+ * @param unit Zero-based index of the texture unit.
+ * @param texture Renderer ID of the texture, or 0 for none.
+ */
+void GLStateCache::BindTexture(unsigned int unit, unsigned int texture)
+{
+	if (unit >= MaxTextureUnits) {
+		ActiveTexture(unit);
+		s_state.stats.misses++;
+		GLCall(glBindTexture(GL_TEXTURE_2D, texture));
+		return;
+	}
+
+	if (s_state.textures[unit] == texture) {
+		s_state.stats.hits++;
+		return;
+	}
+
+	ActiveTexture(unit);
+	Update(s_state.textures[unit], texture);
+	GLCall(glBindTexture(GL_TEXTURE_2D, texture));
+}
+
+/**
+ * @brief Enables or disables a capability (glEnable/glDisable).
+ *
+ * @param capability The capability to change.
+ * @param enabled Whether the capability should be enabled.
+ */
+void GLStateCache::SetCapability(unsigned int capability, bool enabled)
+{
+	int slot = GetCapabilitySlot(capability);
+	if (slot >= 0 && !Update(s_state.capabilities[slot], enabled ? 1 : 0))
+		return;
+	if (slot < 0)
+		s_state.stats.misses++;
+
+	if (enabled) {
+		GLCall(glEnable(capability));
+	}
+	else {
+		GLCall(glDisable(capability));
+	}
+}
+
+/**
+ * @brief Enables or disables writes to every color channel (glColorMask).
+ *
+ * @param enabled Whether color is written.
+ */
+void GLStateCache::SetColorMask(bool enabled)
+{
+	if (Update(s_state.colorMasked, enabled ? 0 : 1)) {
+		const GLboolean write = enabled ? GL_TRUE : GL_FALSE;
+		GLCall(glColorMask(write, write, write, write));
+	}
+}
+
+/**
+ * @brief Enables or disables depth writes (glDepthMask).
+ *
+ * @param enabled Whether depth is written.
+ */
+void GLStateCache::SetDepthMask(bool enabled)
+{
+	if (Update(s_state.depthMasked, enabled ? 0 : 1)) {
+		GLCall(glDepthMask(enabled ? GL_TRUE : GL_FALSE));
+	}
+}
+
+/**
+ * @brief Gets the zero-based index of the active texture unit.
+ *
+ * @return unsigned int The active texture unit, 0 if it is unknown.
+ */
+unsigned int GLStateCache::GetActiveTexture()
+{
+	return s_state.activeTexture == Unknown ? 0 : s_state.activeTexture;
+}
+
+/**
+ * @brief Forgets a deleted program.
+ *
+ * @param program Renderer ID of the deleted program.
+ */
+void GLStateCache::OnProgramDeleted(unsigned int program)
+{
+	// A current program is only flagged for deletion, but its name may be recycled later
+	if (s_state.program == program)
+		s_state.program = Unknown;
+}
+
+/**
+ * @brief Forgets a deleted vertex array object. OpenGL reverts its binding to 0.
+ *
+ * @param vertexArray Renderer ID of the deleted VAO.
+ */
+void GLStateCache::OnVertexArrayDeleted(unsigned int vertexArray)
+{
+	if (s_state.vertexArray == vertexArray) {
+		s_state.vertexArray = 0;
+		s_state.elementArrayBuffer = Unknown;
+	}
+}
+
+/**
+ * @brief Forgets a deleted buffer. OpenGL reverts its bindings to 0.
+ *
+ * @param buffer Renderer ID of the deleted buffer.
+ */
+void GLStateCache::OnBufferDeleted(unsigned int buffer)
+{
+	if (s_state.arrayBuffer == buffer)
+		s_state.arrayBuffer = 0;
+	if (s_state.drawIndirectBuffer == buffer)
+		s_state.drawIndirectBuffer = 0;
+	// The buffer may still be referenced by VAOs that are not bound, so do not assume 0 here
+	if (s_state.elementArrayBuffer == buffer)
+		s_state.elementArrayBuffer = Unknown;
+	for (BufferRangeBinding& binding : s_state.uniformBuffers) {
+		if (binding.buffer == buffer)
+			binding = BufferRangeBinding();
+	}
+}
+
+/**
+ * @brief Forgets a deleted texture. OpenGL reverts its bindings to 0.
+ *
+ * @param texture Renderer ID of the deleted texture.
+ */
+void GLStateCache::OnTextureDeleted(unsigned int texture)
+{
+	for (unsigned int& bound : s_state.textures) {
+		if (bound == texture)
+			bound = 0;
+	}
+}
+
+/**
+ * @brief Marks all shadowed state as unknown so the next call of each kind reaches OpenGL.
+ */
+void GLStateCache::Invalidate()
+{
+	s_state.program = Unknown;
+	s_state.vertexArray = Unknown;
+	s_state.arrayBuffer = Unknown;
+	s_state.elementArrayBuffer = Unknown;
+	s_state.drawIndirectBuffer = Unknown;
+	s_state.activeTexture = Unknown;
+	for (unsigned int& bound : s_state.textures)
+		bound = Unknown;
+	for (BufferRangeBinding& binding : s_state.uniformBuffers)
+		binding.buffer = Unknown;
+	for (int& capability : s_state.capabilities)
+		capability = -1;
+	s_state.colorMasked = -1;
+	s_state.depthMasked = -1;
+}
+
+/**
+ * @brief Gets the hit and miss counters accumulated since the last ResetStats.
+ *
+ * @return const Stats& The counters.
+ */
+const GLStateCache::Stats& GLStateCache::GetStats()
+{
+	return s_state.stats;
+}
+
+/**
+ * @brief Resets the hit and miss counters, typically once per frame.
+ */
+void GLStateCache::ResetStats()
+{
+	s_state.stats = Stats();
+}
+
+/**
+ * @brief Maps a shadowed capability to its slot in the capability table.
+ *
+ * @param capability The capability.
+ * @return int Slot of the capability, or -1 if it is not shadowed.
+ */
+int GLStateCache::GetCapabilitySlot(unsigned int capability)
+{
+	switch (capability) {
+	case GL_BLEND:        return 0;
+	case GL_DEPTH_TEST:   return 1;
+	case GL_CULL_FACE:    return 2;
+	case GL_SCISSOR_TEST: return 3;
+	}
+	return -1;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+/**
+ * @brief Shadow copy of the OpenGL binding state of the current context.
+ *
+ * Every bind in the engine goes through this class, which remembers what is currently bound
+ * and skips the GL call when it would not change anything. Objects that are deleted must be
+ * reported so that a recycled name is not mistaken for a binding that is still current.
+ * Code that changes bindings behind the cache's back must call Invalidate afterwards.
+ */
+class GLStateCache {
+public:
+	/**
+	 * @brief Counters of the calls that went through the cache.
+	 */
+	struct Stats {
+		unsigned int hits = 0;   ///< Calls skipped because the state was already set.
+		unsigned int misses = 0; ///< Calls forwarded to OpenGL.
+	};
+
+	/// Number of texture units whose bindings are shadowed. Higher units bypass the cache.
+	static const unsigned int MaxTextureUnits = 32;
+
+	/// Number of uniform buffer binding points whose ranges are shadowed. Higher points bypass the cache.
+	static const unsigned int MaxUniformBufferBindings = 16;
+
+	/**
+	 * @brief Makes the given program current (glUseProgram).
+	 *
+	 * @param program Renderer ID of the program, or 0 for none.
+	 */
+	static void UseProgram(unsigned int program);
+
+	/**
+	 * @brief Binds the given vertex array object (glBindVertexArray).
+	 *
+	 * @param vertexArray Renderer ID of the VAO, or 0 for none.
+	 */
+	static void BindVertexArray(unsigned int vertexArray);
+
+	/**
+	 * @brief Binds a buffer to a target (glBindBuffer).
+	 *
+	 * GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER and GL_DRAW_INDIRECT_BUFFER are shadowed, other
+	 * targets are forwarded.
+	 *
+	 * @param target The buffer target.
+	 * @param buffer Renderer ID of the buffer, or 0 for none.
+	 */
+	static void BindBuffer(unsigned int target, unsigned int buffer);
+
+	/**
+	 * @brief Binds a range of a buffer to an indexed binding point (glBindBufferRange).
+	 *
+	 * GL_UNIFORM_BUFFER binding points are shadowed, other targets are forwarded. The generic
+	 * binding of the target is changed as a side effect and is not shadowed.
+	 *
+	 * @param target The indexed buffer target.
+	 * @param index The binding point.
+	 * @param buffer Renderer ID of the buffer.
+	 * @param offset Offset of the range in bytes.
+	 * @param size Size of the range in bytes.
+	 */
+	static void BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, unsigned int offset, unsigned int size);
+
+	/**
+	 * @brief Selects the active texture unit (glActiveTexture).
+	 *
+	 * @param unit Zero-based index of the texture unit.
+	 */
+	static void ActiveTexture(unsigned int unit);
+
+	/**
+	 * @brief Binds a 2D texture to a texture unit, changing the active unit only if needed.
+	 *
+	 * @param unit Zero-based index of the texture unit.
+	 * @param texture Renderer ID of the texture, or 0 for none.
+	 */
+	static void BindTexture(unsigned int unit, unsigned int texture);
+
+	/**
+	 * @brief Enables or disables a capability (glEnable/glDisable).
+	 *
+	 * GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE and GL_SCISSOR_TEST are shadowed, others are forwarded.
+	 *
+	 * @param capability The capability to change.
+	 * @param enabled Whether the capability should be enabled.
+	 */
+	static void SetCapability(unsigned int capability, bool enabled);
+
+	/**
+	 * @brief Enables or disables writes to every color channel (glColorMask).
+	 *
+	 * @param enabled Whether color is written.
+	 */
+	static void SetColorMask(bool enabled);
+
+	/**
+	 * @brief Enables or disables depth writes (glDepthMask).
+	 *
+	 * @param enabled Whether depth is written.
+	 */
+	static void SetDepthMask(bool enabled);
+
+	/**
+	 * @brief Gets the zero-based index of the active texture unit.
+	 *
+	 * @return unsigned int The active texture unit, 0 if it is unknown.
+	 */
+	static unsigned int GetActiveTexture();
+
+	/**
+	 * @brief Forgets a deleted program.
+	 *
+	 * @param program Renderer ID of the deleted program.
+	 */
+	static void OnProgramDeleted(unsigned int program);
+
+	/**
+	 * @brief Forgets a deleted vertex array object. OpenGL reverts its binding to 0.
+	 *
+	 * @param vertexArray Renderer ID of the deleted VAO.
+	 */
+	static void OnVertexArrayDeleted(unsigned int vertexArray);
+
+	/**
+	 * @brief Forgets a deleted buffer. OpenGL reverts its bindings to 0.
+	 *
+	 * @param buffer Renderer ID of the deleted buffer.
+	 */
+	static void OnBufferDeleted(unsigned int buffer);
+
+	/**
+	 * @brief Forgets a deleted texture. OpenGL reverts its bindings to 0.
+	 *
+	 * @param texture Renderer ID of the deleted texture.
+	 */
+	static void OnTextureDeleted(unsigned int texture);
+
+	/**
+	 * @brief Marks all shadowed state as unknown so the next call of each kind reaches OpenGL.
+	 */
+	static void Invalidate();
+
+	/**
+	 * @brief Gets the hit and miss counters accumulated since the last ResetStats.
+	 *
+	 * @return const Stats& The counters.
+	 */
+	static const Stats& GetStats();
+
+	/**
+	 * @brief Resets the hit and miss counters, typically once per frame.
+	 */
+	static void ResetStats();
+
+private:
+	/**
+	 * @brief Maps a shadowed capability to its slot in the capability table.
+	 *
+	 * @param capability The capability.
+	 * @return int Slot of the capability, or -1 if it is not shadowed.
+	 */
+	static int GetCapabilitySlot(unsigned int capability);
+};
@@ -0,0 +1,161 @@
+#include "GpuProfiler.h"
+#include "Renderer.h"
+
+#include <algorithm>
+
+/**
+ * @brief Constructs a GpuProfiler. The OpenGL context must be current.
+ */
+GpuProfiler::GpuProfiler()
+	: m_frameIndex(0), m_droppedFrames(0), m_debugGroups(GLEW_VERSION_4_3 || GLEW_KHR_debug)
+{
+}
+
+/**
+ * @brief Destroys the GpuProfiler and deletes its query objects.
+ */
+GpuProfiler::~GpuProfiler()
+{
+	for (FrameQueries& frame : m_frames) {
+		if (!frame.queries.empty()) {
+			GLCall(glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data()));
+		}
+	}
+}
+
+/**
+ * @brief Reads back the frame recorded FrameLatency frames ago and starts a new frame.
+ */
+void GpuProfiler::BeginFrame()
+{
+	FrameQueries& frame = m_frames[m_frameIndex % FrameLatency];
+	Resolve(frame);
+	frame.usedQueries = 0;
+	frame.passes.clear();
+
+	BeginPass("Frame");
+}
+
+/**
+ * @brief Ends the frame started by BeginFrame. Every pass must have ended.
+ */
+void GpuProfiler::EndFrame()
+{
+	ASSERT(m_openPasses.size() == 1);
+	EndPass();
+	m_frameIndex++;
+}
+
+/**
+ * @brief Starts a pass. Passes can nest and must end in reverse order.
+ *
+ * @param name Name of the pass, which must stay valid until the pass is read back.
+ */
+void GpuProfiler::BeginPass(const char* name)
+{
+	if (m_debugGroups) {
+		GLCall(glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name));
+	}
+
+	FrameQueries& frame = m_frames[m_frameIndex % FrameLatency];
+	m_openPasses.push_back((unsigned int)frame.passes.size());
+	frame.passes.push_back({ name, RecordTimestamp(), 0 });
+}
+
+/**
+ * @brief Ends the innermost pass.
+ */
+void GpuProfiler::EndPass()
+{
+	ASSERT(!m_openPasses.empty());
+	FrameQueries& frame = m_frames[m_frameIndex % FrameLatency];
+	frame.passes[m_openPasses.back()].endQuery = RecordTimestamp();
+	m_openPasses.pop_back();
+
+	if (m_debugGroups) {
+		GLCall(glPopDebugGroup());
+	}
+}
+
+/**
+ * @brief Gets the statistics of one pass.
+ *
+ * @param name Name of the pass.
+ * @return const GpuPassStats* The statistics, or nullptr if the pass was not read back yet.
+ */
+const GpuPassStats* GpuProfiler::GetPassStats(const std::string& name) const
+{
+	auto it = m_stats.find(name);
+	return it != m_stats.end() ? &it->second : nullptr;
+}
+
+/**
+ * @brief Clears the statistics of every pass.
+ */
+void GpuProfiler::ResetStats()
+{
+	m_stats.clear();
+	m_droppedFrames = 0;
+}
+
+/**
+ * @brief Records a timestamp query for the current frame.
+ *
+ * @return unsigned int Renderer ID of the query.
+ */
+unsigned int GpuProfiler::RecordTimestamp()
+{
+	FrameQueries& frame = m_frames[m_frameIndex % FrameLatency];
+	if (frame.usedQueries == frame.queries.size()) {
+		unsigned int query;
+		GLCall(glGenQueries(1, &query));
+		frame.queries.push_back(query);
+	}
+
+	unsigned int query = frame.queries[frame.usedQueries++];
+	GLCall(glQueryCounter(query, GL_TIMESTAMP));
+	return query;
+}
+
+/**
+ * @brief Reads the results of a frame into the statistics if they are available.
+ *
+ * @param frame The frame to read.
+ */
+void GpuProfiler::Resolve(FrameQueries& frame)
+{
+	if (frame.usedQueries == 0)
+		return;
+
+	// Queries complete in order, so the frame is done once its last query is
+	GLuint available = GL_FALSE;
+	GLCall(glGetQueryObjectuiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+	if (!available) {
+		m_droppedFrames++;
+		return;
+	}
+
+	m_frameTimes.clear();
+	for (const PassQuery& pass : frame.passes) {
+		GLuint64 begin = 0, end = 0;
+		GLCall(glGetQueryObjectui64v(pass.beginQuery, GL_QUERY_RESULT, &begin));
+		GLCall(glGetQueryObjectui64v(pass.endQuery, GL_QUERY_RESULT, &end));
+		m_frameTimes[pass.name] += (end - begin) / 1000000.0;
+	}
+
+	for (const auto& frameTime : m_frameTimes) {
+		const double ms = frameTime.second;
+		GpuPassStats& stats = m_stats[frameTime.first];
+		stats.lastMs = ms;
+		if (stats.sampleCount == 0) {
+			stats.minMs = ms;
+			stats.maxMs = ms;
+		}
+		else {
+			stats.minMs = std::min(stats.minMs, ms);
+			stats.maxMs = std::max(stats.maxMs, ms);
+		}
+		stats.sampleCount++;
+		stats.avgMs += (ms - stats.avgMs) / stats.sampleCount;
+	}
+}
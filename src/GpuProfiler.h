@@ -0,0 +1,171 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief GPU time statistics of one pass, in milliseconds.
+ */
+struct GpuPassStats {
+	double lastMs = 0.0;          ///< Time of the most recent frame that was read back.
+	double minMs = 0.0;           ///< Shortest time since the last ResetStats.
+	double avgMs = 0.0;           ///< Average time since the last ResetStats.
+	double maxMs = 0.0;           ///< Longest time since the last ResetStats.
+	unsigned int sampleCount = 0; ///< Number of frames the statistics cover.
+};
+
+/**
+ * @brief GpuProfiler class that measures the GPU time of render passes with timer queries.
+ *
+ * Every pass records a GL_TIMESTAMP query when it begins and when it ends, so passes may nest.
+ * Queries of a frame are only read back FrameLatency frames later, by which time the GPU has
+ * long finished them, so profiling never stalls the pipeline; a frame whose results are still
+ * not available is dropped instead of waited for. Passes are also pushed as KHR_debug groups
+ * so tools such as RenderDoc show the same scopes.
+ *
+ * Every frame is measured as a pass named "Frame". Passes that share a name within a frame are
+ * added up, so a pass begun once per draw reports the total time of those draws.
+ */
+class GpuProfiler {
+public:
+	/// Number of frames between recording a query and reading it back.
+	static const unsigned int FrameLatency = 4;
+
+private:
+	/**
+	 * @brief Queries of one pass.
+	 */
+	struct PassQuery {
+		const char* name;         ///< Name of the pass.
+		unsigned int beginQuery;  ///< Timestamp query recorded when the pass began.
+		unsigned int endQuery;    ///< Timestamp query recorded when the pass ended.
+	};
+
+	/**
+	 * @brief Queries of one frame in the ring.
+	 */
+	struct FrameQueries {
+		std::vector<unsigned int> queries; ///< Query objects owned by the frame, reused every time the slot comes around
+		unsigned int usedQueries = 0;      ///< Number of queries recorded this time
+		std::vector<PassQuery> passes;     ///< Passes recorded this time, in the order they began
+	};
+
+	FrameQueries m_frames[FrameLatency]; ///< Ring of frames
+	unsigned int m_frameIndex; ///< Index of the current frame
+	std::vector<unsigned int> m_openPasses; ///< Passes of the current frame that have not ended, innermost last
+	std::unordered_map<std::string, GpuPassStats> m_stats; ///< Statistics of each pass name
+	std::unordered_map<std::string, double> m_frameTimes; ///< Scratch map summing the passes of the frame being read back
+	unsigned int m_droppedFrames; ///< Frames whose results were not available in time
+	bool m_debugGroups; ///< Whether the context supports glPushDebugGroup
+
+public:
+	/**
+	 * @brief Constructs a GpuProfiler. The OpenGL context must be current.
+	 */
+	GpuProfiler();
+
+	/**
+	 * @brief Destroys the GpuProfiler and deletes its query objects.
+	 */
+	~GpuProfiler();
+
+	/**
+	 * @brief Reads back the frame recorded FrameLatency frames ago and starts a new frame.
+	 */
+	void BeginFrame();
+
+	/**
+	 * @brief Ends the frame started by BeginFrame. Every pass must have ended.
+	 */
+	void EndFrame();
+
+	/**
+	 * @brief Starts a pass. Passes can nest and must end in reverse order.
+	 *
+	 * @param name Name of the pass, which must stay valid until the pass is read back.
+	 * String literals are expected.
+	 */
+	void BeginPass(const char* name);
+
+	/**
+	 * @brief Ends the innermost pass.
+	 */
+	void EndPass();
+
+	/**
+	 * @brief Gets the statistics of every pass that was read back since the last ResetStats.
+	 *
+	 * @return const std::unordered_map<std::string, GpuPassStats>& Statistics by pass name.
+	 */
+	inline const std::unordered_map<std::string, GpuPassStats>& GetStats() const { return m_stats; }
+
+	/**
+	 * @brief Gets the statistics of one pass.
+	 *
+	 * @param name Name of the pass.
+	 * @return const GpuPassStats* The statistics, or nullptr if the pass was not read back yet.
+	 */
+	const GpuPassStats* GetPassStats(const std::string& name) const;
+
+	/**
+	 * @brief Gets the number of frames dropped because their results were not available in time.
+	 *
+	 * @return unsigned int Number of dropped frames.
+	 */
+	inline unsigned int GetDroppedFrameCount() const { return m_droppedFrames; }
+
+	/**
+	 * @brief Clears the statistics of every pass.
+	 */
+	void ResetStats();
+
+private:
+	/**
+	 * @brief Records a timestamp query for the current frame.
+	 *
+	 * @return unsigned int Renderer ID of the query.
+	 */
+	unsigned int RecordTimestamp();
+
+	/**
+	 * @brief Reads the results of a frame into the statistics if they are available.
+	 *
+	 * @param frame The frame to read.
+	 */
+	void Resolve(FrameQueries& frame);
+};
+
+/**
+ * @brief GpuProfileScope class that profiles a pass for as long as it is in scope.
+ */
+class GpuProfileScope {
+private:
+	GpuProfiler* m_profiler; ///< Profiler the pass is recorded in, or nullptr
+
+public:
+	/**
+	 * @brief Begins a pass.
+	 *
+	 * @param profiler Profiler to record the pass in, or nullptr to do nothing.
+	 * @param name Name of the pass.
+	 */
+	GpuProfileScope(GpuProfiler* profiler, const char* name)
+		: m_profiler(profiler)
+	{
+		if (m_profiler)
+			m_profiler->BeginPass(name);
+	}
+
+	/**
+	 * @brief Ends the pass.
+	 */
+	~GpuProfileScope()
+	{
+		if (m_profiler)
+			m_profiler->EndPass();
+	}
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+};
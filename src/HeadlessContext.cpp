@@ -0,0 +1,190 @@
+#include "HeadlessContext.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+#include <iostream>
+
+#if MOTOR_HEADLESS_EGL
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+#endif
+
+/**
+ * @brief Constructs a HeadlessContext without a context. See Create.
+ */
+HeadlessContext::HeadlessContext()
+	: m_display(nullptr), m_surface(nullptr), m_context(nullptr), m_window(nullptr), m_backend("none")
+{
+}
+
+/**
+ * @brief Destroys the context. It must not be current on any thread.
+ */
+HeadlessContext::~HeadlessContext()
+{
+#if MOTOR_HEADLESS_EGL
+	if (m_display) {
+		if (m_surface)
+			eglDestroySurface(m_display, m_surface);
+		if (m_context)
+			eglDestroyContext(m_display, m_context);
+		eglTerminate(m_display);
+	}
+#endif
+	if (m_window)
+		glfwDestroyWindow(m_window);
+}
+
+#if MOTOR_HEADLESS_EGL
+/**
+ * @brief Tells whether a space-separated EGL extension string contains an extension.
+ *
+ * @param extensions The extension string, may be nullptr.
+ * @param name Name of the extension.
+ * @return true if the extension is listed.
+ */
+static bool HasEGLExtension(const char* extensions, const char* name)
+{
+	if (!extensions)
+		return false;
+
+	const size_t length = strlen(name);
+	for (const char* found = strstr(extensions, name); found; found = strstr(found + length, name)) {
+		if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+			return true;
+	}
+	return false;
+}
+#endif
+
+/**
+ * @brief Creates a core profile context.
+ *
+ * @param major Major OpenGL version.
+ * @param minor Minor OpenGL version.
+ * @param debug Whether to request a debug context.
+ * @return true if the context was created.
+ */
+bool HeadlessContext::Create(int major, int minor, bool debug)
+{
+#if MOTOR_HEADLESS_EGL
+	/* Prefer the surfaceless platform, which needs neither a GPU nor a display server */
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	EGLDisplay display = EGL_NO_DISPLAY;
+	if (HasEGLExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint eglMajor, eglMinor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor)) {
+		std::cout << "EGL: no display could be initialized" << std::endl;
+		return false;
+	}
+	m_display = display;
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cout << "EGL: desktop OpenGL is not supported" << std::endl;
+		return false;
+	}
+
+	const char* displayExtensions = eglQueryString(display, EGL_EXTENSIONS);
+	const bool surfaceless = HasEGLExtension(displayExtensions, "EGL_KHR_surfaceless_context");
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint configCount = 0;
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+		config = nullptr;
+		if (!surfaceless || !HasEGLExtension(displayExtensions, "EGL_KHR_no_config_context")) {
+			std::cout << "EGL: no pbuffer config" << std::endl;
+			return false;
+		}
+	}
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, major,
+		EGL_CONTEXT_MINOR_VERSION_KHR, minor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_CONTEXT_FLAGS_KHR, debug ? EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR : 0,
+		EGL_NONE
+	};
+	m_context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (m_context == EGL_NO_CONTEXT) {
+		m_context = nullptr;
+		std::cout << "EGL: could not create an OpenGL " << major << "." << minor << " core context" << std::endl;
+		return false;
+	}
+
+	/* Without surfaceless support a context still needs a surface to be made current */
+	if (!surfaceless) {
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		m_surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+		if (m_surface == EGL_NO_SURFACE) {
+			m_surface = nullptr;
+			std::cout << "EGL: could not create a pbuffer" << std::endl;
+			return false;
+		}
+	}
+
+	m_backend = surfaceless ? "EGL surfaceless" : "EGL pbuffer";
+	return true;
+#else
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, debug ? GLFW_TRUE : GLFW_FALSE);
+
+	m_window = glfwCreateWindow(1, 1, "Headless", NULL, NULL);
+	glfwDefaultWindowHints();
+	if (!m_window) {
+		std::cout << "GLFW: could not create a hidden window" << std::endl;
+		return false;
+	}
+
+	m_backend = "GLFW hidden window";
+	return true;
+#endif
+}
+
+/**
+ * @brief Makes the context current on the calling thread.
+ *
+ * @return true on success.
+ */
+bool HeadlessContext::MakeCurrent() const
+{
+#if MOTOR_HEADLESS_EGL
+	EGLSurface surface = m_surface ? m_surface : EGL_NO_SURFACE;
+	return eglMakeCurrent(m_display, surface, surface, m_context) == EGL_TRUE;
+#else
+	glfwMakeContextCurrent(m_window);
+	return m_window != nullptr;
+#endif
+}
+
+/**
+ * @brief Releases the context from the calling thread.
+ */
+void HeadlessContext::ReleaseCurrent() const
+{
+#if MOTOR_HEADLESS_EGL
+	eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+#else
+	glfwMakeContextCurrent(NULL);
+#endif
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+ * MOTOR_HEADLESS_EGL selects how HeadlessContext creates its context:
+ * - 1: through EGL, without any window system. Default on Linux, where build servers and
+ *   containers have no X or Wayland display. The executable must be linked with libEGL
+ *   (-lEGL), which OpenGL.vcxproj, a Windows project, does not do.
+ * - 0: through a hidden GLFW window. Default elsewhere. This still needs a window system, so
+ *   only EGL renders on machines without a display.
+ */
+#ifndef MOTOR_HEADLESS_EGL
+	#if defined(__linux__)
+		#define MOTOR_HEADLESS_EGL 1
+	#else
+		#define MOTOR_HEADLESS_EGL 0
+	#endif
+#endif
+
+struct GLFWwindow;
+
+/**
+ * @brief HeadlessContext class that creates an OpenGL core context without a visible window.
+ *
+ * With EGL, the surfaceless platform (EGL_MESA_platform_surfaceless) is preferred, which works
+ * with Mesa llvmpipe on machines without a GPU or display; otherwise the default display is
+ * used. The context is made current without a surface when EGL_KHR_surfaceless_context is
+ * available, and with a 1x1 pbuffer otherwise. Either way there is no default framebuffer to
+ * render into, so rendering goes to a Framebuffer.
+ *
+ * Without EGL, a hidden GLFW window provides the context.
+ */
+class HeadlessContext {
+private:
+	void* m_display; ///< EGLDisplay of the context, nullptr without EGL
+	void* m_surface; ///< EGLSurface made current with the context, nullptr when surfaceless
+	void* m_context; ///< EGLContext, nullptr without EGL
+	GLFWwindow* m_window; ///< Hidden window providing the context without EGL
+	const char* m_backend; ///< How the context was created, for logging
+
+public:
+	/**
+	 * @brief Constructs a HeadlessContext without a context. See Create.
+	 */
+	HeadlessContext();
+
+	/**
+	 * @brief Destroys the context. It must not be current on any thread.
+	 */
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	/**
+	 * @brief Creates a core profile context.
+	 *
+	 * Without EGL, GLFW must be initialized and this must be called on the main thread.
+	 *
+	 * @param major Major OpenGL version.
+	 * @param minor Minor OpenGL version.
+	 * @param debug Whether to request a debug context.
+	 * @return true if the context was created.
+	 */
+	bool Create(int major = 3, int minor = 3, bool debug = false);
+
+	/**
+	 * @brief Makes the context current on the calling thread.
+	 *
+	 * @return true on success.
+	 */
+	bool MakeCurrent() const;
+
+	/**
+	 * @brief Releases the context from the calling thread.
+	 */
+	void ReleaseCurrent() const;
+
+	/**
+	 * @brief Gets how the context was created.
+	 *
+	 * @return const char* "EGL surfaceless", "EGL pbuffer" or "GLFW hidden window", "none" before Create.
+	 */
+	inline const char* GetBackendName() const { return m_backend; }
+};
@@ -1,5 +1,6 @@
 #include "IndexBuffer.h"
 #include "Renderer.h"
+#include "GLStateCache.h"
 
 /**
  * @brief Constructs an IndexBuffer and initializes it with data.
@@ -11,7 +12,7 @@ IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count)
 	:m_count(count)
 {
 	GLCall(glGenBuffers(1, &m_rendererID));
-	GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_rendererID));
+	GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_rendererID);
 	GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, GL_STATIC_DRAW));
 }
 
@@ -20,7 +21,8 @@ IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count)
  */
 IndexBuffer::~IndexBuffer()
 {
-	GLCall(glDeleteBuffers(1, &m_rendererID))
+	GLCall(glDeleteBuffers(1, &m_rendererID));
+	GLStateCache::OnBufferDeleted(m_rendererID);
 }
 
 /**
@@ -28,7 +30,7 @@ IndexBuffer::~IndexBuffer()
  */
 void IndexBuffer::Bind() const
 {
-	GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_rendererID));
+	GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_rendererID);
 }
 
 /**
@@ -36,5 +38,5 @@ void IndexBuffer::Bind() const
  */
 void IndexBuffer::Unbind() const
 {
-	GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+	GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
\ No newline at end of file
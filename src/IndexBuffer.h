@@ -39,4 +39,11 @@ public:
 	 * @return unsigned int Number of indices.
 	 */
 	inline unsigned int GetCount() const { return m_count; }
+
+	/**
+	 * @brief Gets the renderer ID of the index buffer.
+	 *
+	 * @return unsigned int Renderer ID of the buffer.
+	 */
+	inline unsigned int GetRendererID() const { return m_rendererID; }
 };
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "IndirectDrawBuffer.h"
+#include "Renderer.h"
+#include "GLStateCache.h"
+
+/**
+ * @brief Constructs an empty IndirectDrawBuffer.
+ */
+IndirectDrawBuffer::IndirectDrawBuffer()
+	: m_rendererID(0), m_capacity(0), m_instanceCount(0), m_dirty(false)
+{
+	GLCall(glGenBuffers(1, &m_rendererID));
+}
+
+/**
+ * @brief Destroys the IndirectDrawBuffer and deletes its GPU buffer.
+ */
+IndirectDrawBuffer::~IndirectDrawBuffer()
+{
+	GLCall(glDeleteBuffers(1, &m_rendererID));
+	GLStateCache::OnBufferDeleted(m_rendererID);
+}
+
+/**
+ * @brief Records a draw of a mesh packed into the shared vertex and index buffers.
+ *
+ * @param count Number of indices of the mesh.
+ * @param firstIndex Offset of the first index of the mesh, in indices.
+ * @param baseVertex Offset of the first vertex of the mesh, in vertices.
+ * @param instanceCount Number of instances to draw.
+ * @return unsigned int The first instance row of the draw, where its per-draw data goes.
+ */
+unsigned int IndirectDrawBuffer::AddDraw(unsigned int count, unsigned int firstIndex, int baseVertex, unsigned int instanceCount)
+{
+	unsigned int baseInstance = m_instanceCount;
+	m_commands.push_back({ count, instanceCount, firstIndex, baseVertex, baseInstance });
+	m_instanceCount += instanceCount;
+	m_dirty = true;
+	return baseInstance;
+}
+
+/**
+ * @brief Removes all recorded draws.
+ */
+void IndirectDrawBuffer::Clear()
+{
+	m_commands.clear();
+	m_instanceCount = 0;
+	m_dirty = true;
+}
+
+/**
+ * @brief Uploads the recorded draws to the GPU if they changed since the last upload.
+ *
+ * The buffer only grows, and is orphaned on every upload so that draws still reading the
+ * previous commands do not stall the CPU.
+ */
+void IndirectDrawBuffer::Upload()
+{
+	if (!m_dirty)
+		return;
+
+	Bind();
+	unsigned int count = (unsigned int)m_commands.size();
+	if (count > m_capacity)
+		m_capacity = count;
+	GLCall(glBufferData(GL_DRAW_INDIRECT_BUFFER, m_capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW));
+	GLCall(glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, count * sizeof(DrawElementsIndirectCommand), m_commands.data()));
+	m_dirty = false;
+}
+
+/**
+ * @brief Binds the buffer to GL_DRAW_INDIRECT_BUFFER.
+ */
+void IndirectDrawBuffer::Bind() const
+{
+	GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_rendererID);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * @brief Parameters of one indexed draw, in the layout glMultiDrawElementsIndirect reads.
+ */
+struct DrawElementsIndirectCommand {
+	unsigned int count;         ///< Number of indices to draw.
+	unsigned int instanceCount; ///< Number of instances to draw.
+	unsigned int firstIndex;    ///< Offset of the first index in the index buffer, in indices.
+	int baseVertex;             ///< Value added to every index before fetching vertices.
+	unsigned int baseInstance;  ///< First row of per-instance attributes used by the draw.
+};
+
+/**
+ * @brief IndirectDrawBuffer class that collects draws for a single multi-draw indirect call.
+ *
+ * All draws of the buffer share one vertex array, index buffer and shader. Meshes are packed
+ * into the same vertex and index buffers and each draw selects its mesh with firstIndex and
+ * baseVertex. Per-draw data (transform, color, ...) lives in a per-instance vertex buffer:
+ * every draw gets its own range of instance rows through baseInstance, so the vertex shader
+ * reads it as an ordinary instanced attribute without knowing the draw index.
+ */
+class IndirectDrawBuffer {
+private:
+	unsigned int m_rendererID; ///< Renderer ID of the GL_DRAW_INDIRECT_BUFFER
+	unsigned int m_capacity; ///< Number of commands the GPU buffer can hold
+	unsigned int m_instanceCount; ///< Number of instance rows used by the recorded draws
+	bool m_dirty; ///< Whether the commands changed since the last Upload
+	std::vector<DrawElementsIndirectCommand> m_commands; ///< Recorded draws
+
+public:
+	/**
+	 * @brief Constructs an empty IndirectDrawBuffer.
+	 */
+	IndirectDrawBuffer();
+
+	/**
+	 * @brief Destroys the IndirectDrawBuffer and deletes its GPU buffer.
+	 */
+	~IndirectDrawBuffer();
+
+	/**
+	 * @brief Records a draw of a mesh packed into the shared vertex and index buffers.
+	 *
+	 * @param count Number of indices of the mesh.
+	 * @param firstIndex Offset of the first index of the mesh, in indices.
+	 * @param baseVertex Offset of the first vertex of the mesh, in vertices.
+	 * @param instanceCount Number of instances to draw.
+	 * @return unsigned int The first instance row of the draw, where its per-draw data goes.
+	 */
+	unsigned int AddDraw(unsigned int count, unsigned int firstIndex, int baseVertex, unsigned int instanceCount = 1);
+
+	/**
+	 * @brief Removes all recorded draws.
+	 */
+	void Clear();
+
+	/**
+	 * @brief Uploads the recorded draws to the GPU if they changed since the last upload.
+	 */
+	void Upload();
+
+	/**
+	 * @brief Binds the buffer to GL_DRAW_INDIRECT_BUFFER.
+	 */
+	void Bind() const;
+
+	/**
+	 * @brief Gets the recorded draws.
+	 *
+	 * @return const std::vector<DrawElementsIndirectCommand>& The recorded draws.
+	 */
+	inline const std::vector<DrawElementsIndirectCommand>& GetCommands() const { return m_commands; }
+
+	/**
+	 * @brief Gets the number of recorded draws.
+	 *
+	 * @return unsigned int Number of draws.
+	 */
+	inline unsigned int GetDrawCount() const { return (unsigned int)m_commands.size(); }
+
+	/**
+	 * @brief Gets the number of instance rows used by the recorded draws.
+	 *
+	 * @return unsigned int Number of rows the per-instance buffer needs.
+	 */
+	inline unsigned int GetInstanceCount() const { return m_instanceCount; }
+};
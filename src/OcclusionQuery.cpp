@@ -0,0 +1,101 @@
+#include "OcclusionQuery.h"
+#include "Renderer.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+/**
+ * @brief Constructs an OcclusionQuery for an object with the given bounding box.
+ *
+ * @param min Minimum corner of the bounding box, in model space.
+ * @param max Maximum corner of the bounding box, in model space.
+ */
+OcclusionQuery::OcclusionQuery(const glm::vec3& min, const glm::vec3& max)
+	: m_issued(0), m_resolved(0), m_visible(true), m_min(min), m_max(max)
+{
+	GLCall(glGenQueries(RingSize, m_queries));
+}
+
+/**
+ * @brief Destroys the OcclusionQuery and deletes its query objects.
+ */
+OcclusionQuery::~OcclusionQuery()
+{
+	GLCall(glDeleteQueries(RingSize, m_queries));
+}
+
+/**
+ * @brief Starts a query in the next slot of the ring. Samples drawn until End are counted.
+ */
+void OcclusionQuery::Begin()
+{
+	// The slot being reused holds the oldest query, drop it if its result never arrived
+	if (m_issued - m_resolved >= RingSize)
+		m_resolved = m_issued - RingSize + 1;
+
+	GLCall(glBeginQuery(GetTarget(), m_queries[m_issued % RingSize]));
+	m_issued++;
+}
+
+/**
+ * @brief Ends the query started by Begin.
+ */
+void OcclusionQuery::End() const
+{
+	GLCall(glEndQuery(GetTarget()));
+}
+
+/**
+ * @brief Reads every query result that is available without waiting for the GPU.
+ *
+ * @return true if the object was visible in the most recent available result, or if no
+ * result is available yet.
+ */
+bool OcclusionQuery::IsVisible()
+{
+	// Queries complete in order, so stop at the first one that is still pending
+	while (m_resolved < m_issued) {
+		const unsigned int query = m_queries[m_resolved % RingSize];
+		GLuint available = GL_FALSE;
+		GLCall(glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available));
+		if (!available)
+			break;
+
+		GLuint samplesPassed = 0;
+		GLCall(glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samplesPassed));
+		m_visible = samplesPassed != 0;
+		m_resolved++;
+	}
+	return m_visible;
+}
+
+/**
+ * @brief Gets the query started by the last Begin, for glBeginConditionalRender.
+ *
+ * @return unsigned int Renderer ID of the query.
+ */
+unsigned int OcclusionQuery::GetCurrentID() const
+{
+	return m_queries[(m_issued + RingSize - 1) % RingSize];
+}
+
+/**
+ * @brief Gets the transform that maps the unit cube [0, 1]^3 onto the bounding box.
+ *
+ * @return glm::mat4 The model space transform of the proxy box.
+ */
+glm::mat4 OcclusionQuery::GetProxyTransform() const
+{
+	return glm::scale(glm::translate(glm::mat4(1.0f), m_min), m_max - m_min);
+}
+
+/**
+ * @brief Gets the query target: GL_ANY_SAMPLES_PASSED_CONSERVATIVE when supported,
+ * GL_ANY_SAMPLES_PASSED otherwise.
+ *
+ * @return unsigned int The query target.
+ */
+unsigned int OcclusionQuery::GetTarget()
+{
+	// The conservative variant lets the driver answer from coarse depth data
+	return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+/**
+ * @brief OcclusionQuery class that tracks whether an object was hidden behind what was drawn
+ * before it.
+ *
+ * Each frame the renderer draws the object's bounding box with depth testing and no color or
+ * depth writes inside a query. Results are read back frames later and only once the GPU has
+ * them, so the CPU never waits: IsVisible reports the most recent result that is available,
+ * which lags a frame or two behind. The query objects form a ring so a new query can start
+ * while older ones are still in flight.
+ */
+class OcclusionQuery {
+public:
+	/// Number of queries in flight before the oldest one is reused.
+	static const unsigned int RingSize = 3;
+
+private:
+	unsigned int m_queries[RingSize]; ///< Renderer IDs of the query objects
+	unsigned int m_issued; ///< Number of queries started so far
+	unsigned int m_resolved; ///< Number of queries whose result was read or dropped
+	bool m_visible; ///< Most recent available result
+	glm::vec3 m_min; ///< Minimum corner of the bounding box, in model space
+	glm::vec3 m_max; ///< Maximum corner of the bounding box, in model space
+
+public:
+	/**
+	 * @brief Constructs an OcclusionQuery for an object with the given bounding box.
+	 *
+	 * @param min Minimum corner of the bounding box, in model space.
+	 * @param max Maximum corner of the bounding box, in model space.
+	 */
+	OcclusionQuery(const glm::vec3& min, const glm::vec3& max);
+
+	/**
+	 * @brief Destroys the OcclusionQuery and deletes its query objects.
+	 */
+	~OcclusionQuery();
+
+	/**
+	 * @brief Starts a query in the next slot of the ring. Samples drawn until End are counted.
+	 */
+	void Begin();
+
+	/**
+	 * @brief Ends the query started by Begin.
+	 */
+	void End() const;
+
+	/**
+	 * @brief Reads every query result that is available without waiting for the GPU.
+	 *
+	 * @return true if the object was visible in the most recent available result, or if no
+	 * result is available yet.
+	 */
+	bool IsVisible();
+
+	/**
+	 * @brief Gets the query started by the last Begin, for glBeginConditionalRender.
+	 *
+	 * @return unsigned int Renderer ID of the query.
+	 */
+	unsigned int GetCurrentID() const;
+
+	/**
+	 * @brief Gets the transform that maps the unit cube [0, 1]^3 onto the bounding box.
+	 *
+	 * @return glm::mat4 The model space transform of the proxy box.
+	 */
+	glm::mat4 GetProxyTransform() const;
+
+	/**
+	 * @brief Gets the query target: GL_ANY_SAMPLES_PASSED_CONSERVATIVE when supported
+	 * (OpenGL 4.3 or ARB_ES3_compatibility), GL_ANY_SAMPLES_PASSED otherwise.
+	 *
+	 * @return unsigned int The query target.
+	 */
+	static unsigned int GetTarget();
+};
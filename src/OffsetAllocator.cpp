@@ -0,0 +1,329 @@
+#include "OffsetAllocator.h"
+#include "GLDebug.h"
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+static const unsigned int MantissaBits = 3;
+static const unsigned int MantissaValue = 1 << MantissaBits;
+static const unsigned int MantissaMask = MantissaValue - 1;
+
+/**
+ * @brief Gets the index of the highest set bit.
+ *
+ * @param value A value other than 0.
+ * @return unsigned int Index of the bit.
+ */
+static unsigned int HighestSetBit(unsigned int value)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, value);
+	return index;
+#else
+	return 31 - __builtin_clz(value);
+#endif
+}
+
+/**
+ * @brief Gets the index of the lowest set bit.
+ *
+ * @param value A value other than 0.
+ * @return unsigned int Index of the bit.
+ */
+static unsigned int LowestSetBit(unsigned int value)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return index;
+#else
+	return __builtin_ctz(value);
+#endif
+}
+
+/**
+ * @brief Gets the index of the lowest set bit at or above a given index.
+ *
+ * @param mask The bits to search.
+ * @param first Index of the first bit to consider.
+ * @return unsigned int Index of the bit, OffsetAllocation::NoSpace if there is none.
+ */
+static unsigned int LowestSetBitFrom(unsigned int mask, unsigned int first)
+{
+	if (first >= 32)
+		return OffsetAllocation::NoSpace;
+	mask &= ~((1u << first) - 1);
+	return mask ? LowestSetBit(mask) : OffsetAllocation::NoSpace;
+}
+
+/**
+ * @brief Gets the bin of a size as a tiny float, 5 bits of exponent and 3 bits of mantissa.
+ *
+ * Sizes below 8 are stored exactly (denormals). Above, the 3 bits after the highest set bit are
+ * kept as the mantissa and the rest is dropped.
+ *
+ * @param size The size.
+ * @param roundUp Whether to round up to the next bin when bits are dropped. Allocate searches
+ * from the rounded-up bin, so every range it finds is large enough; free ranges are stored in
+ * the rounded-down bin, so their bin never promises more than they hold.
+ * @return unsigned int Index of the bin.
+ */
+static unsigned int SizeToBin(unsigned int size, bool roundUp)
+{
+	if (size < MantissaValue)
+		return size;
+
+	const unsigned int mantissaStart = HighestSetBit(size) - MantissaBits;
+	const unsigned int exponent = mantissaStart + 1;
+	unsigned int mantissa = (size >> mantissaStart) & MantissaMask;
+	if (roundUp && (size & ((1u << mantissaStart) - 1)) != 0)
+		mantissa++; // Carries into the exponent when the mantissa overflows
+
+	return (exponent << MantissaBits) + mantissa;
+}
+
+/**
+ * @brief Constructs an OffsetAllocator with all of its space free.
+ *
+ * @param size Size of the managed space.
+ * @param maxAllocations Maximum number of live allocations.
+ */
+OffsetAllocator::OffsetAllocator(unsigned int size, unsigned int maxAllocations)
+	: m_size(size), m_maxAllocations(maxAllocations)
+{
+	Reset();
+}
+
+/**
+ * @brief Frees every range at once.
+ */
+void OffsetAllocator::Reset()
+{
+	m_freeSize = 0;
+	m_freeRangeCount = 0;
+	m_allocationCount = 0;
+	m_usedExponents = 0;
+	for (unsigned char& mantissas : m_usedMantissas)
+		mantissas = 0;
+	for (unsigned int& bin : m_bins)
+		bin = OffsetAllocation::NoSpace;
+
+	// Free ranges never touch each other, so there is at most one more of them than allocations
+	const unsigned int nodeCount = 2 * m_maxAllocations + 1;
+	m_nodes.assign(nodeCount, Node());
+	m_unusedNodes.resize(nodeCount);
+	for (unsigned int i = 0; i < nodeCount; i++)
+		m_unusedNodes[i] = nodeCount - i - 1; // Popped from the back, node 0 first
+
+	if (m_size > 0)
+		InsertFreeRange(0, m_size);
+}
+
+/**
+ * @brief Allocates a range of the space, from the smallest bin whose ranges are all large enough.
+ *
+ * @param size Size of the range, greater than 0.
+ * @return OffsetAllocation The range, invalid if no free range is large enough or the
+ * maximum number of allocations is reached.
+ */
+OffsetAllocation OffsetAllocator::Allocate(unsigned int size)
+{
+	ASSERT(size > 0);
+	if (size == 0 || m_allocationCount >= m_maxAllocations)
+		return OffsetAllocation();
+
+	const unsigned int minBin = SizeToBin(size, true);
+	const unsigned int minExponent = minBin >> MantissaBits;
+	if (minExponent >= 32)
+		return OffsetAllocation();
+
+	// Same exponent with a large enough mantissa first, then the lowest non-empty larger exponent
+	unsigned int exponent = minExponent;
+	unsigned int mantissa = OffsetAllocation::NoSpace;
+	if (m_usedExponents & (1u << exponent))
+		mantissa = LowestSetBitFrom(m_usedMantissas[exponent], minBin & MantissaMask);
+	if (mantissa == OffsetAllocation::NoSpace) {
+		exponent = LowestSetBitFrom(m_usedExponents, minExponent + 1);
+		if (exponent == OffsetAllocation::NoSpace)
+			return OffsetAllocation();
+		mantissa = LowestSetBit(m_usedMantissas[exponent]);
+	}
+
+	const unsigned int nodeIndex = m_bins[(exponent << MantissaBits) | mantissa];
+	const unsigned int offset = m_nodes[nodeIndex].offset;
+	const unsigned int rangeSize = m_nodes[nodeIndex].size;
+	RemoveFreeRange(nodeIndex);
+
+	// The node was just returned to the unused stack, take it back for the allocation
+	m_unusedNodes.pop_back();
+	Node& node = m_nodes[nodeIndex];
+	node.size = size;
+	node.used = true;
+	m_allocationCount++;
+
+	// The rest of the free range stays free, right after the allocation
+	if (rangeSize > size) {
+		const unsigned int restIndex = InsertFreeRange(offset + size, rangeSize - size);
+		Node& rest = m_nodes[restIndex];
+		rest.neighborPrev = nodeIndex;
+		rest.neighborNext = node.neighborNext;
+		if (node.neighborNext != OffsetAllocation::NoSpace)
+			m_nodes[node.neighborNext].neighborPrev = restIndex;
+		node.neighborNext = restIndex;
+	}
+
+	OffsetAllocation allocation;
+	allocation.offset = offset;
+	allocation.node = nodeIndex;
+	return allocation;
+}
+
+/**
+ * @brief Frees a range and merges it with the free ranges next to it.
+ *
+ * @param allocation A valid range returned by Allocate and not freed yet.
+ */
+void OffsetAllocator::Free(const OffsetAllocation& allocation)
+{
+	ASSERT(allocation.IsValid() && allocation.node < m_nodes.size() && m_nodes[allocation.node].used);
+	if (!allocation.IsValid())
+		return;
+
+	const unsigned int nodeIndex = allocation.node;
+	Node& node = m_nodes[nodeIndex];
+	unsigned int offset = node.offset;
+	unsigned int size = node.size;
+
+	if (node.neighborPrev != OffsetAllocation::NoSpace && !m_nodes[node.neighborPrev].used) {
+		const Node& prev = m_nodes[node.neighborPrev];
+		offset = prev.offset;
+		size += prev.size;
+		const unsigned int prevIndex = node.neighborPrev;
+		node.neighborPrev = prev.neighborPrev;
+		RemoveFreeRange(prevIndex);
+	}
+	if (node.neighborNext != OffsetAllocation::NoSpace && !m_nodes[node.neighborNext].used) {
+		const Node& next = m_nodes[node.neighborNext];
+		size += next.size;
+		const unsigned int nextIndex = node.neighborNext;
+		node.neighborNext = next.neighborNext;
+		RemoveFreeRange(nextIndex);
+	}
+
+	const unsigned int neighborPrev = node.neighborPrev;
+	const unsigned int neighborNext = node.neighborNext;
+	node = Node();
+	m_unusedNodes.push_back(nodeIndex);
+	m_allocationCount--;
+
+	const unsigned int mergedIndex = InsertFreeRange(offset, size);
+	Node& merged = m_nodes[mergedIndex];
+	merged.neighborPrev = neighborPrev;
+	merged.neighborNext = neighborNext;
+	if (neighborPrev != OffsetAllocation::NoSpace)
+		m_nodes[neighborPrev].neighborNext = mergedIndex;
+	if (neighborNext != OffsetAllocation::NoSpace)
+		m_nodes[neighborNext].neighborPrev = mergedIndex;
+}
+
+/**
+ * @brief Gets the size of an allocated range.
+ *
+ * @param allocation A valid range returned by Allocate.
+ * @return unsigned int Size of the range.
+ */
+unsigned int OffsetAllocator::GetAllocationSize(const OffsetAllocation& allocation) const
+{
+	if (!allocation.IsValid())
+		return 0;
+	return m_nodes[allocation.node].size;
+}
+
+/**
+ * @brief Gets the state of the space. The largest free range is searched in the highest
+ * non-empty bin only.
+ *
+ * @return Stats The free space and allocation counts.
+ */
+OffsetAllocator::Stats OffsetAllocator::GetStats() const
+{
+	Stats stats;
+	stats.freeSize = m_freeSize;
+	stats.freeRangeCount = m_freeRangeCount;
+	stats.allocationCount = m_allocationCount;
+
+	if (m_usedExponents != 0) {
+		const unsigned int exponent = HighestSetBit(m_usedExponents);
+		const unsigned int mantissa = HighestSetBit(m_usedMantissas[exponent]);
+		for (unsigned int i = m_bins[(exponent << MantissaBits) | mantissa]; i != OffsetAllocation::NoSpace; i = m_nodes[i].binNext) {
+			if (m_nodes[i].size > stats.largestFreeRange)
+				stats.largestFreeRange = m_nodes[i].size;
+		}
+	}
+	return stats;
+}
+
+/**
+ * @brief Takes an unused node, puts a free range in it and links it at the head of its bin.
+ *
+ * @param offset Offset of the free range.
+ * @param size Size of the free range.
+ * @return unsigned int Index of the node.
+ */
+unsigned int OffsetAllocator::InsertFreeRange(unsigned int offset, unsigned int size)
+{
+	const unsigned int bin = SizeToBin(size, false);
+	const unsigned int exponent = bin >> MantissaBits;
+	const unsigned int mantissa = bin & MantissaMask;
+	m_usedExponents |= 1u << exponent;
+	m_usedMantissas[exponent] |= 1u << mantissa;
+
+	const unsigned int nodeIndex = m_unusedNodes.back();
+	m_unusedNodes.pop_back();
+
+	Node& node = m_nodes[nodeIndex];
+	node = Node();
+	node.offset = offset;
+	node.size = size;
+	node.binNext = m_bins[bin];
+	if (node.binNext != OffsetAllocation::NoSpace)
+		m_nodes[node.binNext].binPrev = nodeIndex;
+	m_bins[bin] = nodeIndex;
+
+	m_freeSize += size;
+	m_freeRangeCount++;
+	return nodeIndex;
+}
+
+/**
+ * @brief Unlinks a free range from its bin and returns its node to the unused stack. Clears
+ * the bits of the bin when it becomes empty.
+ *
+ * @param nodeIndex Index of the node of the free range.
+ */
+void OffsetAllocator::RemoveFreeRange(unsigned int nodeIndex)
+{
+	const Node& node = m_nodes[nodeIndex];
+	if (node.binNext != OffsetAllocation::NoSpace)
+		m_nodes[node.binNext].binPrev = node.binPrev;
+
+	if (node.binPrev != OffsetAllocation::NoSpace) {
+		m_nodes[node.binPrev].binNext = node.binNext;
+	}
+	else {
+		const unsigned int bin = SizeToBin(node.size, false);
+		m_bins[bin] = node.binNext;
+		if (m_bins[bin] == OffsetAllocation::NoSpace) {
+			const unsigned int exponent = bin >> MantissaBits;
+			m_usedMantissas[exponent] &= ~(1u << (bin & MantissaMask));
+			if (m_usedMantissas[exponent] == 0)
+				m_usedExponents &= ~(1u << exponent);
+		}
+	}
+
+	m_freeSize -= node.size;
+	m_freeRangeCount--;
+	m_unusedNodes.push_back(nodeIndex);
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * @brief Range handed out by OffsetAllocator::Allocate.
+ */
+struct OffsetAllocation {
+	static const unsigned int NoSpace = 0xFFFFFFFF; ///< Offset of a failed allocation.
+
+	unsigned int offset = NoSpace; ///< Offset of the range, in the allocator's units.
+	unsigned int node = NoSpace;   ///< Internal node of the range, needed to free it.
+
+	/**
+	 * @brief Checks whether the allocation succeeded.
+	 *
+	 * @return bool True if the range is valid.
+	 */
+	inline bool IsValid() const { return offset != NoSpace; }
+};
+
+/**
+ * @brief OffsetAllocator class that suballocates ranges of a fixed-size space in O(1).
+ *
+ * The allocator only manages offsets, it never touches memory, so the space can be a GPU
+ * buffer, measured in bytes, vertices or indices. Free ranges are kept in 256 bins following
+ * the two-level segregated fit (TLSF) scheme: a bin index is a tiny floating point number,
+ * 5 bits of exponent and 3 bits of mantissa, so bins are at most 12.5% apart in size. A 32-bit
+ * mask of non-empty exponents and a byte of non-empty mantissas per exponent find the
+ * smallest bin that fits with two bit scans, with no search through free lists.
+ *
+ * Every range also links to its neighbours in offset order, so Free merges a range with the
+ * free ranges around it in constant time and the space does not fragment into slivers.
+ */
+class OffsetAllocator {
+public:
+	/**
+	 * @brief State of the space when GetStats was called.
+	 */
+	struct Stats {
+		unsigned int freeSize = 0;          ///< Total size of the free ranges.
+		unsigned int largestFreeRange = 0;  ///< Size of the largest free range, the largest allocation that can succeed.
+		unsigned int freeRangeCount = 0;    ///< Number of free ranges. 1 means the free space is not fragmented.
+		unsigned int allocationCount = 0;   ///< Number of live allocations.
+	};
+
+	static const unsigned int BinCount = 256; ///< Number of size bins.
+
+private:
+	/**
+	 * @brief A free or allocated range.
+	 */
+	struct Node {
+		unsigned int offset = 0;                               ///< Offset of the range.
+		unsigned int size = 0;                                 ///< Size of the range.
+		unsigned int binPrev = OffsetAllocation::NoSpace;      ///< Previous free range in the same bin.
+		unsigned int binNext = OffsetAllocation::NoSpace;      ///< Next free range in the same bin.
+		unsigned int neighborPrev = OffsetAllocation::NoSpace; ///< Range just before this one in the space.
+		unsigned int neighborNext = OffsetAllocation::NoSpace; ///< Range just after this one in the space.
+		bool used = false;                                     ///< Whether the range is allocated.
+	};
+
+	unsigned int m_size; ///< Size of the managed space
+	unsigned int m_maxAllocations; ///< Maximum number of live allocations
+	unsigned int m_freeSize; ///< Total size of the free ranges
+	unsigned int m_freeRangeCount; ///< Number of free ranges
+	unsigned int m_allocationCount; ///< Number of live allocations
+	unsigned int m_usedExponents; ///< Bit e is set if a bin with exponent e holds a free range
+	unsigned char m_usedMantissas[32]; ///< Bit m of entry e is set if bin (e, m) holds a free range
+	unsigned int m_bins[BinCount]; ///< First free range of each bin
+	std::vector<Node> m_nodes; ///< Storage of the ranges
+	std::vector<unsigned int> m_unusedNodes; ///< Stack of the entries of m_nodes not holding a range
+
+public:
+	/**
+	 * @brief Constructs an OffsetAllocator with all of its space free.
+	 *
+	 * @param size Size of the managed space.
+	 * @param maxAllocations Maximum number of live allocations.
+	 */
+	OffsetAllocator(unsigned int size, unsigned int maxAllocations = 65536);
+
+	/**
+	 * @brief Allocates a range of the space.
+	 *
+	 * @param size Size of the range, greater than 0.
+	 * @return OffsetAllocation The range, invalid if no free range is large enough or the
+	 * maximum number of allocations is reached.
+	 */
+	OffsetAllocation Allocate(unsigned int size);
+
+	/**
+	 * @brief Frees a range and merges it with the free ranges next to it.
+	 *
+	 * @param allocation A valid range returned by Allocate and not freed yet.
+	 */
+	void Free(const OffsetAllocation& allocation);
+
+	/**
+	 * @brief Frees every range at once.
+	 */
+	void Reset();
+
+	/**
+	 * @brief Gets the size of an allocated range.
+	 *
+	 * @param allocation A valid range returned by Allocate.
+	 * @return unsigned int Size of the range.
+	 */
+	unsigned int GetAllocationSize(const OffsetAllocation& allocation) const;
+
+	/**
+	 * @brief Gets the state of the space.
+	 *
+	 * @return Stats The free space and allocation counts.
+	 */
+	Stats GetStats() const;
+
+	/**
+	 * @brief Gets the size of the managed space.
+	 *
+	 * @return unsigned int Size of the space.
+	 */
+	inline unsigned int GetSize() const { return m_size; }
+
+private:
+	/**
+	 * @brief Takes an unused node, puts a free range in it and links it into its bin.
+	 *
+	 * @param offset Offset of the free range.
+	 * @param size Size of the free range.
+	 * @return unsigned int Index of the node.
+	 */
+	unsigned int InsertFreeRange(unsigned int offset, unsigned int size);
+
+	/**
+	 * @brief Unlinks a free range from its bin and returns its node to the unused stack.
+	 *
+	 * @param nodeIndex Index of the node of the free range.
+	 */
+	void RemoveFreeRange(unsigned int nodeIndex);
+};
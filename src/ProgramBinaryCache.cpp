@@ -0,0 +1,252 @@
+#include "ProgramBinaryCache.h"
+#include "Renderer.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <direct.h>
+	#define MakeDirectory(path) _mkdir(path)
+#else
+	#include <sys/stat.h>
+	#define MakeDirectory(path) mkdir(path, 0755)
+#endif
+
+/// First bytes of every cache file.
+static const uint32_t Magic = 0x3142504D; // "MPB1"
+
+/**
+ * @brief Header written before the binary of a program.
+ */
+struct ProgramBinaryHeader {
+	uint32_t magic;  ///< Magic.
+	uint32_t format; ///< Binary format returned by glGetProgramBinary.
+	uint32_t size;   ///< Size of the binary in bytes.
+	uint32_t pad;    ///< Unused, keeps the key 8-byte aligned.
+	uint64_t key;    ///< Key of the program, guards against renamed files.
+};
+
+/**
+ * @brief State of the cache.
+ */
+static struct {
+	std::string directory = "shader_cache";
+	int supported = -1; ///< 1 supported, 0 not, -1 not queried yet.
+	uint64_t driverHash = 0;
+	ProgramBinaryCache::Stats stats;
+} s_cache;
+
+/**
+ * @brief Continues a 64-bit FNV-1a hash over some bytes.
+ *
+ * @param hash The hash so far.
+ * @param data The bytes.
+ * @param size Number of bytes.
+ * @return uint64_t The new hash.
+ */
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	return hash;
+}
+
+/**
+ * @brief Continues a hash over a string and its terminator, so that "ab" + "c" and "a" + "bc"
+ * hash differently.
+ *
+ * @param hash The hash so far.
+ * @param text The string, nullptr is hashed as empty.
+ * @return uint64_t The new hash.
+ */
+static uint64_t HashString(uint64_t hash, const char* text)
+{
+	const std::string value = text ? text : "";
+	return HashBytes(hash, value.c_str(), value.size() + 1);
+}
+
+/**
+ * @brief Sets the directory the binaries are stored in, created (but not its parents) when the
+ * first one is stored.
+ *
+ * @param directory The directory, empty to disable the cache.
+ */
+void ProgramBinaryCache::SetDirectory(const std::string& directory)
+{
+	s_cache.directory = directory;
+}
+
+/**
+ * @brief Tells whether programs are loaded from and stored to the cache. Queries the driver
+ * on the first call.
+ *
+ * @return true if a directory is set and the driver supports program binaries.
+ */
+bool ProgramBinaryCache::IsEnabled()
+{
+	if (s_cache.supported == -1) {
+		int formatCount = 0;
+		if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+			GLCall(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount));
+		}
+		s_cache.supported = formatCount > 0 ? 1 : 0;
+
+		uint64_t hash = 14695981039346656037ull;
+		hash = HashString(hash, (const char*)glGetString(GL_VENDOR));
+		hash = HashString(hash, (const char*)glGetString(GL_RENDERER));
+		hash = HashString(hash, (const char*)glGetString(GL_VERSION));
+		s_cache.driverHash = hash;
+	}
+	return s_cache.supported == 1 && !s_cache.directory.empty();
+}
+
+/**
+ * @brief Computes the cache key of a program from its sources and the driver strings.
+ *
+ * @param vertexSource Source of the vertex shader.
+ * @param fragmentSource Source of the fragment shader.
+ * @return uint64_t The key.
+ */
+uint64_t ProgramBinaryCache::ComputeKey(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	IsEnabled(); // Makes sure the driver strings are hashed
+	uint64_t hash = s_cache.driverHash;
+	hash = HashBytes(hash, vertexSource.c_str(), vertexSource.size() + 1);
+	hash = HashBytes(hash, fragmentSource.c_str(), fragmentSource.size() + 1);
+	return hash;
+}
+
+/**
+ * @brief Creates a program from its cached binary. A binary the driver rejects is deleted,
+ * and a file whose length does not match its header counts as a miss.
+ *
+ * @param key The key of the program.
+ * @return unsigned int The linked program, 0 if it is not cached or the driver rejected it.
+ */
+unsigned int ProgramBinaryCache::Load(uint64_t key)
+{
+	if (!IsEnabled())
+		return 0;
+
+	const std::string path = GetPath(key);
+	std::ifstream file(path, std::ios::binary);
+	ProgramBinaryHeader header;
+	if (!file || !file.read((char*)&header, sizeof(header)) || header.magic != Magic || header.key != key) {
+		s_cache.stats.misses++;
+		return 0;
+	}
+
+	// A corrupt or truncated file must not make us allocate whatever size its header claims
+	file.seekg(0, std::ios::end);
+	const std::streamoff fileSize = file.tellg();
+	if (header.size == 0 || fileSize != (std::streamoff)(sizeof(header) + header.size)) {
+		s_cache.stats.misses++;
+		return 0;
+	}
+	file.seekg(sizeof(header), std::ios::beg);
+
+	std::vector<char> binary(header.size);
+	if (!file.read(binary.data(), header.size)) {
+		s_cache.stats.misses++;
+		return 0;
+	}
+	file.close();
+
+	unsigned int program;
+	GLCall(program = glCreateProgram());
+	GLCall(glProgramBinary(program, header.format, binary.data(), (int)header.size));
+
+	int linked = GL_FALSE;
+	GLCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+	if (linked == GL_FALSE) {
+		GLCall(glDeleteProgram(program));
+		std::remove(path.c_str());
+		s_cache.stats.rejected++;
+		return 0;
+	}
+
+	s_cache.stats.hits++;
+	return program;
+}
+
+/**
+ * @brief Stores a linked program. The file is written under a temporary name and then renamed,
+ * so that a run interrupted while writing never leaves a truncated binary behind.
+ *
+ * @param key The key of the program.
+ * @param program Renderer ID of the program. Nothing is stored if it failed to link.
+ */
+void ProgramBinaryCache::Store(uint64_t key, unsigned int program)
+{
+	if (!IsEnabled() || program == 0)
+		return;
+
+	int linked = GL_FALSE;
+	int size = 0;
+	GLCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+	GLCall(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size));
+	if (linked == GL_FALSE || size <= 0)
+		return;
+
+	std::vector<char> binary(size);
+	ProgramBinaryHeader header = { Magic, 0, 0, 0, key };
+	int length = 0;
+	GLCall(glGetProgramBinary(program, size, &length, &header.format, binary.data()));
+	header.size = (uint32_t)length;
+
+	MakeDirectory(s_cache.directory.c_str()); // Fails harmlessly when it exists
+	const std::string path = GetPath(key);
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.write((const char*)&header, sizeof(header)) || !file.write(binary.data(), length)) {
+			std::cout << "Warning: could not write the program binary " << temporaryPath << std::endl;
+			return;
+		}
+	}
+	std::remove(path.c_str()); // rename does not replace an existing file on Windows
+	if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+		std::remove(temporaryPath.c_str());
+		return;
+	}
+	s_cache.stats.stores++;
+}
+
+/**
+ * @brief Asks the driver to keep the binary of a program that is about to be linked.
+ *
+ * @param program Renderer ID of the program, not linked yet.
+ */
+void ProgramBinaryCache::PrepareForLink(unsigned int program)
+{
+	if (IsEnabled()) {
+		GLCall(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+	}
+}
+
+/**
+ * @brief Gets the counters since the start of the program.
+ *
+ * @return const Stats& The counters.
+ */
+const ProgramBinaryCache::Stats& ProgramBinaryCache::GetStats()
+{
+	return s_cache.stats;
+}
+
+/**
+ * @brief Gets the path of the file holding a program, named after the key in hexadecimal.
+ *
+ * @param key The key of the program.
+ * @return std::string The path.
+ */
+std::string ProgramBinaryCache::GetPath(uint64_t key)
+{
+	std::ostringstream path;
+	path << s_cache.directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+	return path.str();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief On-disk cache of linked programs, so shaders are only compiled on the first run.
+ *
+ * A program is stored with glGetProgramBinary under a 64-bit hash of its parsed sources and of
+ * the vendor, renderer and version strings of the driver, and loaded back with glProgramBinary.
+ * Updating the driver or editing a shader changes the key, and a binary the driver rejects
+ * anyway is deleted so that the program is compiled and stored again.
+ *
+ * Needs OpenGL 4.1 or ARB_get_program_binary and at least one binary format; otherwise, or when
+ * the directory is empty, every call is a no-op and shaders are always compiled.
+ */
+class ProgramBinaryCache {
+public:
+	/**
+	 * @brief Counters since the start of the program.
+	 */
+	struct Stats {
+		unsigned int hits = 0;     ///< Programs loaded from the cache.
+		unsigned int misses = 0;   ///< Programs not found in the cache.
+		unsigned int rejected = 0; ///< Cached binaries the driver refused, then deleted.
+		unsigned int stores = 0;   ///< Programs written to the cache.
+	};
+
+	/**
+	 * @brief Sets the directory the binaries are stored in, created (but not its parents) when the
+	 * first one is stored.
+	 *
+	 * @param directory The directory, empty to disable the cache. "shader_cache" by default.
+	 */
+	static void SetDirectory(const std::string& directory);
+
+	/**
+	 * @brief Tells whether programs are loaded from and stored to the cache.
+	 *
+	 * Must be called with a current context.
+	 *
+	 * @return true if a directory is set and the driver supports program binaries.
+	 */
+	static bool IsEnabled();
+
+	/**
+	 * @brief Computes the cache key of a program.
+	 *
+	 * Must be called with a current context.
+	 *
+	 * @param vertexSource Source of the vertex shader.
+	 * @param fragmentSource Source of the fragment shader.
+	 * @return uint64_t The key.
+	 */
+	static uint64_t ComputeKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+	/**
+	 * @brief Creates a program from its cached binary. A file whose length does not match its
+	 * header counts as a miss.
+	 *
+	 * @param key The key of the program.
+	 * @return unsigned int The linked program, 0 if it is not cached or the driver rejected it.
+	 */
+	static unsigned int Load(uint64_t key);
+
+	/**
+	 * @brief Stores a linked program. The program must have been linked with
+	 * GL_PROGRAM_BINARY_RETRIEVABLE_HINT set, see PrepareForLink.
+	 *
+	 * @param key The key of the program.
+	 * @param program Renderer ID of the program. Nothing is stored if it failed to link.
+	 */
+	static void Store(uint64_t key, unsigned int program);
+
+	/**
+	 * @brief Asks the driver to keep the binary of a program that is about to be linked.
+	 *
+	 * @param program Renderer ID of the program, not linked yet.
+	 */
+	static void PrepareForLink(unsigned int program);
+
+	/**
+	 * @brief Gets the counters since the start of the program.
+	 *
+	 * @return const Stats& The counters.
+	 */
+	static const Stats& GetStats();
+
+private:
+	/**
+	 * @brief Gets the path of the file holding a program.
+	 *
+	 * @param key The key of the program.
+	 * @return std::string The path.
+	 */
+	static std::string GetPath(uint64_t key);
+};
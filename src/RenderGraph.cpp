@@ -0,0 +1,354 @@
+#include "RenderGraph.h"
+#include "Renderer.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+
+/**
+ * @brief Creates a transient target that the pass writes.
+ *
+ * @param name Name of the target, for debugging.
+ * @param desc Size and format of the target.
+ * @return RenderGraphResource The new target.
+ */
+RenderGraphResource RenderGraph::Builder::Create(const char* name, const RenderTargetDesc& desc)
+{
+	m_graph.m_resources.push_back({ name, desc, false, nullptr, -1, -1, 0 });
+	return Write((RenderGraphResource)m_graph.m_resources.size() - 1);
+}
+
+/**
+ * @brief Declares that the pass samples a target written by an earlier pass.
+ *
+ * @param resource The target.
+ * @return RenderGraphResource The target.
+ */
+RenderGraphResource RenderGraph::Builder::Read(RenderGraphResource resource)
+{
+	ASSERT(!m_graph.m_resources[resource].imported); // The backbuffer cannot be sampled
+	m_graph.m_passes[m_pass].reads.push_back(resource);
+	return resource;
+}
+
+/**
+ * @brief Declares that the pass renders into a target.
+ *
+ * @param resource The target.
+ * @return RenderGraphResource The target.
+ */
+RenderGraphResource RenderGraph::Builder::Write(RenderGraphResource resource)
+{
+	m_graph.m_passes[m_pass].writes.push_back(resource);
+	return resource;
+}
+
+/**
+ * @brief Keeps the pass even if nothing reads what it writes.
+ */
+void RenderGraph::Builder::SetSideEffect()
+{
+	m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+/**
+ * @brief Constructs an empty RenderGraph.
+ */
+RenderGraph::RenderGraph()
+	: m_poolDeletedCount(0), m_compiled(false)
+{
+}
+
+/**
+ * @brief Declares the default framebuffer as a target. Passes writing it are never culled.
+ *
+ * @param width Width of the default framebuffer.
+ * @param height Height of the default framebuffer.
+ * @return RenderGraphResource The backbuffer target.
+ */
+RenderGraphResource RenderGraph::ImportBackbuffer(int width, int height)
+{
+	RenderTargetDesc desc;
+	desc.width = width;
+	desc.height = height;
+	desc.format = GL_RGBA8;
+	m_resources.push_back({ "Backbuffer", desc, true, nullptr, -1, -1, 0 });
+	m_compiled = false;
+	return (RenderGraphResource)m_resources.size() - 1;
+}
+
+/**
+ * @brief Declares an offscreen framebuffer as the backbuffer, for rendering without a window.
+ *
+ * @param framebuffer The framebuffer. Must outlive the frame.
+ * @return RenderGraphResource The backbuffer target.
+ */
+RenderGraphResource RenderGraph::ImportFramebuffer(Framebuffer& framebuffer)
+{
+	RenderTargetDesc desc;
+	desc.width = framebuffer.GetSpec().width;
+	desc.height = framebuffer.GetSpec().height;
+	desc.format = framebuffer.GetSpec().colorFormats.empty() ? 0 : framebuffer.GetSpec().colorFormats[0];
+	m_resources.push_back({ "Backbuffer", desc, true, &framebuffer, -1, -1, 0 });
+	m_compiled = false;
+	return (RenderGraphResource)m_resources.size() - 1;
+}
+
+/**
+ * @brief Adds a pass. The setup function is called immediately.
+ *
+ * @param name Name of the pass, for debugging.
+ * @param setup Declares the targets of the pass.
+ * @param execute Issues the draws of the pass, called by Execute.
+ */
+void RenderGraph::AddPass(const char* name, const SetupFunction& setup, const ExecuteFunction& execute)
+{
+	m_passes.push_back({ name, execute, {}, {}, false, false });
+	Builder builder(*this, (unsigned int)m_passes.size() - 1);
+	setup(builder);
+	m_compiled = false;
+}
+
+/**
+ * @brief Culls unused passes and computes the lifetime of every target.
+ */
+void RenderGraph::Compile()
+{
+	PROFILE_FUNCTION();
+
+	// Walk backwards from the outputs, keeping the passes that produce something a kept pass reads
+	std::vector<bool> needed(m_resources.size(), false);
+	m_stats = Stats();
+	m_stats.passCount = (unsigned int)m_passes.size();
+	for (size_t i = m_passes.size(); i-- > 0;) {
+		Pass& pass = m_passes[i];
+		bool keep = pass.sideEffect;
+		for (RenderGraphResource resource : pass.writes)
+			keep = keep || m_resources[resource].imported || needed[resource];
+
+		pass.culled = !keep;
+		if (pass.culled) {
+			m_stats.culledPassCount++;
+			continue;
+		}
+		for (RenderGraphResource resource : pass.reads)
+			needed[resource] = true;
+	}
+
+	for (Resource& resource : m_resources) {
+		resource.firstPass = -1;
+		resource.lastPass = -1;
+	}
+	for (size_t i = 0; i < m_passes.size(); i++) {
+		const Pass& pass = m_passes[i];
+		if (pass.culled)
+			continue;
+
+		for (const std::vector<RenderGraphResource>* uses : { &pass.reads, &pass.writes }) {
+			for (RenderGraphResource index : *uses) {
+				Resource& resource = m_resources[index];
+				if (resource.firstPass < 0)
+					resource.firstPass = (int)i;
+				resource.lastPass = (int)i;
+			}
+		}
+	}
+
+	for (const Resource& resource : m_resources) {
+		if (!resource.imported && resource.firstPass >= 0)
+			m_stats.transientCount++;
+	}
+	m_compiled = true;
+}
+
+/**
+ * @brief Runs the remaining passes, binding and allocating their targets. Compiles first if needed.
+ */
+void RenderGraph::Execute()
+{
+	PROFILE_FUNCTION();
+
+	if (!m_compiled)
+		Compile();
+
+	const unsigned int createdTextureCount = m_pool.GetStats().createdTextureCount;
+	m_frameTextures.clear();
+
+	// A deleted texture stays attached to the framebuffers that are not bound, and a new
+	// texture may get its name, so the kept attachments can no longer be trusted
+	if (m_pool.GetStats().deletedCount != m_poolDeletedCount) {
+		m_poolDeletedCount = m_pool.GetStats().deletedCount;
+		m_framebuffers.clear();
+	}
+	for (unsigned int i = 0; i < m_passes.size(); i++) {
+		const Pass& pass = m_passes[i];
+		if (pass.culled)
+			continue;
+
+		for (RenderGraphResource index : pass.writes) {
+			Resource& resource = m_resources[index];
+			if (!resource.imported && resource.firstPass == (int)i)
+				Allocate(resource);
+		}
+
+		BindTargets(i);
+		pass.execute(*this);
+		InvalidateExpiredTargets(i);
+
+		// Textures of expired targets can hold the targets of later passes
+		for (Resource& resource : m_resources) {
+			if (!resource.imported && resource.lastPass == (int)i)
+				Release(resource);
+		}
+	}
+
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	m_stats.textureCount = (unsigned int)m_frameTextures.size();
+	m_stats.createdTextureCount = m_pool.GetStats().createdTextureCount - createdTextureCount;
+	m_pool.EndFrame();
+}
+
+/**
+ * @brief Removes every pass and target. Pool textures are kept for the next frame.
+ */
+void RenderGraph::Reset()
+{
+	m_resources.clear();
+	m_passes.clear();
+	m_compiled = false;
+}
+
+/**
+ * @brief Gets the texture currently holding a target. Only valid during Execute.
+ *
+ * @param resource The target.
+ * @return unsigned int Renderer ID of the texture, 0 for the backbuffer.
+ */
+unsigned int RenderGraph::GetTexture(RenderGraphResource resource) const
+{
+	return m_resources[resource].texture;
+}
+
+/**
+ * @brief Gives a transient target a pool texture, creating one if none is free.
+ *
+ * @param resource The target.
+ */
+void RenderGraph::Allocate(Resource& resource)
+{
+	resource.texture = m_pool.AcquireTexture(resource.desc);
+	if (std::find(m_frameTextures.begin(), m_frameTextures.end(), resource.texture) == m_frameTextures.end())
+		m_frameTextures.push_back(resource.texture);
+}
+
+/**
+ * @brief Gives the pool texture of a target back to the pool.
+ *
+ * @param resource The target.
+ */
+void RenderGraph::Release(Resource& resource)
+{
+	if (!resource.texture)
+		return;
+
+	m_pool.ReleaseTexture(resource.texture);
+	resource.texture = 0;
+}
+
+/**
+ * @brief Binds the framebuffer a pass renders into and sets the viewport to its size.
+ *
+ * Every pass keeps its own framebuffer across frames, so textures are only attached again
+ * when the pool hands the pass different ones.
+ *
+ * @param passIndex Index of the pass.
+ */
+void RenderGraph::BindTargets(unsigned int passIndex)
+{
+	const Pass& pass = m_passes[passIndex];
+	if (pass.writes.empty())
+		return;
+
+	const Resource& first = m_resources[pass.writes[0]];
+	const RenderTargetDesc& size = first.desc;
+	if (first.imported && first.framebuffer) {
+		first.framebuffer->Bind();
+		return;
+	}
+	if (first.imported) {
+		GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+		GLCall(glViewport(0, 0, size.width, size.height));
+		return;
+	}
+
+	std::vector<unsigned int> colorTextures;
+	unsigned int depthTexture = 0;
+	unsigned int depthFormat = 0;
+	for (RenderGraphResource index : pass.writes) {
+		const Resource& resource = m_resources[index];
+		ASSERT(!resource.imported); // The backbuffer cannot be combined with transient targets
+		if (Framebuffer::IsDepthFormat(resource.desc.format)) {
+			depthTexture = resource.texture;
+			depthFormat = resource.desc.format;
+		}
+		else if (colorTextures.size() < MaxColorAttachments) {
+			colorTextures.push_back(resource.texture);
+		}
+	}
+
+	if (m_framebuffers.size() <= passIndex)
+		m_framebuffers.resize(passIndex + 1);
+	std::unique_ptr<Framebuffer>& framebuffer = m_framebuffers[passIndex];
+	if (!framebuffer)
+		framebuffer.reset(new Framebuffer());
+	framebuffer->Attach(size.width, size.height, colorTextures, depthTexture, depthFormat);
+	framebuffer->Bind();
+}
+
+/**
+ * @brief Invalidates the targets whose last use is the given pass.
+ *
+ * Attachments written by the pass are invalidated in the framebuffer; sampled targets are
+ * invalidated as textures.
+ *
+ * @param passIndex Index of the pass.
+ */
+void RenderGraph::InvalidateExpiredTargets(unsigned int passIndex)
+{
+	if (!GLEW_VERSION_4_3 && !GLEW_ARB_invalidate_subdata)
+		return;
+
+	const Pass& pass = m_passes[passIndex];
+	GLenum attachments[MaxColorAttachments + 1];
+	GLsizei attachmentCount = 0;
+	unsigned int colorIndex = 0;
+	for (RenderGraphResource index : pass.writes) {
+		const Resource& resource = m_resources[index];
+		if (resource.imported)
+			continue;
+
+		GLenum attachment;
+		if (Framebuffer::IsDepthFormat(resource.desc.format)) {
+			attachment = Framebuffer::GetDepthAttachmentPoint(resource.desc.format);
+		}
+		else {
+			if (colorIndex == MaxColorAttachments)
+				continue;
+			attachment = GL_COLOR_ATTACHMENT0 + colorIndex++;
+		}
+
+		if (resource.lastPass == (int)passIndex)
+			attachments[attachmentCount++] = attachment;
+	}
+	// The pass may have bound another framebuffer, the attachments belong to its own
+	if (attachmentCount > 0 && passIndex < m_framebuffers.size() && m_framebuffers[passIndex]) {
+		GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[passIndex]->GetRendererID()));
+		GLCall(glInvalidateFramebuffer(GL_FRAMEBUFFER, attachmentCount, attachments));
+	}
+
+	for (RenderGraphResource index : pass.reads) {
+		const Resource& resource = m_resources[index];
+		if (resource.lastPass == (int)passIndex && resource.texture) {
+			GLCall(glInvalidateTexImage(resource.texture, 0));
+		}
+	}
+}
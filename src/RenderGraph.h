@@ -0,0 +1,244 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "RenderTargetPool.h"
+
+/// Handle of a texture in a RenderGraph, valid until the graph is reset.
+typedef unsigned int RenderGraphResource;
+
+/**
+ * @brief RenderGraph class that schedules a frame as passes over declared render targets.
+ *
+ * Passes are added with a setup function, which declares the targets the pass creates, reads
+ * and writes, and an execute function, which issues its draws. Compile then:
+ * - culls passes whose results never reach the backbuffer or a pass marked as having side effects,
+ * - computes the first and last pass that uses each transient target.
+ * Execute runs the remaining passes in the order they were added, which is a valid order since
+ * a pass can only read what earlier passes wrote. Transient targets get a texture from a
+ * RenderTargetPool at their first use and give it back after their last use, so targets
+ * whose lifetimes do not overlap share one texture (OpenGL has no lower-level memory aliasing).
+ * Attachments that are not read again are invalidated so tilers and compressors can skip
+ * storing them.
+ *
+ * The graph is rebuilt every frame: Reset, AddPass..., Compile, Execute.
+ */
+class RenderGraph {
+public:
+	/**
+	 * @brief Declares what a pass uses. Given to the setup function of AddPass.
+	 */
+	class Builder {
+	private:
+		RenderGraph& m_graph; ///< Graph the pass belongs to
+		unsigned int m_pass; ///< Index of the pass
+
+	public:
+		/**
+		 * @brief Constructs a Builder for a pass.
+		 *
+		 * @param graph Graph the pass belongs to.
+		 * @param pass Index of the pass.
+		 */
+		Builder(RenderGraph& graph, unsigned int pass)
+			: m_graph(graph), m_pass(pass) {}
+
+		/**
+		 * @brief Creates a transient target that the pass writes.
+		 *
+		 * @param name Name of the target, for debugging.
+		 * @param desc Size and format of the target.
+		 * @return RenderGraphResource The new target.
+		 */
+		RenderGraphResource Create(const char* name, const RenderTargetDesc& desc);
+
+		/**
+		 * @brief Declares that the pass samples a target written by an earlier pass.
+		 *
+		 * @param resource The target.
+		 * @return RenderGraphResource The target.
+		 */
+		RenderGraphResource Read(RenderGraphResource resource);
+
+		/**
+		 * @brief Declares that the pass renders into a target. Color targets are attached in
+		 * the order they are written.
+		 *
+		 * @param resource The target.
+		 * @return RenderGraphResource The target.
+		 */
+		RenderGraphResource Write(RenderGraphResource resource);
+
+		/**
+		 * @brief Keeps the pass even if nothing reads what it writes.
+		 */
+		void SetSideEffect();
+	};
+
+	/// Declares the targets of a pass.
+	typedef std::function<void(Builder& builder)> SetupFunction;
+	/// Issues the draws of a pass. Textures of its reads are available through GetTexture.
+	typedef std::function<void(const RenderGraph& graph)> ExecuteFunction;
+
+	/**
+	 * @brief Statistics of the last compiled and executed frame.
+	 */
+	struct Stats {
+		unsigned int passCount = 0;        ///< Passes added.
+		unsigned int culledPassCount = 0;  ///< Passes culled by Compile.
+		unsigned int transientCount = 0;   ///< Transient targets used by the remaining passes.
+		unsigned int textureCount = 0;     ///< Pool textures the transient targets were mapped to.
+		unsigned int createdTextureCount = 0; ///< Pool textures that had to be created.
+	};
+
+	/// Maximum number of color targets a pass can write.
+	static const unsigned int MaxColorAttachments = 4;
+
+private:
+	/**
+	 * @brief A target declared in the graph.
+	 */
+	struct Resource {
+		const char* name;        ///< Name of the target.
+		RenderTargetDesc desc;   ///< Size and format.
+		bool imported;           ///< Whether the target is the backbuffer rather than a transient target.
+		Framebuffer* framebuffer; ///< Framebuffer standing in for the backbuffer, nullptr for the default framebuffer.
+		int firstPass;           ///< First remaining pass that uses it, -1 if none.
+		int lastPass;            ///< Last remaining pass that uses it, -1 if none.
+		unsigned int texture;    ///< Pool texture holding it while allocated, 0 otherwise.
+	};
+
+	/**
+	 * @brief A pass added to the graph.
+	 */
+	struct Pass {
+		const char* name;                          ///< Name of the pass.
+		ExecuteFunction execute;                   ///< Draws of the pass.
+		std::vector<RenderGraphResource> reads;    ///< Targets sampled.
+		std::vector<RenderGraphResource> writes;   ///< Targets rendered into.
+		bool sideEffect;                           ///< Whether the pass must never be culled.
+		bool culled;                               ///< Whether Compile culled the pass.
+	};
+
+	std::vector<Resource> m_resources; ///< Targets of the frame
+	std::vector<Pass> m_passes; ///< Passes of the frame
+	RenderTargetPool m_pool; ///< Textures kept across frames
+	std::vector<std::unique_ptr<Framebuffer>> m_framebuffers; ///< Framebuffer of each pass index, kept across frames so unchanged attachments are not attached again
+	unsigned int m_poolDeletedCount; ///< Deletions of m_pool when m_framebuffers were last checked against them
+	std::vector<unsigned int> m_frameTextures; ///< Distinct pool textures used this frame, for the statistics
+	bool m_compiled; ///< Whether Compile ran since the last change
+	Stats m_stats; ///< Statistics of the last frame
+
+public:
+	/**
+	 * @brief Constructs an empty RenderGraph.
+	 */
+	RenderGraph();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	/**
+	 * @brief Declares the default framebuffer as a target. Passes writing it are never culled.
+	 *
+	 * @param width Width of the default framebuffer.
+	 * @param height Height of the default framebuffer.
+	 * @return RenderGraphResource The backbuffer target.
+	 */
+	RenderGraphResource ImportBackbuffer(int width, int height);
+
+	/**
+	 * @brief Declares an offscreen framebuffer as the backbuffer, for rendering without a
+	 * window. Passes writing it are never culled.
+	 *
+	 * @param framebuffer The framebuffer. Must outlive the frame.
+	 * @return RenderGraphResource The backbuffer target.
+	 */
+	RenderGraphResource ImportFramebuffer(Framebuffer& framebuffer);
+
+	/**
+	 * @brief Adds a pass. The setup function is called immediately.
+	 *
+	 * @param name Name of the pass, for debugging.
+	 * @param setup Declares the targets of the pass.
+	 * @param execute Issues the draws of the pass, called by Execute.
+	 */
+	void AddPass(const char* name, const SetupFunction& setup, const ExecuteFunction& execute);
+
+	/**
+	 * @brief Culls unused passes and computes the lifetime of every target.
+	 */
+	void Compile();
+
+	/**
+	 * @brief Runs the remaining passes, binding and allocating their targets. Compiles first if needed.
+	 */
+	void Execute();
+
+	/**
+	 * @brief Removes every pass and target. Pool textures are kept for the next frame.
+	 */
+	void Reset();
+
+	/**
+	 * @brief Gets the pool the transient targets come from, which other offscreen rendering
+	 * can share.
+	 *
+	 * @return RenderTargetPool& The pool.
+	 */
+	inline RenderTargetPool& GetPool() { return m_pool; }
+
+	/**
+	 * @brief Gets the texture currently holding a target. Only valid during Execute.
+	 *
+	 * @param resource The target.
+	 * @return unsigned int Renderer ID of the texture, 0 for the backbuffer.
+	 */
+	unsigned int GetTexture(RenderGraphResource resource) const;
+
+	/**
+	 * @brief Gets the size and format of a target.
+	 *
+	 * @param resource The target.
+	 * @return const RenderTargetDesc& The size and format.
+	 */
+	inline const RenderTargetDesc& GetDesc(RenderGraphResource resource) const { return m_resources[resource].desc; }
+
+	/**
+	 * @brief Gets the statistics of the last frame.
+	 *
+	 * @return const Stats& The statistics.
+	 */
+	inline const Stats& GetStats() const { return m_stats; }
+
+private:
+	/**
+	 * @brief Gives a transient target a pool texture, creating one if none is free.
+	 *
+	 * @param resource The target.
+	 */
+	void Allocate(Resource& resource);
+
+	/**
+	 * @brief Gives the pool texture of a target back to the pool.
+	 *
+	 * @param resource The target.
+	 */
+	void Release(Resource& resource);
+
+	/**
+	 * @brief Binds the framebuffer a pass renders into and sets the viewport to its size.
+	 *
+	 * @param passIndex Index of the pass.
+	 */
+	void BindTargets(unsigned int passIndex);
+
+	/**
+	 * @brief Invalidates the targets whose last use is the given pass.
+	 *
+	 * @param passIndex Index of the pass.
+	 */
+	void InvalidateExpiredTargets(unsigned int passIndex);
+};
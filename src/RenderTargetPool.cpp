@@ -0,0 +1,160 @@
+#include "RenderTargetPool.h"
+#include "Renderer.h"
+
+/**
+ * @brief Constructs an empty RenderTargetPool.
+ */
+RenderTargetPool::RenderTargetPool()
+	: m_frame(0)
+{
+}
+
+/**
+ * @brief Destroys the RenderTargetPool and deletes every texture and framebuffer it holds.
+ */
+RenderTargetPool::~RenderTargetPool()
+{
+	for (const PooledTexture& texture : m_textures)
+		Framebuffer::DeleteTexture(texture.rendererID);
+}
+
+/**
+ * @brief Gets an unused texture of the given size and format, creating one if none is free.
+ *
+ * @param desc Size and format of the texture.
+ * @return unsigned int Renderer ID of the texture.
+ */
+unsigned int RenderTargetPool::AcquireTexture(const RenderTargetDesc& desc)
+{
+	for (PooledTexture& texture : m_textures) {
+		if (!texture.inUse && texture.desc == desc) {
+			texture.inUse = true;
+			texture.lastUsedFrame = m_frame;
+			m_stats.reusedCount++;
+			return texture.rendererID;
+		}
+	}
+
+	m_textures.push_back({ Framebuffer::CreateTexture(desc), desc, true, m_frame });
+	m_stats.textureCount = (unsigned int)m_textures.size();
+	m_stats.createdTextureCount++;
+	return m_textures.back().rendererID;
+}
+
+/**
+ * @brief Gives a texture back to the pool. Its contents are undefined when acquired again.
+ *
+ * @param texture Renderer ID returned by AcquireTexture.
+ */
+void RenderTargetPool::ReleaseTexture(unsigned int texture)
+{
+	for (PooledTexture& pooled : m_textures) {
+		if (pooled.rendererID == texture) {
+			ASSERT(pooled.inUse);
+			pooled.inUse = false;
+			return;
+		}
+	}
+	ASSERT(false); // Not a texture of this pool
+}
+
+/**
+ * @brief Gets an unused framebuffer with the given attachments, creating one if none is free.
+ *
+ * @param spec Size, formats and sample count of the attachments.
+ * @return Framebuffer* The framebuffer, owned by the pool.
+ */
+Framebuffer* RenderTargetPool::AcquireFramebuffer(const FramebufferSpec& spec)
+{
+	for (PooledFramebuffer& pooled : m_framebuffers) {
+		if (!pooled.inUse && pooled.framebuffer->GetSpec() == spec) {
+			pooled.inUse = true;
+			pooled.lastUsedFrame = m_frame;
+			m_stats.reusedCount++;
+			return pooled.framebuffer.get();
+		}
+	}
+
+	PooledFramebuffer pooled;
+	pooled.framebuffer.reset(new Framebuffer(spec));
+	pooled.inUse = true;
+	pooled.lastUsedFrame = m_frame;
+	m_framebuffers.push_back(std::move(pooled));
+	m_stats.framebufferCount = (unsigned int)m_framebuffers.size();
+	m_stats.createdFramebufferCount++;
+	return m_framebuffers.back().framebuffer.get();
+}
+
+/**
+ * @brief Gives a framebuffer back to the pool. Its contents are undefined when acquired again.
+ *
+ * @param framebuffer Framebuffer returned by AcquireFramebuffer.
+ */
+void RenderTargetPool::ReleaseFramebuffer(Framebuffer* framebuffer)
+{
+	for (PooledFramebuffer& pooled : m_framebuffers) {
+		if (pooled.framebuffer.get() == framebuffer) {
+			ASSERT(pooled.inUse);
+			pooled.inUse = false;
+			return;
+		}
+	}
+	ASSERT(false); // Not a framebuffer of this pool
+}
+
+/**
+ * @brief Ends the frame and deletes the entries that stayed unused for MaxIdleFrames frames.
+ */
+void RenderTargetPool::EndFrame()
+{
+	m_frame++;
+	DeleteIdle(MaxIdleFrames);
+}
+
+/**
+ * @brief Deletes every unused texture and framebuffer immediately.
+ */
+void RenderTargetPool::Trim()
+{
+	DeleteIdle(0);
+}
+
+/**
+ * @brief Resets the counters of the statistics. Current counts are kept.
+ */
+void RenderTargetPool::ResetStats()
+{
+	m_stats = Stats();
+	m_stats.textureCount = (unsigned int)m_textures.size();
+	m_stats.framebufferCount = (unsigned int)m_framebuffers.size();
+}
+
+/**
+ * @brief Deletes the unused entries idle for at least the given number of frames.
+ *
+ * @param idleFrames Minimum number of frames since the entry was last acquired.
+ */
+void RenderTargetPool::DeleteIdle(unsigned int idleFrames)
+{
+	for (size_t i = m_textures.size(); i-- > 0;) {
+		const PooledTexture& texture = m_textures[i];
+		if (texture.inUse || m_frame - texture.lastUsedFrame < idleFrames)
+			continue;
+
+		Framebuffer::DeleteTexture(texture.rendererID);
+		m_textures.erase(m_textures.begin() + i);
+		m_stats.deletedCount++;
+	}
+
+	for (size_t i = m_framebuffers.size(); i-- > 0;) {
+		const PooledFramebuffer& pooled = m_framebuffers[i];
+		if (pooled.inUse || m_frame - pooled.lastUsedFrame < idleFrames)
+			continue;
+
+		m_framebuffers.erase(m_framebuffers.begin() + i);
+		m_stats.deletedCount++;
+	}
+
+	m_stats.textureCount = (unsigned int)m_textures.size();
+	m_stats.framebufferCount = (unsigned int)m_framebuffers.size();
+}
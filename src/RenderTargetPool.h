@@ -0,0 +1,131 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Framebuffer.h"
+
+/**
+ * @brief RenderTargetPool class that recycles offscreen textures and framebuffers across frames.
+ *
+ * Acquire returns an unused entry with exactly the requested size and format, and only creates
+ * a new GL object when none is free. Released entries stay in the pool; EndFrame deletes the
+ * ones that were not acquired for MaxIdleFrames frames, so a resize does not keep the old
+ * targets alive forever.
+ */
+class RenderTargetPool {
+public:
+	/**
+	 * @brief Pool statistics. Counters accumulate until ResetStats.
+	 */
+	struct Stats {
+		unsigned int textureCount = 0;            ///< Textures currently in the pool, used or not.
+		unsigned int framebufferCount = 0;        ///< Framebuffers currently in the pool, used or not.
+		unsigned int createdTextureCount = 0;     ///< Textures created.
+		unsigned int createdFramebufferCount = 0; ///< Framebuffers created.
+		unsigned int reusedCount = 0;             ///< Acquisitions served from the pool.
+		unsigned int deletedCount = 0;            ///< Textures and framebuffers deleted by EndFrame.
+	};
+
+	/// Frames an entry may stay unused before EndFrame deletes it.
+	static const unsigned int MaxIdleFrames = 60;
+
+private:
+	/**
+	 * @brief A texture of the pool.
+	 */
+	struct PooledTexture {
+		unsigned int rendererID;    ///< Renderer ID of the texture.
+		RenderTargetDesc desc;      ///< Size and format.
+		bool inUse;                 ///< Whether it is acquired.
+		unsigned int lastUsedFrame; ///< Last frame it was acquired in.
+	};
+
+	/**
+	 * @brief A framebuffer of the pool.
+	 */
+	struct PooledFramebuffer {
+		std::unique_ptr<Framebuffer> framebuffer; ///< The framebuffer and its attachments.
+		bool inUse;                               ///< Whether it is acquired.
+		unsigned int lastUsedFrame;               ///< Last frame it was acquired in.
+	};
+
+	std::vector<PooledTexture> m_textures; ///< Textures kept across frames
+	std::vector<PooledFramebuffer> m_framebuffers; ///< Framebuffers kept across frames
+	unsigned int m_frame; ///< Index of the frame, for MaxIdleFrames
+	Stats m_stats; ///< Pool statistics
+
+public:
+	/**
+	 * @brief Constructs an empty RenderTargetPool.
+	 */
+	RenderTargetPool();
+
+	/**
+	 * @brief Destroys the RenderTargetPool and deletes every texture and framebuffer it holds.
+	 */
+	~RenderTargetPool();
+
+	RenderTargetPool(const RenderTargetPool&) = delete;
+	RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+	/**
+	 * @brief Gets an unused texture of the given size and format, creating one if none is free.
+	 *
+	 * @param desc Size and format of the texture.
+	 * @return unsigned int Renderer ID of the texture.
+	 */
+	unsigned int AcquireTexture(const RenderTargetDesc& desc);
+
+	/**
+	 * @brief Gives a texture back to the pool. Its contents are undefined when acquired again.
+	 *
+	 * @param texture Renderer ID returned by AcquireTexture.
+	 */
+	void ReleaseTexture(unsigned int texture);
+
+	/**
+	 * @brief Gets an unused framebuffer with the given attachments, creating one if none is free.
+	 *
+	 * @param spec Size, formats and sample count of the attachments.
+	 * @return Framebuffer* The framebuffer, owned by the pool.
+	 */
+	Framebuffer* AcquireFramebuffer(const FramebufferSpec& spec);
+
+	/**
+	 * @brief Gives a framebuffer back to the pool. Its contents are undefined when acquired again.
+	 *
+	 * @param framebuffer Framebuffer returned by AcquireFramebuffer.
+	 */
+	void ReleaseFramebuffer(Framebuffer* framebuffer);
+
+	/**
+	 * @brief Ends the frame and deletes the entries that stayed unused for MaxIdleFrames frames.
+	 */
+	void EndFrame();
+
+	/**
+	 * @brief Deletes every unused texture and framebuffer immediately.
+	 */
+	void Trim();
+
+	/**
+	 * @brief Gets the pool statistics.
+	 *
+	 * @return const Stats& The statistics.
+	 */
+	inline const Stats& GetStats() const { return m_stats; }
+
+	/**
+	 * @brief Resets the counters of the statistics. Current counts are kept.
+	 */
+	void ResetStats();
+
+private:
+	/**
+	 * @brief Deletes the unused entries idle for at least the given number of frames.
+	 *
+	 * @param idleFrames Minimum number of frames since the entry was last acquired.
+	 */
+	void DeleteIdle(unsigned int idleFrames);
+};
@@ -1,47 +1,416 @@
 #include "Renderer.h"
+#include "Texture.h"
+#include "GLStateCache.h"
+#include "IndirectDrawBuffer.h"
+#include "CommandList.h"
+#include "OcclusionQuery.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "VertexBufferLayout.h"
+#include <algorithm>
 #include <iostream>
 
 /**
- * @brief Clears all OpenGL errors by calling glGetError until no errors are left.
+ * @brief Clears the screen by clearing the color and depth buffers.
  */
-void GLClearError() {
-	while (glGetError() != GL_NO_ERROR);
+void Renderer::Clear() const {
+	GLCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
 
 /**
- * @brief Logs OpenGL errors with details of the function, file, and line number.
+ * @brief Draws the given vertex array and index buffer using the specified shader.
  *
- * @param function The name of the function where the error occurred.
- * @param file The file where the error occurred.
- * @param line The line number where the error occurred.
- * @return true if no errors, false if there were errors.
+ * @param va The vertex array to draw.
+ * @param ib The index buffer to use for drawing.
+ * @param shader The shader to use for drawing.
  */
-bool GLLogCall(const char* function, const char* file, int line) {
-	while (GLenum error = glGetError()) {
-		std::cout << "[OpenGL Error] (" << error << "): " << function << " " << file << ": " << line << std::endl;
-		return false;
-	}
-
-	return true;
+void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const {
+	PROFILE_FUNCTION();
+	shader.Bind();
+	va.Bind();
+	ib.Bind();
+	GLCall(glDrawElements(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr));
 }
 
 /**
- * @brief Clears the screen by clearing the color buffer.
+ * @brief Draws instanceCount instances of the given vertex array and index buffer in one call.
+ *
+ * @param va The vertex array to draw.
+ * @param ib The index buffer to use for drawing.
+ * @param shader The shader to use for drawing.
+ * @param instanceCount The number of instances to draw.
  */
-void Renderer::Clear() const {
-	GLCall(glClear(GL_COLOR_BUFFER_BIT));
+void Renderer::DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int instanceCount) const {
+	shader.Bind();
+	va.Bind();
+	ib.Bind();
+	GLCall(glDrawElementsInstanced(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr, instanceCount));
 }
 
 /**
- * @brief Draws the given vertex array and index buffer using the specified shader.
+ * @brief Draws one mesh out of vertex and index buffers that hold several meshes.
  *
  * @param va The vertex array to draw.
  * @param ib The index buffer to use for drawing.
  * @param shader The shader to use for drawing.
+ * @param count Number of indices of the mesh.
+ * @param firstIndex Offset of the first index of the mesh, in indices.
+ * @param baseVertex Offset of the first vertex of the mesh, in vertices.
  */
-void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const {
+void Renderer::DrawRange(const VertexArray& va, const IndexBuffer& ib, const Shader& shader,
+	unsigned int count, unsigned int firstIndex, int baseVertex) const {
 	shader.Bind();
 	va.Bind();
 	ib.Bind();
-	GLCall(glDrawElements(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr));
+	void* offset = (void*)(uintptr_t)(firstIndex * sizeof(unsigned int));
+	GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_INT, offset, baseVertex));
+}
+
+/**
+ * @brief Draws one triangle covering the viewport, for post-processing.
+ *
+ * @param shader The shader to use for drawing.
+ */
+void Renderer::DrawFullscreen(const Shader& shader) {
+	// Core profiles refuse to draw without a vertex array, even one without attributes
+	if (!m_emptyVa)
+		m_emptyVa.reset(new VertexArray());
+
+	shader.Bind();
+	m_emptyVa->Bind();
+	GLCall(glDrawArrays(GL_TRIANGLES, 0, 3));
+}
+
+/**
+ * @brief Executes every draw recorded in an IndirectDrawBuffer with a single
+ * glMultiDrawElementsIndirect call, or one draw per command on older contexts.
+ *
+ * @param va The vertex array to draw, with the per-draw data as a per-instance buffer.
+ * @param ib The index buffer to use for drawing.
+ * @param shader The shader to use for drawing.
+ * @param draws The draws to execute. Uploaded first if they changed.
+ */
+void Renderer::MultiDrawIndirect(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, IndirectDrawBuffer& draws) {
+	if (draws.GetDrawCount() == 0)
+		return;
+
+	GpuProfileScope scope(m_profiler, "Renderer::MultiDrawIndirect");
+	shader.Bind();
+	va.Bind();
+	ib.Bind();
+
+	if (m_useMultiDrawIndirect && (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect)) {
+		draws.Upload();
+		draws.Bind();
+		GLCall(glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, draws.GetDrawCount(), 0));
+		m_stats.multiDrawIndirectCalls++;
+		return;
+	}
+
+	const bool baseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+	for (const DrawElementsIndirectCommand& command : draws.GetCommands()) {
+		const void* offset = (const void*)(uintptr_t)(command.firstIndex * sizeof(unsigned int));
+		if (baseInstance) {
+			GLCall(glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, offset,
+				command.instanceCount, command.baseVertex, command.baseInstance));
+		}
+		else {
+			// Without base instance support the per-instance attributes are moved to the draw's rows
+			va.SetBaseInstance(command.baseInstance);
+			GLCall(glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, offset,
+				command.instanceCount, command.baseVertex));
+		}
+	}
+
+	if (baseInstance) {
+		m_stats.indirectFallbackDraws += draws.GetDrawCount();
+	}
+	else {
+		va.SetBaseInstance(0);
+		m_stats.emulatedBaseInstanceDraws += draws.GetDrawCount();
+	}
+}
+
+/**
+ * @brief Records a draw into the frame queue. Nothing is sent to OpenGL until Flush.
+ *
+ * @param va The vertex array to draw.
+ * @param ib The index buffer to use for drawing.
+ * @param shader The shader to use for drawing. Its u_MVP uniform is set to mvp.
+ * @param mvp The model view projection matrix of the draw.
+ * @param texture The texture to bind to slot 0, or nullptr for none.
+ * @param state The fixed-function state of the draw.
+ * @param occlusion Occlusion query of the draw, or nullptr to always draw it.
+ */
+void Renderer::Submit(const VertexArray& va, const IndexBuffer& ib, Shader& shader, const glm::mat4& mvp,
+	const Texture* texture, const RenderState& state, OcclusionQuery* occlusion)
+{
+	RenderCommand command = { &va, &ib, &shader, texture, mvp, state, occlusion };
+	m_sortKeys.push_back(BuildSortKey(command));
+	m_commands.push_back(command);
+}
+
+/**
+ * @brief Sorts the queued draws by key, executes them and empties the queue.
+ *
+ * Draws without texture unbind texture unit 0, and blending and depth testing are back to
+ * the RenderState defaults afterwards.
+ */
+void Renderer::Flush()
+{
+	if (m_commands.empty())
+		return;
+
+	PROFILE_FUNCTION();
+	GpuProfileScope scope(m_profiler, "Renderer::Flush");
+	SortQueue();
+
+	// Consecutive draws share most of their state after sorting, so the binds below are
+	// mostly absorbed by the GLStateCache
+	for (uint32_t index : m_sortedIndices) {
+		const RenderCommand& command = m_commands[index];
+
+		bool occlusionTested = false;
+		if (command.occlusion) {
+			// Read before the new test is issued: only results of earlier frames are available
+			const bool visible = command.occlusion->IsVisible();
+			DrawOcclusionProxy(command);
+			if (!visible) {
+				m_stats.occludedDraws++;
+				continue;
+			}
+			occlusionTested = true;
+		}
+
+		GLStateCache::SetCapability(GL_BLEND, command.state.blend);
+		GLStateCache::SetCapability(GL_DEPTH_TEST, command.state.depthTest);
+		command.shader->Bind();
+		command.va->Bind();
+		command.ib->Bind();
+		// A draw without texture must not sample whatever the previous one bound
+		if (command.texture)
+			command.texture->Bind(0);
+		else
+			GLStateCache::BindTexture(0, 0);
+
+		command.shader->SetUniformMat4f("u_MVP"_u, command.mvp);
+
+		// The GPU drops the draw if this frame's box test passed no samples, without a CPU wait
+		if (occlusionTested) {
+			GLCall(glBeginConditionalRender(command.occlusion->GetCurrentID(), GL_QUERY_NO_WAIT));
+		}
+		GLCall(glDrawElements(GL_TRIANGLES, command.ib->GetCount(), GL_UNSIGNED_INT, nullptr));
+		if (occlusionTested) {
+			GLCall(glEndConditionalRender());
+		}
+	}
+
+	// Draws issued after the queue start from the default state, not the last command's
+	const RenderState defaultState;
+	GLStateCache::SetCapability(GL_BLEND, defaultState.blend);
+	GLStateCache::SetCapability(GL_DEPTH_TEST, defaultState.depthTest);
+
+	m_commands.clear();
+	m_sortKeys.clear();
+}
+
+/**
+ * @brief Draws the bounding box of an occlusion query inside the query, without writing
+ * color or depth.
+ *
+ * @param command The draw the query belongs to.
+ */
+void Renderer::DrawOcclusionProxy(const RenderCommand& command)
+{
+	if (!m_proxyVa) {
+		const float positions[] = {
+			0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 1.0f,  1.0f, 0.0f, 1.0f,  1.0f, 1.0f, 1.0f,  0.0f, 1.0f, 1.0f
+		};
+		const unsigned int indices[] = {
+			0, 1, 2, 2, 3, 0, // Back
+			4, 5, 6, 6, 7, 4, // Front
+			0, 4, 7, 7, 3, 0, // Left
+			1, 5, 6, 6, 2, 1, // Right
+			0, 1, 5, 5, 4, 0, // Bottom
+			3, 2, 6, 6, 7, 3  // Top
+		};
+
+		m_proxyVa.reset(new VertexArray());
+		m_proxyVb.reset(new VertexBuffer(positions, sizeof(positions)));
+		VertexBufferLayout layout;
+		layout.Push<float>(3);
+		m_proxyVa->AddBuffer(*m_proxyVb, layout);
+		m_proxyVa->Bind(); // The index buffer binding is vertex array state
+		m_proxyIb.reset(new IndexBuffer(indices, 36));
+		m_proxyShader.reset(new Shader("res/Shaders/occlusion.shader"));
+	}
+
+	// The box is only tested against the depth buffer, it must not hide anything itself
+	GLStateCache::SetCapability(GL_DEPTH_TEST, true);
+	GLStateCache::SetCapability(GL_CULL_FACE, false);
+	GLStateCache::SetColorMask(false);
+	GLStateCache::SetDepthMask(false);
+
+	m_proxyShader->Bind();
+	m_proxyShader->SetUniformMat4f("u_MVP"_u, command.mvp * command.occlusion->GetProxyTransform());
+	m_proxyVa->Bind();
+	m_proxyIb->Bind();
+
+	command.occlusion->Begin();
+	GLCall(glDrawElements(GL_TRIANGLES, m_proxyIb->GetCount(), GL_UNSIGNED_INT, nullptr));
+	command.occlusion->End();
+
+	GLStateCache::SetColorMask(true);
+	GLStateCache::SetDepthMask(true);
+}
+
+/**
+ * @brief Replays the commands of a CommandList in the order they were recorded. Uniforms and
+ * draws recorded before any BindShader are skipped, and an unknown command ends the replay.
+ *
+ * @param list The commands to replay.
+ */
+void Renderer::Execute(const CommandList& list) const
+{
+	PROFILE_FUNCTION();
+	GpuProfileScope scope(m_profiler, "Renderer::Execute");
+	const std::vector<unsigned char>& buffer = list.GetBuffer();
+	Shader* shader = nullptr;
+	size_t offset = 0;
+
+	while (offset < buffer.size()) {
+		CommandType type = (CommandType)buffer[offset++];
+		switch (type) {
+		case CommandType::BindShader: {
+			shader = list.Read<BindShaderCommand>(offset).shader;
+			shader->Bind();
+			break;
+		}
+		case CommandType::BindTexture: {
+			BindTextureCommand command = list.Read<BindTextureCommand>(offset);
+			command.texture->Bind(command.slot);
+			break;
+		}
+		case CommandType::SetState: {
+			RenderState state = list.Read<RenderState>(offset);
+			GLStateCache::SetCapability(GL_BLEND, state.blend);
+			GLStateCache::SetCapability(GL_DEPTH_TEST, state.depthTest);
+			break;
+		}
+		case CommandType::SetUniform1i: {
+			SetUniform1iCommand command = list.Read<SetUniform1iCommand>(offset);
+			ASSERT(shader); // Recorded before BindShader
+			if (shader)
+				shader->SetUniform1i(command.name, command.value);
+			break;
+		}
+		case CommandType::SetUniform4f: {
+			SetUniform4fCommand command = list.Read<SetUniform4fCommand>(offset);
+			ASSERT(shader);
+			if (shader)
+				shader->SetUniform4f(command.name, command.value.x, command.value.y, command.value.z, command.value.w);
+			break;
+		}
+		case CommandType::SetUniformMat4f: {
+			SetUniformMat4fCommand command = list.Read<SetUniformMat4fCommand>(offset);
+			ASSERT(shader);
+			if (shader)
+				shader->SetUniformMat4f(command.name, command.value);
+			break;
+		}
+		case CommandType::Draw: {
+			DrawCommand command = list.Read<DrawCommand>(offset);
+			ASSERT(shader);
+			if (!shader)
+				break;
+			if (command.instanceCount == 0)
+				Draw(*command.va, *command.ib, *shader);
+			else
+				DrawInstanced(*command.va, *command.ib, *shader, command.instanceCount);
+			break;
+		}
+		default:
+			// The size of an unknown command is unknown too, nothing after it can be read
+			std::cout << "Warning: unknown command " << (int)type << " in a command list, the rest of the list is skipped" << std::endl;
+			ASSERT(false);
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Packs the state of a draw into a key whose ascending order minimizes state changes.
+ *
+ * @param command The draw to build the key for.
+ * @return uint64_t The sort key.
+ */
+uint64_t Renderer::BuildSortKey(const RenderCommand& command)
+{
+	const uint64_t shader = command.shader->GetRendererID();
+	const uint64_t texture = command.texture ? command.texture->GetRendererID() : 0;
+	const uint64_t va = command.va->GetRendererID();
+	const uint64_t depthTest = command.state.depthTest ? 1 : 0;
+	const float depth = std::min(std::max(command.state.depth, 0.0f), 1.0f);
+
+	if (!command.state.blend) {
+		// Opaque: group by state first, then front to back to help early depth rejection
+		const uint64_t quantizedDepth = (uint64_t)(depth * 0x3FFF);
+		return (depthTest << 62)
+			| ((shader & 0xFFFF) << 46)
+			| ((texture & 0xFFFF) << 30)
+			| ((va & 0xFFFF) << 14)
+			| quantizedDepth;
+	}
+
+	// Blended: correctness requires back to front, state grouping only breaks ties
+	const uint64_t invertedDepth = 0xFFFFFF - (uint64_t)(depth * 0xFFFFFF);
+	return (1ull << 63)
+		| (invertedDepth << 39)
+		| (depthTest << 38)
+		| ((shader & 0xFFF) << 26)
+		| ((texture & 0x1FFF) << 13)
+		| (va & 0x1FFF);
+}
+
+/**
+ * @brief Sorts m_sortedIndices by m_sortKeys with an LSD radix sort, one byte per pass.
+ *
+ * Passes where every key has the same byte are skipped, which is the common case for the
+ * high bytes since the number of distinct shaders and textures in a frame is small.
+ */
+void Renderer::SortQueue()
+{
+	const size_t count = m_sortKeys.size();
+	m_sortedIndices.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		m_sortedIndices[i] = i;
+
+	m_scratchKeys.resize(count);
+	m_scratchIndices.resize(count);
+
+	for (unsigned int shift = 0; shift < 64; shift += 8) {
+		size_t histogram[256] = {};
+		for (size_t i = 0; i < count; i++)
+			histogram[(m_sortKeys[i] >> shift) & 0xFF]++;
+
+		if (histogram[(m_sortKeys[0] >> shift) & 0xFF] == count)
+			continue; // Every key shares this byte
+
+		size_t offset = 0;
+		for (size_t& bucket : histogram) {
+			size_t bucketCount = bucket;
+			bucket = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			size_t destination = histogram[(m_sortKeys[i] >> shift) & 0xFF]++;
+			m_scratchKeys[destination] = m_sortKeys[i];
+			m_scratchIndices[destination] = m_sortedIndices[i];
+		}
+
+		m_sortKeys.swap(m_scratchKeys);
+		m_sortedIndices.swap(m_scratchIndices);
+	}
 }
\ No newline at end of file
@@ -2,32 +2,84 @@
 
 #include <GL/glew.h>
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "VertexArray.h"
 #include "IndexBuffer.h"
 #include "Shader.h"
+#include "GLDebug.h"
+#include "glm/glm.hpp"
 
-#define ASSERT(x) if (!(x)) __debugbreak(); // Break debugging if x returns false
-#define GLCall(x) GLClearError(); x; ASSERT(GLLogCall(#x, __FILE__, __LINE__)); // Wrap a function with an error boundary
+class Texture;
+class IndirectDrawBuffer;
+class CommandList;
+class OcclusionQuery;
+class GpuProfiler;
 
 /**
- * @brief Clears all OpenGL errors.
+ * @brief Fixed-function state a submitted draw needs.
  */
-void GLClearError();
+struct RenderState {
+	bool blend = false;     ///< Whether alpha blending is enabled. Blended draws are sorted after opaque ones.
+	bool depthTest = false; ///< Whether depth testing is enabled.
+	float depth = 0.0f;     ///< Normalized view depth in [0, 1] used to order draws (0 is nearest).
+};
 
 /**
- * @brief Logs OpenGL errors with details of the function, file, and line number..
- *
- * @param function The name of the function where the error occurred.
- * @param file The file where the error occurred.
- * @param line The line number where the error occurred.
- * @return true if no errors, false if there were errors.
+ * @brief A draw recorded by Renderer::Submit and executed by Renderer::Flush.
  */
-bool GLLogCall(const char* function, const char* file, int line);
+struct RenderCommand {
+	const VertexArray* va;   ///< Vertex array to draw.
+	const IndexBuffer* ib;   ///< Index buffer to draw with.
+	Shader* shader;          ///< Shader to draw with.
+	const Texture* texture;  ///< Texture bound to slot 0, or nullptr for none.
+	glm::mat4 mvp;           ///< Value uploaded to the u_MVP uniform.
+	RenderState state;       ///< Fixed-function state of the draw.
+	OcclusionQuery* occlusion; ///< Occlusion query of the draw, or nullptr to always draw it.
+};
 
 /**
  * @brief Renderer class that handles rendering operations.
+ *
+ * Draws can either be issued immediately with Draw, or recorded with Submit into a per-frame
+ * queue. Flush sorts the queue by a 64-bit key and executes it, only changing GL state
+ * between draws when the next draw needs something different.
+ *
+ * Sort key layout for opaque draws (most significant bit first):
+ * | blend (1) | depth test (1) | shader (16) | texture (16) | VAO (16) | depth front-to-back (14) |
+ *
+ * Sort key layout for blended draws, which must be drawn back to front:
+ * | blend (1) | depth back-to-front (24) | depth test (1) | shader (12) | texture (13) | VAO (13) |
  */
 class Renderer {
+public:
+	/**
+	 * @brief Draw statistics since the last ResetStats.
+	 */
+	struct Stats {
+		unsigned int occludedDraws = 0; ///< Submitted draws skipped because their occlusion query found them hidden.
+		unsigned int multiDrawIndirectCalls = 0; ///< MultiDrawIndirect calls executed with one glMultiDrawElementsIndirect.
+		unsigned int indirectFallbackDraws = 0;  ///< Draws MultiDrawIndirect issued one by one instead.
+		unsigned int emulatedBaseInstanceDraws = 0; ///< Draws issued one by one with their instance attributes rebound, without base instance support.
+	};
+
+private:
+	std::vector<RenderCommand> m_commands; ///< Draws submitted this frame.
+	std::vector<uint64_t> m_sortKeys;      ///< Sort key of each submitted draw.
+	std::vector<uint32_t> m_sortedIndices; ///< Indices into m_commands, sorted by key after Flush.
+	std::vector<uint64_t> m_scratchKeys;   ///< Scratch buffer for the radix sort.
+	std::vector<uint32_t> m_scratchIndices; ///< Scratch buffer for the radix sort.
+	std::unique_ptr<VertexArray> m_proxyVa;  ///< Unit cube drawn for occlusion queries, created on first use.
+	std::unique_ptr<VertexBuffer> m_proxyVb; ///< Vertices of the unit cube.
+	std::unique_ptr<IndexBuffer> m_proxyIb;  ///< Indices of the unit cube.
+	std::unique_ptr<Shader> m_proxyShader;   ///< Shader drawing the unit cube.
+	std::unique_ptr<VertexArray> m_emptyVa;  ///< Vertex array without attributes for DrawFullscreen, created on first use.
+	Stats m_stats;                           ///< Draw statistics.
+	GpuProfiler* m_profiler = nullptr;       ///< Profiler draws are attributed to, or nullptr.
+	bool m_useMultiDrawIndirect = true;      ///< Whether MultiDrawIndirect may use glMultiDrawElementsIndirect.
+
 public:
 	/**
 	 * @brief Clears the screen.
@@ -42,4 +94,151 @@ public:
 	 * @param shader The shader to use for drawing.
 	 */
 	void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const;
+
+	/**
+	 * @brief Draws instanceCount instances of the given vertex array and index buffer in one call.
+	 *
+	 * Per-instance data comes from buffers added to the vertex array with a layout whose
+	 * divisor is not 0, and gl_InstanceID is available to the shader.
+	 *
+	 * @param va The vertex array to draw.
+	 * @param ib The index buffer to use for drawing.
+	 * @param shader The shader to use for drawing.
+	 * @param instanceCount The number of instances to draw.
+	 */
+	void DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int instanceCount) const;
+
+	/**
+	 * @brief Draws one mesh out of vertex and index buffers that hold several meshes.
+	 *
+	 * @param va The vertex array to draw.
+	 * @param ib The index buffer to use for drawing.
+	 * @param shader The shader to use for drawing.
+	 * @param count Number of indices of the mesh.
+	 * @param firstIndex Offset of the first index of the mesh, in indices.
+	 * @param baseVertex Offset of the first vertex of the mesh, in vertices.
+	 */
+	void DrawRange(const VertexArray& va, const IndexBuffer& ib, const Shader& shader,
+		unsigned int count, unsigned int firstIndex, int baseVertex) const;
+
+	/**
+	 * @brief Draws one triangle covering the viewport, for post-processing.
+	 *
+	 * The vertex shader gets no attributes and builds the triangle from gl_VertexID.
+	 *
+	 * @param shader The shader to use for drawing.
+	 */
+	void DrawFullscreen(const Shader& shader);
+
+	/**
+	 * @brief Executes every draw recorded in an IndirectDrawBuffer with a single
+	 * glMultiDrawElementsIndirect call.
+	 *
+	 * Requires OpenGL 4.3 or ARB_multi_draw_indirect. Older contexts fall back to one draw per
+	 * command; without OpenGL 4.2 or ARB_base_instance that fallback points the per-instance
+	 * attributes of the vertex array at the rows of each draw before issuing it.
+	 *
+	 * @param va The vertex array to draw, with the per-draw data as a per-instance buffer.
+	 * @param ib The index buffer to use for drawing.
+	 * @param shader The shader to use for drawing.
+	 * @param draws The draws to execute. Uploaded first if they changed.
+	 */
+	void MultiDrawIndirect(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, IndirectDrawBuffer& draws);
+
+	/**
+	 * @brief Forces MultiDrawIndirect onto its one draw per command fallback, to test or
+	 * compare it on contexts that support multi-draw indirect.
+	 *
+	 * @param useMultiDrawIndirect Whether glMultiDrawElementsIndirect is used when supported. True by default.
+	 */
+	inline void SetUseMultiDrawIndirect(bool useMultiDrawIndirect) { m_useMultiDrawIndirect = useMultiDrawIndirect; }
+
+	/**
+	 * @brief Records a draw into the frame queue. Nothing is sent to OpenGL until Flush.
+	 *
+	 * The referenced objects must stay alive until the next Flush.
+	 *
+	 * @param va The vertex array to draw.
+	 * @param ib The index buffer to use for drawing.
+	 * @param shader The shader to use for drawing. Its u_MVP uniform is set to mvp.
+	 * @param mvp The model view projection matrix of the draw.
+	 * @param texture The texture to bind to slot 0, or nullptr for none.
+	 * @param state The fixed-function state of the draw.
+	 * @param occlusion Occlusion query of the draw, or nullptr to always draw it. Flush tests
+	 * the query's bounding box against what was drawn before it in the sorted queue, and skips
+	 * the draw while the last available result says it is hidden. When it is drawn, it is
+	 * conditionally rendered on the box test of the same frame.
+	 */
+	void Submit(const VertexArray& va, const IndexBuffer& ib, Shader& shader, const glm::mat4& mvp,
+		const Texture* texture = nullptr, const RenderState& state = RenderState(), OcclusionQuery* occlusion = nullptr);
+
+	/**
+	 * @brief Sorts the queued draws by key, executes them and empties the queue.
+	 *
+	 * Draws without texture unbind texture unit 0, and blending and depth testing are back to
+	 * the RenderState defaults afterwards.
+	 */
+	void Flush();
+
+	/**
+	 * @brief Replays the commands of a CommandList in the order they were recorded.
+	 *
+	 * Must be called on the thread that owns the OpenGL context. Uniforms and draws recorded
+	 * before any BindShader are skipped, and an unknown command ends the replay.
+	 *
+	 * @param list The commands to replay.
+	 */
+	void Execute(const CommandList& list) const;
+
+	/**
+	 * @brief Gets the number of draws waiting for the next Flush.
+	 *
+	 * @return size_t Number of queued draws.
+	 */
+	inline size_t GetQueuedCount() const { return m_commands.size(); }
+
+	/**
+	 * @brief Gets the draw statistics since the last ResetStats.
+	 *
+	 * @return const Stats& The statistics.
+	 */
+	inline const Stats& GetStats() const { return m_stats; }
+
+	/**
+	 * @brief Resets the draw statistics, typically once per frame.
+	 */
+	inline void ResetStats() { m_stats = Stats(); }
+
+	/**
+	 * @brief Attributes the GPU time of every group of draws to a profiler.
+	 *
+	 * Groups are profiled as "Renderer::MultiDrawIndirect", "Renderer::Flush" and
+	 * "Renderer::Execute". Immediate draws are not: a timer query pair per draw would cost more
+	 * than most draws measure, so wrap them in a GpuProfileScope per pass or batch instead.
+	 *
+	 * @param profiler The profiler, or nullptr to stop profiling.
+	 */
+	inline void SetProfiler(GpuProfiler* profiler) { m_profiler = profiler; }
+
+private:
+	/**
+	 * @brief Packs the state of a draw into a key whose ascending order minimizes state changes.
+	 *
+	 * @param command The draw to build the key for.
+	 * @return uint64_t The sort key.
+	 */
+	static uint64_t BuildSortKey(const RenderCommand& command);
+
+	/**
+	 * @brief Sorts m_sortedIndices by m_sortKeys with an LSD radix sort, one byte per pass.
+	 */
+	void SortQueue();
+
+	/**
+	 * @brief Draws the bounding box of an occlusion query inside the query, without writing
+	 * color or depth.
+	 *
+	 * @param command The draw the query belongs to.
+	 */
+	void DrawOcclusionProxy(const RenderCommand& command);
 };
\ No newline at end of file
@@ -1,19 +1,49 @@
 #include "Shader.h"
 #include "Renderer.h"
+#include "GLStateCache.h"
+#include "CpuProfiler.h"
+#include "VertexArray.h"
+#include "VertexBufferLayout.h"
+#include "ProgramBinaryCache.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstring>
+
+Shader::UniformStats Shader::s_uniformStats;
+int Shader::s_parallelCompile = -1;
 
 /**
- * @brief Constructs a Shader object and compiles the shader from the given file path.
+ * @brief Constructs a Shader object and compiles the shader from the given file path, or loads
+ * the linked program from the ProgramBinaryCache when the same sources were compiled before.
  *
  * @param filePath Path to the shader file.
+ * @param mode Whether to wait for the link or only submit it.
  */
-Shader::Shader(const std::string& filePath)
-	: m_filepath(filePath), m_rendererID(0)
+Shader::Shader(const std::string& filePath, ShaderCompileMode mode)
+	: m_filepath(filePath), m_rendererID(0), m_cacheKey(0), m_pendingShaders{ 0, 0 }, m_ready(false), m_failed(false), m_fallback(nullptr)
 {
+	/* Let the driver compile on as many threads as it likes, once per context */
+	if (s_parallelCompile == -1) {
+		s_parallelCompile = 0;
+		if (GLEW_KHR_parallel_shader_compile) {
+			GLCall(glMaxShaderCompilerThreadsKHR(0xFFFFFFFF));
+			s_parallelCompile = 1;
+		}
+		else if (GLEW_ARB_parallel_shader_compile) {
+			GLCall(glMaxShaderCompilerThreadsARB(0xFFFFFFFF));
+			s_parallelCompile = 1;
+		}
+	}
+
 	ShaderProgramSource source = ParseShader(filePath);
-	m_rendererID = CreateShader(source.VertexSource, source.FragmentSource);
+	m_cacheKey = ProgramBinaryCache::ComputeKey(source.VertexSource, source.FragmentSource);
+	m_rendererID = ProgramBinaryCache::Load(m_cacheKey);
+	if (m_rendererID == 0)
+		m_rendererID = CreateShader(source.VertexSource, source.FragmentSource);
+
+	if (mode == ShaderCompileMode::Blocking)
+		FinishLink();
 }
 
 /**
@@ -21,7 +51,61 @@ Shader::Shader(const std::string& filePath)
  */
 Shader::~Shader()
 {
+	for (unsigned int id : m_pendingShaders) {
+		if (id != 0)
+			GLCall(glDeleteShader(id));
+	}
 	GLCall(glDeleteProgram(m_rendererID));
+	GLStateCache::OnProgramDeleted(m_rendererID);
+}
+
+/**
+ * @brief Tells whether the program is linked, finishing the link when the driver is done.
+ *
+ * GL_COMPLETION_STATUS_KHR is polled without waiting for the compiler threads. Without
+ * parallel compilation there is no way to ask, so the first call waits for the link.
+ *
+ * @return bool True once the program can be used.
+ */
+bool Shader::IsReady()
+{
+	if (m_ready)
+		return !m_failed;
+
+	if (s_parallelCompile == 1) {
+		int complete = GL_FALSE;
+		GLCall(glGetProgramiv(m_rendererID, GL_COMPLETION_STATUS_KHR, &complete));
+		if (complete == GL_FALSE)
+			return false;
+	}
+	FinishLink();
+	return !m_failed;
+}
+
+/**
+ * @brief Waits until the program is linked, reporting compile and link errors.
+ */
+void Shader::WaitUntilReady()
+{
+	if (!m_ready)
+		FinishLink();
+}
+
+/**
+ * @brief Gets the shader to draw with this frame: this one if it is ready, else the fallback.
+ *
+ * @return Shader& This shader, or the fallback while this one is compiling or if it failed.
+ * Waits for this shader if it has no fallback.
+ */
+Shader& Shader::ReadyOrFallback()
+{
+	if (IsReady())
+		return *this;
+	if (m_fallback)
+		return m_fallback->ReadyOrFallback();
+
+	WaitUntilReady();
+	return *this;
 }
 
 /**
@@ -63,11 +147,13 @@ ShaderProgramSource Shader::ParseShader(const std::string& filePath)
 }
 
 /**
- * @brief Compiles a shader of the given type from the source code.
+ * @brief Submits the compilation of a shader of the given type from the source code.
+ *
+ * The compile status is not queried here, as that would wait for the compiler.
  *
  * @param type The type of shader (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER).
  * @param source The source code of the shader.
- * @return unsigned int The ID of the compiled shader.
+ * @return unsigned int The ID of the shader, checked by FinishLink.
  */
 unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
 {
@@ -75,8 +161,18 @@ unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
 	const char* src = source.c_str(); // Return the pointer of the first character of the source
 	GLCall(glShaderSource(id, 1, &src, nullptr)); // Specify the shader source code
 	GLCall(glCompileShader(id));
+	return id;
+}
 
-	// Error handling
+/**
+ * @brief Reports the errors of a shader that failed to compile.
+ *
+ * @param id The ID of the shader.
+ * @param type The type of shader (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER).
+ * @return bool True if the shader compiled.
+ */
+bool Shader::CheckCompileStatus(unsigned int id, unsigned int type)
+{
 	int result;
 	GLCall(glGetShaderiv(id, GL_COMPILE_STATUS, &result)); // Returns the compile status parameter
 	if (result == GL_FALSE)
@@ -85,40 +181,80 @@ unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
 		GLCall(glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length));
 		char* message = (char*)alloca(length * sizeof(char)); // Allocate this on the stack dynamically because 'char message[length]' is not allowed
 		GLCall(glGetShaderInfoLog(id, length, &length, message));
-		std::cout << "Failed to compile " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader:" << std::endl;
+		std::cout << "Failed to compile " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader of " << m_filepath << ":" << std::endl;
 		std::cout << message << std::endl;
-		GLCall(glDeleteShader(id));
-		return 0;
+		return false;
 	}
-
-	return id;
+	return true;
 }
 
 /**
- * @brief Creates a shader program from the given vertex and fragment shader source code.
+ * @brief Submits the compilation and link of a shader program from the given vertex and
+ * fragment shader source code.
+ *
+ * Nothing waits for the driver: both shaders are compiled and the program linked in the
+ * background with parallel compilation, and FinishLink checks the results.
  *
  * @param vertexShader The source code of the vertex shader.
  * @param fragmentShader The source code of the fragment shader.
- * @return unsigned int The ID of the created shader program.
+ * @return unsigned int The ID of the created shader program, finished by FinishLink.
  */
 unsigned int Shader::CreateShader(const std::string& vertexShader, const std::string& fragmentShader)
 {
 	unsigned int program = glCreateProgram(); // Create a shader program to attach shader to
-	unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
-	unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
+	m_pendingShaders[0] = CompileShader(GL_VERTEX_SHADER, vertexShader);
+	m_pendingShaders[1] = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
 
 	// Attach both shaders to the program
-	GLCall(glAttachShader(program, vs));
-	GLCall(glAttachShader(program, fs));
+	GLCall(glAttachShader(program, m_pendingShaders[0]));
+	GLCall(glAttachShader(program, m_pendingShaders[1]));
+	ProgramBinaryCache::PrepareForLink(program);
 
 	GLCall(glLinkProgram(program)); // Link the program so the shaders are used
-	GLCall(glValidateProgram(program)); // Check if the program can be executed
+	return program;
+}
+
+/**
+ * @brief Checks the result of the link in flight, stores the program in the cache and reflects it.
+ *
+ * Waits for the driver if it is still compiling. A program loaded from the cache has no link
+ * in flight and is only reflected. A program that failed to compile or link is marked failed
+ * and neither cached nor reflected.
+ */
+void Shader::FinishLink()
+{
+	PROFILE_FUNCTION();
+	if (m_pendingShaders[0] != 0) {
+		const bool vertexCompiled = CheckCompileStatus(m_pendingShaders[0], GL_VERTEX_SHADER);
+		const bool fragmentCompiled = CheckCompileStatus(m_pendingShaders[1], GL_FRAGMENT_SHADER);
 
-	// The shaders are linked to the program, so the shaders can be deleted
-	GLCall(glDeleteShader(vs));
-	GLCall(glDeleteShader(fs));
+		int linked;
+		GLCall(glGetProgramiv(m_rendererID, GL_LINK_STATUS, &linked));
+		if (linked == GL_FALSE && vertexCompiled && fragmentCompiled) {
+			int length;
+			GLCall(glGetProgramiv(m_rendererID, GL_INFO_LOG_LENGTH, &length));
+			std::vector<char> message(length > 0 ? length : 1, '\0');
+			GLCall(glGetProgramInfoLog(m_rendererID, (int)message.size(), &length, message.data()));
+			std::cout << "Failed to link " << m_filepath << ":" << std::endl;
+			std::cout << message.data() << std::endl;
+		}
 
-	return program;
+		// The shaders are linked to the program, so the shaders can be deleted
+		GLCall(glDeleteShader(m_pendingShaders[0]));
+		GLCall(glDeleteShader(m_pendingShaders[1]));
+		m_pendingShaders[0] = m_pendingShaders[1] = 0;
+
+		// A broken program is neither cached nor reflected, and never reported ready
+		m_failed = linked == GL_FALSE;
+		if (!m_failed)
+			ProgramBinaryCache::Store(m_cacheKey, m_rendererID);
+	}
+
+	if (!m_failed) {
+		m_reflection = ShaderReflection::Reflect(m_rendererID);
+		BuildUniformTable();
+	}
+	m_ready = true;
 }
 
 /**
@@ -126,7 +262,7 @@ unsigned int Shader::CreateShader(const std::string& vertexShader, const std::st
  */
 void Shader::Bind() const
 {
-	GLCall(glUseProgram(m_rendererID));
+	GLStateCache::UseProgram(m_rendererID);
 }
 
 /**
@@ -134,7 +270,7 @@ void Shader::Bind() const
  */
 void Shader::Unbind() const
 {
-	GLCall(glUseProgram(0));
+	GLStateCache::UseProgram(0);
 }
 
 /**
@@ -145,7 +281,42 @@ void Shader::Unbind() const
  */
 void Shader::SetUniform1i(const std::string& name, int value)
 {
-	GLCall(glUniform1i(GetUniformLocation(name), value));
+	SetUniform1i(UniformId(name.c_str(), name.size()), value);
+}
+
+/**
+ * @brief Sets an integer uniform variable in the shader, without allocating.
+ *
+ * @param id The hashed name of the uniform variable.
+ * @param value The integer value to set.
+ */
+void Shader::SetUniform1i(UniformId id, int value)
+{
+	Set(UniformHandle<int>{ GetUniformLocation(id), 1 }, value);
+}
+
+/**
+ * @brief Sets an integer array uniform variable in the shader.
+ *
+ * @param name The name of the uniform variable.
+ * @param count The number of elements to set.
+ * @param values Pointer to the integer values to set.
+ */
+void Shader::SetUniform1iv(const std::string& name, int count, const int* values)
+{
+	SetUniform1iv(UniformId(name.c_str(), name.size()), count, values);
+}
+
+/**
+ * @brief Sets an integer array uniform variable in the shader, without allocating.
+ *
+ * @param id The hashed name of the uniform variable.
+ * @param count The number of elements to set.
+ * @param values Pointer to the integer values to set.
+ */
+void Shader::SetUniform1iv(UniformId id, int count, const int* values)
+{
+	SetArray(UniformHandle<int>{ GetUniformLocation(id), count }, count, values);
 }
 
 /**
@@ -156,7 +327,18 @@ void Shader::SetUniform1i(const std::string& name, int value)
  */
 void Shader::SetUniform1f(const std::string& name, float value)
 {
-	GLCall(glUniform1f(GetUniformLocation(name), value));
+	SetUniform1f(UniformId(name.c_str(), name.size()), value);
+}
+
+/**
+ * @brief Sets a float uniform variable in the shader, without allocating.
+ *
+ * @param id The hashed name of the uniform variable.
+ * @param value The float value to set.
+ */
+void Shader::SetUniform1f(UniformId id, float value)
+{
+	Set(UniformHandle<float>{ GetUniformLocation(id), 1 }, value);
 }
 
 /**
@@ -170,7 +352,21 @@ void Shader::SetUniform1f(const std::string& name, float value)
  */
 void Shader::SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3)
 {
-	GLCall(glUniform4f(GetUniformLocation(name), v0, v1, v2, v3));
+	SetUniform4f(UniformId(name.c_str(), name.size()), v0, v1, v2, v3);
+}
+
+/**
+ * @brief Sets a vec4 uniform variable in the shader, without allocating.
+ *
+ * @param id The hashed name of the uniform variable.
+ * @param v0 The first value of the vec4.
+ * @param v1 The second value of the vec4.
+ * @param v2 The third value of the vec4.
+ * @param v3 The fourth value of the vec4.
+ */
+void Shader::SetUniform4f(UniformId id, float v0, float v1, float v2, float v3)
+{
+	Set(UniformHandle<glm::vec4>{ GetUniformLocation(id), 1 }, glm::vec4(v0, v1, v2, v3));
 }
 
 /**
@@ -181,24 +377,281 @@ void Shader::SetUniform4f(const std::string& name, float v0, float v1, float v2,
  */
 void Shader::SetUniformMat4f(const std::string& name, const glm::mat4& matrix)
 {
-	GLCall(glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]));
+	SetUniformMat4f(UniformId(name.c_str(), name.size()), matrix);
+}
+
+/**
+ * @brief Sets a mat4 uniform variable in the shader, without allocating.
+ *
+ * @param id The hashed name of the uniform variable.
+ * @param matrix The matrix to set.
+ */
+void Shader::SetUniformMat4f(UniformId id, const glm::mat4& matrix)
+{
+	Set(UniformHandle<glm::mat4>{ GetUniformLocation(id), 1 }, matrix);
+}
+
+/**
+ * @brief Sets an integer or sampler uniform through a handle.
+ *
+ * @param handle The handle of the uniform.
+ * @param value The value to set.
+ */
+void Shader::Set(UniformHandle<int> handle, int value)
+{
+	if (UpdateUniformShadow(handle.location, &value, sizeof(value))) {
+		GLCall(glUniform1i(handle.location, value));
+	}
+}
+
+/**
+ * @brief Sets the first elements of an integer or sampler array uniform through a handle.
+ *
+ * @param handle The handle of the uniform.
+ * @param count The number of elements to set.
+ * @param values Pointer to the values to set.
+ */
+void Shader::SetArray(UniformHandle<int> handle, int count, const int* values)
+{
+	if (UpdateUniformShadow(handle.location, values, count * sizeof(int), count)) {
+		GLCall(glUniform1iv(handle.location, count, values));
+	}
+}
+
+/**
+ * @brief Sets a float uniform through a handle.
+ *
+ * @param handle The handle of the uniform.
+ * @param value The value to set.
+ */
+void Shader::Set(UniformHandle<float> handle, float value)
+{
+	if (UpdateUniformShadow(handle.location, &value, sizeof(value))) {
+		GLCall(glUniform1f(handle.location, value));
+	}
+}
+
+/**
+ * @brief Sets a vec4 uniform through a handle.
+ *
+ * @param handle The handle of the uniform.
+ * @param value The value to set.
+ */
+void Shader::Set(UniformHandle<glm::vec4> handle, const glm::vec4& value)
+{
+	if (UpdateUniformShadow(handle.location, &value[0], sizeof(value))) {
+		GLCall(glUniform4f(handle.location, value.x, value.y, value.z, value.w));
+	}
+}
+
+/**
+ * @brief Sets a mat4 uniform through a handle.
+ *
+ * @param handle The handle of the uniform.
+ * @param value The value to set.
+ */
+void Shader::Set(UniformHandle<glm::mat4> handle, const glm::mat4& value)
+{
+	if (UpdateUniformShadow(handle.location, &value[0][0], sizeof(value))) {
+		GLCall(glUniformMatrix4fv(handle.location, 1, GL_FALSE, &value[0][0]));
+	}
+}
+
+/**
+ * @brief Connects a uniform block of the shader to a uniform buffer binding point.
+ *
+ * @param name The name of the uniform block.
+ * @param binding The binding point, as passed to UniformBufferManager.
+ */
+void Shader::SetUniformBlockBinding(const std::string& name, unsigned int binding)
+{
+	WaitUntilReady();
+
+	unsigned int index;
+	GLCall(index = glGetUniformBlockIndex(m_rendererID, name.c_str()));
+	if (index == GL_INVALID_INDEX) {
+		std::cout << "Warning: uniform block " << name << " doesn't exist!" << std::endl;
+		return;
+	}
+	GLCall(glUniformBlockBinding(m_rendererID, index, binding));
+}
+
+/**
+ * @brief Fills the location table with every active uniform of the reflection.
+ *
+ * Arrays are added both as "name" and "name[0]". Uniforms of uniform blocks have no location
+ * and are skipped.
+ */
+void Shader::BuildUniformTable()
+{
+	m_uniformLocations.Clear();
+	for (const ShaderUniform& uniform : m_reflection.uniforms) {
+		if (uniform.location == -1)
+			continue;
+
+		if (!m_uniformLocations.Insert(UniformId::Hash(uniform.name.c_str(), uniform.name.size()), uniform.location))
+			std::cout << "Warning: uniform " << uniform.name << " has the same hash as another uniform!" << std::endl;
+		if (uniform.arraySize > 1) {
+			const std::string element = uniform.name + "[0]";
+			m_uniformLocations.Insert(UniformId::Hash(element.c_str(), element.size()), uniform.location);
+		}
+	}
+}
+
+/**
+ * @brief Finds a uniform of the default block and checks its type.
+ *
+ * @param id The hashed name of the uniform.
+ * @param accepts Tells whether an OpenGL type matches the C++ type of the handle.
+ * @param arraySize Receives the number of array elements, 0 on failure.
+ * @return int The location of the uniform, -1 if it is not active or has another type.
+ */
+int Shader::ResolveUniform(UniformId id, bool (*accepts)(unsigned int), int& arraySize)
+{
+	arraySize = 0;
+	const ShaderUniform* uniform = m_reflection.FindUniform(GetUniformLocation(id));
+	if (!uniform)
+		return -1;
+
+	if (!accepts(uniform->type)) {
+		std::cout << "Warning: uniform " << id.name << " of " << m_filepath << " has another type than its handle!" << std::endl;
+		return -1;
+	}
+	arraySize = uniform->arraySize;
+	return uniform->location;
+}
+
+/**
+ * @brief Checks a vertex buffer layout against the vertex inputs of the program.
+ *
+ * Elements at locations the program does not read are fine, a layout can feed several programs.
+ *
+ * @param layout The layout.
+ * @param firstAttribute Attribute index of the first element of the layout.
+ * @return bool True if every element matches the input at its location.
+ */
+bool Shader::ValidateLayout(const VertexBufferLayout& layout, unsigned int firstAttribute) const
+{
+	ASSERT(m_ready);
+	bool valid = true;
+	const auto& elements = layout.GetElements();
+	for (unsigned int i = 0; i < elements.size(); i++) {
+		const int location = (int)(firstAttribute + i);
+		const ShaderAttribute* attribute = m_reflection.FindAttribute(location);
+		if (!attribute)
+			continue;
+
+		if (ShaderReflection::IsInteger(attribute->type)) {
+			std::cout << "Warning: attribute " << attribute->name << " of " << m_filepath << " is an integer, but location "
+				<< location << " is fed as float" << std::endl;
+			valid = false;
+		}
+		else if (elements[i].count > ShaderReflection::GetComponentCount(attribute->type)) {
+			std::cout << "Warning: location " << location << " has " << elements[i].count << " components, but attribute "
+				<< attribute->name << " of " << m_filepath << " reads " << ShaderReflection::GetComponentCount(attribute->type) << std::endl;
+			valid = false;
+		}
+	}
+	return valid;
+}
+
+/**
+ * @brief Checks that a vertex array sets up every attribute location the program reads.
+ *
+ * @param va The vertex array.
+ * @return bool True if no input is left without a buffer.
+ */
+bool Shader::ValidateVertexArray(const VertexArray& va) const
+{
+	ASSERT(m_ready);
+	bool valid = true;
+	for (const ShaderAttribute& attribute : m_reflection.attributes) {
+		const unsigned int end = attribute.location + ShaderReflection::GetLocationCount(attribute.type) * attribute.arraySize;
+		if (end > va.GetAttributeCount()) {
+			std::cout << "Warning: attribute " << attribute.name << " of " << m_filepath << " reads location " << end - 1
+				<< ", but the vertex array only sets up " << va.GetAttributeCount() << std::endl;
+			valid = false;
+		}
+	}
+	return valid;
 }
 
 /**
  * @brief Retrieves the location of a uniform variable in the shader program.
  *
- * @param name The name of the uniform variable.
- * @return int The location of the uniform variable.
+ * Active uniforms are found in the table built at link time. Other names, such as single array
+ * elements or uniforms that do not exist, are queried once and added to the table. The table
+ * is empty while the program is compiling, so the first lookup waits for it.
+ *
+ * @param id The hashed name of the uniform variable.
+ * @return int The location of the uniform variable, -1 if it is not active.
  */
-int Shader::GetUniformLocation(const std::string& name)
+int Shader::GetUniformLocation(UniformId id)
 {
-	if (m_uniformLocationCache.find(name) != m_uniformLocationCache.end())
-		return m_uniformLocationCache[name];
+	int location;
+	if (m_uniformLocations.Find(id.hash, location))
+		return location;
+	if (!m_ready) {
+		WaitUntilReady();
+		return GetUniformLocation(id);
+	}
+	if (m_failed)
+		return -1; // glUniform* ignores -1, and a broken program has nothing to look up
 
-	GLCall(int location = glGetUniformLocation(m_rendererID, name.c_str()));
+	PROFILE_FUNCTION();
+	GLCall(location = glGetUniformLocation(m_rendererID, id.name));
 	if (location == -1)
-		std::cout << "Warning: uniform " << name << " doesn't exist!" << std::endl;
+		std::cout << "Warning: uniform " << id.name << " doesn't exist!" << std::endl;
 
-	m_uniformLocationCache[name] = location;
+	m_uniformLocations.Insert(id.hash, location);
 	return location;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Compares a value with the one last set at a uniform location and remembers it.
+ *
+ * Uniform values are program state, so the shadow stays valid while other programs are used as
+ * long as every upload reaches this program: the program is made current before returning true.
+ * Arrays are remembered element by element at the location of each element, so setting an
+ * array at once and setting its elements by name see the same values.
+ *
+ * @param location Location of the uniform, -1 if it is not active.
+ * @param data Pointer to the new value.
+ * @param size Size of the value in bytes.
+ * @param elementCount Number of array elements the value covers, starting at location.
+ * @return bool True if the value changed and glUniform* must be called.
+ */
+bool Shader::UpdateUniformShadow(int location, const void* data, unsigned int size, unsigned int elementCount)
+{
+	if (elementCount == 0)
+		return false;
+	if (location < 0) {
+		s_uniformStats.inactive++;
+		return false;
+	}
+
+	if ((unsigned int)location + elementCount > m_uniformShadow.size())
+		m_uniformShadow.resize(location + elementCount);
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	const unsigned int elementSize = size / elementCount;
+	bool changed = false;
+	for (unsigned int i = 0; i < elementCount; i++) {
+		std::vector<unsigned char>& shadow = m_uniformShadow[location + i];
+		const unsigned char* element = bytes + i * elementSize;
+		if (shadow.size() != elementSize || memcmp(shadow.data(), element, elementSize) != 0) {
+			shadow.assign(element, element + elementSize);
+			changed = true;
+		}
+	}
+
+	if (changed) {
+		// glUniform* writes to the current program, which may be another one
+		Bind();
+		s_uniformStats.uploads++;
+	}
+	else {
+		s_uniformStats.skipped++;
+	}
+	return changed;
+}
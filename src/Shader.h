@@ -1,8 +1,15 @@
 #pragma once
 
 #include <iostream>
-#include <unordered_map>
+#include <string>
+#include <vector>
 #include "glm/glm.hpp"
+#include "UniformId.h"
+#include "UniformTable.h"
+#include "ShaderReflection.h"
+
+class VertexArray;
+class VertexBufferLayout;
 
 /**
  * @brief Structure to hold vertex and fragment shader source code.
@@ -12,22 +19,55 @@ struct ShaderProgramSource {
 	std::string FragmentSource; ///< Source code of the fragment shader
 };
 
+/**
+ * @brief How a Shader builds its program.
+ */
+enum class ShaderCompileMode {
+	Blocking, ///< The constructor returns once the program is linked.
+	Async     ///< The constructor only submits the compile and link, see Shader::IsReady.
+};
+
 /**
  * @brief Shader class to manage OpenGL shaders.
+ *
+ * An Async shader submits its compile and link and returns, so constructing several of them back
+ * to back lets the driver compile them in parallel (KHR_parallel_shader_compile) while the caller
+ * loads other resources. Poll IsReady, or draw with ReadyOrFallback until then. Setting uniforms
+ * waits for the program; GetReflection and the Validate calls need it ready.
  */
 class Shader {
+public:
+	/**
+	 * @brief Counters of the uniform uploads of every program.
+	 */
+	struct UniformStats {
+		unsigned int uploads = 0;  ///< glUniform* calls issued.
+		unsigned int skipped = 0;  ///< Calls skipped because the value was already set.
+		unsigned int inactive = 0; ///< Calls skipped because the uniform is not active (location -1).
+	};
+
 private:
 	unsigned int m_rendererID; ///< Renderer ID of the shader program
 	std::string m_filepath; ///< Filepath to the shader source file
-	std::unordered_map<std::string, int> m_uniformLocationCache; ///< Cache for uniform locations
+	uint64_t m_cacheKey; ///< Key of the program in the ProgramBinaryCache
+	unsigned int m_pendingShaders[2]; ///< Vertex and fragment shaders of a link in flight, 0 once it is finished
+	bool m_ready; ///< Whether the link finished, and the program was reflected unless it failed
+	bool m_failed; ///< Whether a shader failed to compile or the program failed to link
+	Shader* m_fallback; ///< Shader ReadyOrFallback returns until this one is ready, or nullptr
+	ShaderReflection m_reflection; ///< Interface of the program, enumerated at link time
+	UniformTable m_uniformLocations; ///< Locations by name hash, filled at link time and on first use of other names
+	std::vector<std::vector<unsigned char>> m_uniformShadow; ///< Last value set at each uniform location, empty if never set
+	static UniformStats s_uniformStats; ///< Counters of every program since the last ResetUniformStats
+	static int s_parallelCompile; ///< 1 if the driver can report link completion, 0 if not, -1 not queried yet
 
 public:
 	/**
 	 * @brief Constructs a Shader object and compiles the shader from the given file path.
 	 *
 	 * @param filepath Path to the shader file.
+	 * @param mode Whether to wait for the link or only submit it.
 	 */
-	Shader(const std::string& filepath);
+	Shader(const std::string& filepath, ShaderCompileMode mode = ShaderCompileMode::Blocking);
 
 	/**
 	 * @brief Destroys the Shader object and deletes the shader program.
@@ -44,6 +84,134 @@ public:
 	 */
 	void Unbind() const;
 
+	/**
+	 * @brief Tells whether the program is linked, finishing the link when the driver is done.
+	 *
+	 * Never blocks with KHR_parallel_shader_compile. Without it, the first call waits for the link.
+	 *
+	 * @return bool True once the program can be used, never if it failed to compile or link.
+	 */
+	bool IsReady();
+
+	/**
+	 * @brief Tells whether the program failed to compile or link. Only known once the link
+	 * finished, see IsReady.
+	 *
+	 * @return bool True if the program can never be used.
+	 */
+	inline bool HasFailed() const { return m_failed; }
+
+	/**
+	 * @brief Waits until the program is linked, reporting compile and link errors.
+	 */
+	void WaitUntilReady();
+
+	/**
+	 * @brief Sets the shader ReadyOrFallback returns while this one is not ready.
+	 *
+	 * @param fallback The fallback shader, typically a cheap one compiled blocking, or nullptr.
+	 */
+	inline void SetFallback(Shader* fallback) { m_fallback = fallback; }
+
+	/**
+	 * @brief Gets the shader to draw with this frame: this one if it is ready, else the fallback.
+	 *
+	 * @return Shader& This shader, or the fallback while this one is compiling or if it failed.
+	 * Waits for this shader if it has no fallback.
+	 */
+	Shader& ReadyOrFallback();
+
+	/**
+	 * @brief Gets the renderer ID of the shader program.
+	 *
+	 * @return unsigned int Renderer ID of the shader program.
+	 */
+	inline unsigned int GetRendererID() const { return m_rendererID; }
+
+	/**
+	 * @brief Gets the uniforms, uniform blocks and vertex inputs of the program.
+	 *
+	 * @return const ShaderReflection& The interface of the program, enumerated at link time.
+	 */
+	inline const ShaderReflection& GetReflection() const { return m_reflection; }
+
+	/**
+	 * @brief Resolves a typed handle to a uniform of the default block, checking its type.
+	 *
+	 * Meant to be called once at setup; values are then set through the handle with no lookup.
+	 *
+	 * @tparam T The C++ type of the value, see UniformHandle.
+	 * @param id The hashed name of the uniform.
+	 * @return UniformHandle<T> The handle, invalid if the uniform is not active or has another type.
+	 */
+	template<typename T>
+	UniformHandle<T> GetUniform(UniformId id) {
+		UniformHandle<T> handle;
+		handle.location = ResolveUniform(id, &UniformType<T>::Accepts, handle.arraySize);
+		return handle;
+	}
+
+	/**
+	 * @brief Sets an integer or sampler uniform through a handle.
+	 *
+	 * @param handle The handle of the uniform.
+	 * @param value The value to set.
+	 */
+	void Set(UniformHandle<int> handle, int value);
+
+	/**
+	 * @brief Sets the first elements of an integer or sampler array uniform through a handle.
+	 *
+	 * @param handle The handle of the uniform.
+	 * @param count The number of elements to set.
+	 * @param values Pointer to the values to set.
+	 */
+	void SetArray(UniformHandle<int> handle, int count, const int* values);
+
+	/**
+	 * @brief Sets a float uniform through a handle.
+	 *
+	 * @param handle The handle of the uniform.
+	 * @param value The value to set.
+	 */
+	void Set(UniformHandle<float> handle, float value);
+
+	/**
+	 * @brief Sets a vec4 uniform through a handle.
+	 *
+	 * @param handle The handle of the uniform.
+	 * @param value The value to set.
+	 */
+	void Set(UniformHandle<glm::vec4> handle, const glm::vec4& value);
+
+	/**
+	 * @brief Sets a mat4 uniform through a handle.
+	 *
+	 * @param handle The handle of the uniform.
+	 * @param value The value to set.
+	 */
+	void Set(UniformHandle<glm::mat4> handle, const glm::mat4& value);
+
+	/**
+	 * @brief Checks a vertex buffer layout against the vertex inputs of the program.
+	 *
+	 * Reports elements that feed an integer input (glVertexAttribPointer converts to float)
+	 * or that have more components than the input reads. Call once at setup.
+	 *
+	 * @param layout The layout.
+	 * @param firstAttribute Attribute index of the first element of the layout.
+	 * @return bool True if every element matches the input at its location.
+	 */
+	bool ValidateLayout(const VertexBufferLayout& layout, unsigned int firstAttribute = 0) const;
+
+	/**
+	 * @brief Checks that a vertex array sets up every attribute location the program reads.
+	 *
+	 * @param va The vertex array.
+	 * @return bool True if no input is left without a buffer.
+	 */
+	bool ValidateVertexArray(const VertexArray& va) const;
+
 	/**
 	 * @brief Sets an integer uniform variable in the shader.
 	 *
@@ -52,6 +220,32 @@ public:
 	 */
 	void SetUniform1i(const std::string& name, int value);
 
+	/**
+	 * @brief Sets an integer uniform variable in the shader, without allocating.
+	 *
+	 * @param id The hashed name of the uniform variable.
+	 * @param value The integer value to set.
+	 */
+	void SetUniform1i(UniformId id, int value);
+
+	/**
+	 * @brief Sets an integer array uniform variable in the shader.
+	 *
+	 * @param name The name of the uniform variable.
+	 * @param count The number of elements to set.
+	 * @param values Pointer to the integer values to set.
+	 */
+	void SetUniform1iv(const std::string& name, int count, const int* values);
+
+	/**
+	 * @brief Sets an integer array uniform variable in the shader, without allocating.
+	 *
+	 * @param id The hashed name of the uniform variable.
+	 * @param count The number of elements to set.
+	 * @param values Pointer to the integer values to set.
+	 */
+	void SetUniform1iv(UniformId id, int count, const int* values);
+
 	/**
 	 * @brief Sets a float uniform variable in the shader.
 	 *
@@ -60,6 +254,14 @@ public:
 	 */
 	void SetUniform1f(const std::string& name, float value);
 
+	/**
+	 * @brief Sets a float uniform variable in the shader, without allocating.
+	 *
+	 * @param id The hashed name of the uniform variable.
+	 * @param value The float value to set.
+	 */
+	void SetUniform1f(UniformId id, float value);
+
 	/**
 	 * @brief Sets a vec4 uniform variable in the shader.
 	 *
@@ -71,6 +273,17 @@ public:
 	 */
 	void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
 
+	/**
+	 * @brief Sets a vec4 uniform variable in the shader, without allocating.
+	 *
+	 * @param id The hashed name of the uniform variable.
+	 * @param v0 The first component of the vec4.
+	 * @param v1 The second component of the vec4.
+	 * @param v2 The third component of the vec4.
+	 * @param v3 The fourth component of the vec4.
+	 */
+	void SetUniform4f(UniformId id, float v0, float v1, float v2, float v3);
+
 	/**
 	 * @brief Sets a mat4 uniform variable in the shader.
 	 *
@@ -79,6 +292,34 @@ public:
 	 */
 	void SetUniformMat4f(const std::string& name, const glm::mat4& matrix);
 
+	/**
+	 * @brief Sets a mat4 uniform variable in the shader, without allocating.
+	 *
+	 * @param id The hashed name of the uniform variable.
+	 * @param matrix The matrix to set.
+	 */
+	void SetUniformMat4f(UniformId id, const glm::mat4& matrix);
+
+	/**
+	 * @brief Connects a uniform block of the shader to a uniform buffer binding point.
+	 *
+	 * @param name The name of the uniform block.
+	 * @param binding The binding point, as passed to UniformBufferManager.
+	 */
+	void SetUniformBlockBinding(const std::string& name, unsigned int binding);
+
+	/**
+	 * @brief Gets the uniform upload counters of every program since the last ResetUniformStats.
+	 *
+	 * @return const UniformStats& The counters.
+	 */
+	static const UniformStats& GetUniformStats() { return s_uniformStats; }
+
+	/**
+	 * @brief Resets the uniform upload counters, typically once per frame.
+	 */
+	static void ResetUniformStats() { s_uniformStats = UniformStats(); }
+
 private:
 	/**
 	 * @brief Parses the shader file and extracts the vertex and fragment shader source code.
@@ -89,28 +330,71 @@ private:
 	ShaderProgramSource ParseShader(const std::string& filepath);
 
 	/**
-	 * @brief Compiles a shader of the given type from the source code.
+	 * @brief Submits the compilation of a shader of the given type from the source code.
 	 *
 	 * @param type The type of shader (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER).
 	 * @param source The source code of the shader.
-	 * @return unsigned int The ID of the compiled shader.
+	 * @return unsigned int The ID of the shader, checked by FinishLink.
 	 */
 	unsigned int CompileShader(unsigned int type, const std::string& source);
 
 	/**
-	 * @brief Creates a shader program from the given vertex and fragment shader source code.
+	 * @brief Reports the errors of a shader that failed to compile.
+	 *
+	 * @param id The ID of the shader.
+	 * @param type The type of shader (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER).
+	 * @return bool True if the shader compiled.
+	 */
+	bool CheckCompileStatus(unsigned int id, unsigned int type);
+
+	/**
+	 * @brief Submits the compilation and link of a shader program from the given vertex and
+	 * fragment shader source code.
 	 *
 	 * @param vertexShader The source code of the vertex shader.
 	 * @param fragmentShader The source code of the fragment shader.
-	 * @return unsigned int The ID of the created shader program.
+	 * @return unsigned int The ID of the created shader program, finished by FinishLink.
 	 */
 	unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader);
 
+	/**
+	 * @brief Checks the result of the link in flight, stores the program in the cache and reflects it.
+	 * Marks the program failed instead if it didn't compile or link.
+	 */
+	void FinishLink();
+
+	/**
+	 * @brief Fills the location table with every active uniform of the reflection.
+	 */
+	void BuildUniformTable();
+
+	/**
+	 * @brief Finds a uniform of the default block and checks its type.
+	 *
+	 * @param id The hashed name of the uniform.
+	 * @param accepts Tells whether an OpenGL type matches the C++ type of the handle.
+	 * @param arraySize Receives the number of array elements, 0 on failure.
+	 * @return int The location of the uniform, -1 if it is not active or has another type.
+	 */
+	int ResolveUniform(UniformId id, bool (*accepts)(unsigned int), int& arraySize);
+
 	/**
 	 * @brief Retrieves the location of a uniform variable in the shader program.
 	 *
-	 * @param name The name of the uniform variable.
-	 * @return int The location of the uniform variable.
+	 * @param id The hashed name of the uniform variable.
+	 * @return int The location of the uniform variable, -1 if it is not active.
+	 */
+	int GetUniformLocation(UniformId id);
+
+	/**
+	 * @brief Compares a value with the one last set at a uniform location and remembers it.
+	 * Makes the program current if the value changed, so the upload cannot reach another one.
+	 *
+	 * @param location Location of the uniform, -1 if it is not active.
+	 * @param data Pointer to the new value.
+	 * @param size Size of the value in bytes.
+	 * @param elementCount Number of array elements the value covers, starting at location.
+	 * @return bool True if the value changed and glUniform* must be called.
 	 */
-	int GetUniformLocation(const std::string& name);
+	bool UpdateUniformShadow(int location, const void* data, unsigned int size, unsigned int elementCount = 1);
 };
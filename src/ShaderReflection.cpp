@@ -0,0 +1,226 @@
+#include "ShaderReflection.h"
+#include "Renderer.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Removes the "[0]" OpenGL appends to the name of array uniforms and attributes.
+ *
+ * @param name The name as reported by OpenGL.
+ * @param length Number of characters of the name.
+ * @return std::string The name without the suffix.
+ */
+static std::string StripArraySuffix(const char* name, int length)
+{
+	if (length > 3 && strcmp(name + length - 3, "[0]") == 0)
+		length -= 3;
+	return std::string(name, length);
+}
+
+/**
+ * @brief Enumerates the interface of a linked program with the OpenGL 3.1 introspection calls,
+ * which every context the engine creates supports.
+ *
+ * @param program Renderer ID of the program.
+ * @return ShaderReflection The interface of the program.
+ */
+ShaderReflection ShaderReflection::Reflect(unsigned int program)
+{
+	ShaderReflection reflection;
+
+	int count = 0;
+	int maxLength = 0;
+	GLCall(glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count));
+	GLCall(glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+	std::vector<char> name(std::max(maxLength, 1));
+	for (int i = 0; i < count; i++) {
+		int length = 0;
+		ShaderUniform uniform;
+		GLCall(glGetActiveUniform(program, (unsigned int)i, (int)name.size(), &length, &uniform.arraySize, &uniform.type, name.data()));
+		GLCall(uniform.location = glGetUniformLocation(program, name.data()));
+		const unsigned int index = (unsigned int)i;
+		GLCall(glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &uniform.blockIndex));
+		uniform.name = StripArraySuffix(name.data(), length);
+		reflection.uniforms.push_back(uniform);
+	}
+
+	GLCall(glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count));
+	GLCall(glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength));
+	name.resize(std::max(maxLength, 1));
+	for (int i = 0; i < count; i++) {
+		int length = 0;
+		ShaderUniformBlock block;
+		block.index = (unsigned int)i;
+		GLCall(glGetActiveUniformBlockName(program, block.index, (int)name.size(), &length, name.data()));
+		GLCall(glGetActiveUniformBlockiv(program, block.index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize));
+		block.name = std::string(name.data(), length);
+		reflection.blocks.push_back(block);
+	}
+
+	GLCall(glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count));
+	GLCall(glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength));
+	name.resize(std::max(maxLength, 1));
+	for (int i = 0; i < count; i++) {
+		int length = 0;
+		ShaderAttribute attribute;
+		GLCall(glGetActiveAttrib(program, (unsigned int)i, (int)name.size(), &length, &attribute.arraySize, &attribute.type, name.data()));
+		GLCall(attribute.location = glGetAttribLocation(program, name.data()));
+		if (attribute.location == -1)
+			continue; // Built-ins such as gl_VertexID
+		attribute.name = StripArraySuffix(name.data(), length);
+		reflection.attributes.push_back(attribute);
+	}
+
+	// Block members (location -1) go last, in the order OpenGL reported them
+	std::stable_sort(reflection.uniforms.begin(), reflection.uniforms.end(), [](const ShaderUniform& a, const ShaderUniform& b) {
+		return (unsigned int)a.location < (unsigned int)b.location;
+	});
+	std::sort(reflection.attributes.begin(), reflection.attributes.end(), [](const ShaderAttribute& a, const ShaderAttribute& b) {
+		return a.location < b.location;
+	});
+	return reflection;
+}
+
+/**
+ * @brief Finds a uniform by name.
+ *
+ * @param name The name of the uniform, without "[0]" for arrays.
+ * @return const ShaderUniform* The uniform, nullptr if it is not active.
+ */
+const ShaderUniform* ShaderReflection::FindUniform(const std::string& name) const
+{
+	for (const ShaderUniform& uniform : uniforms) {
+		if (uniform.name == name)
+			return &uniform;
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Finds the uniform of the default block at a location.
+ *
+ * @param location The location, of the first element for arrays.
+ * @return const ShaderUniform* The uniform, nullptr if no uniform starts at the location.
+ */
+const ShaderUniform* ShaderReflection::FindUniform(int location) const
+{
+	if (location < 0)
+		return nullptr;
+	for (const ShaderUniform& uniform : uniforms) {
+		if (uniform.location == location)
+			return &uniform;
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Finds a uniform block by name.
+ *
+ * @param name The name of the block.
+ * @return const ShaderUniformBlock* The block, nullptr if it is not active.
+ */
+const ShaderUniformBlock* ShaderReflection::FindBlock(const std::string& name) const
+{
+	for (const ShaderUniformBlock& block : blocks) {
+		if (block.name == name)
+			return &block;
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Finds the vertex input that reads an attribute location, matrices and arrays
+ * covering several consecutive locations.
+ *
+ * @param location The attribute location.
+ * @return const ShaderAttribute* The input, nullptr if no input reads the location.
+ */
+const ShaderAttribute* ShaderReflection::FindAttribute(int location) const
+{
+	for (const ShaderAttribute& attribute : attributes) {
+		const int end = attribute.location + (int)GetLocationCount(attribute.type) * attribute.arraySize;
+		if (location >= attribute.location && location < end)
+			return &attribute;
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Tells whether a uniform type is a sampler.
+ *
+ * @param type OpenGL type of the uniform.
+ * @return true for sampler types.
+ */
+bool ShaderReflection::IsSampler(unsigned int type)
+{
+	switch (type) {
+	case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+	case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+	case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_SAMPLER_BUFFER:
+	case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW:
+	case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+	case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_2D_MULTISAMPLE:
+	case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_INT_SAMPLER_BUFFER: case GL_INT_SAMPLER_2D_RECT:
+	case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+	case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+	case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+	case GL_UNSIGNED_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Tells whether a type holds integers, which glVertexAttribPointer cannot feed.
+ *
+ * @param type OpenGL type of an attribute.
+ * @return true for signed and unsigned integer scalars and vectors.
+ */
+bool ShaderReflection::IsInteger(unsigned int type)
+{
+	switch (type) {
+	case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+	case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Gets the number of attribute locations a value of a type takes.
+ *
+ * @param type OpenGL type of an attribute.
+ * @return unsigned int One per matrix column, 1 otherwise.
+ */
+unsigned int ShaderReflection::GetLocationCount(unsigned int type)
+{
+	switch (type) {
+	case GL_FLOAT_MAT2: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4: return 2;
+	case GL_FLOAT_MAT3: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT3x4: return 3;
+	case GL_FLOAT_MAT4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3: return 4;
+	}
+	return 1;
+}
+
+/**
+ * @brief Gets the number of components a type reads from each attribute location.
+ *
+ * @param type OpenGL type of an attribute.
+ * @return unsigned int Components per location, from 1 to 4.
+ */
+unsigned int ShaderReflection::GetComponentCount(unsigned int type)
+{
+	switch (type) {
+	case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2:
+	case GL_FLOAT_MAT2: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT4x2:
+		return 2;
+	case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3:
+	case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4x3:
+		return 3;
+	case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4:
+	case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4:
+		return 4;
+	}
+	return 1;
+}
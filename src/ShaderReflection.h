@@ -0,0 +1,170 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include "glm/glm.hpp"
+
+/**
+ * @brief An active uniform of a linked program.
+ */
+struct ShaderUniform {
+	std::string name;    ///< Name of the uniform, without the "[0]" of arrays.
+	int location;        ///< Location of the uniform, -1 for members of uniform blocks.
+	unsigned int type;   ///< OpenGL type of the uniform, such as GL_FLOAT_MAT4 or GL_SAMPLER_2D.
+	int arraySize;       ///< Number of array elements, 1 for a single value.
+	int blockIndex;      ///< Index of the uniform block holding the uniform, -1 for the default block.
+};
+
+/**
+ * @brief An active uniform block of a linked program.
+ */
+struct ShaderUniformBlock {
+	std::string name;    ///< Name of the block.
+	unsigned int index;  ///< Index of the block, as passed to glUniformBlockBinding.
+	int dataSize;        ///< Size of the block in bytes, as laid out by the driver.
+};
+
+/**
+ * @brief An active vertex input of a linked program.
+ */
+struct ShaderAttribute {
+	std::string name;    ///< Name of the attribute.
+	int location;        ///< First attribute location of the input.
+	unsigned int type;   ///< OpenGL type of the attribute, such as GL_FLOAT_VEC4.
+	int arraySize;       ///< Number of array elements, 1 for a single value.
+};
+
+/**
+ * @brief ShaderReflection struct holding the interface of a linked program.
+ *
+ * Filled once by Shader right after linking, so setup code can check its assumptions (uniform
+ * types, vertex layouts, sampler counts) against the program instead of failing silently at draw
+ * time. The entries are sorted by location, or by index for blocks.
+ */
+struct ShaderReflection {
+	std::vector<ShaderUniform> uniforms;        ///< Active uniforms, including the members of uniform blocks.
+	std::vector<ShaderUniformBlock> blocks;     ///< Active uniform blocks.
+	std::vector<ShaderAttribute> attributes;    ///< Active vertex inputs, without built-ins.
+
+	/**
+	 * @brief Enumerates the interface of a linked program.
+	 *
+	 * @param program Renderer ID of the program.
+	 * @return ShaderReflection The interface of the program.
+	 */
+	static ShaderReflection Reflect(unsigned int program);
+
+	/**
+	 * @brief Finds a uniform by name.
+	 *
+	 * @param name The name of the uniform, without "[0]" for arrays.
+	 * @return const ShaderUniform* The uniform, nullptr if it is not active.
+	 */
+	const ShaderUniform* FindUniform(const std::string& name) const;
+
+	/**
+	 * @brief Finds the uniform of the default block at a location.
+	 *
+	 * @param location The location, of the first element for arrays.
+	 * @return const ShaderUniform* The uniform, nullptr if no uniform starts at the location.
+	 */
+	const ShaderUniform* FindUniform(int location) const;
+
+	/**
+	 * @brief Finds a uniform block by name.
+	 *
+	 * @param name The name of the block.
+	 * @return const ShaderUniformBlock* The block, nullptr if it is not active.
+	 */
+	const ShaderUniformBlock* FindBlock(const std::string& name) const;
+
+	/**
+	 * @brief Finds the vertex input that reads an attribute location.
+	 *
+	 * @param location The attribute location.
+	 * @return const ShaderAttribute* The input, nullptr if no input reads the location.
+	 */
+	const ShaderAttribute* FindAttribute(int location) const;
+
+	/**
+	 * @brief Tells whether a uniform type is a sampler.
+	 *
+	 * @param type OpenGL type of the uniform.
+	 * @return true for sampler types.
+	 */
+	static bool IsSampler(unsigned int type);
+
+	/**
+	 * @brief Tells whether a type holds integers, which glVertexAttribPointer cannot feed.
+	 *
+	 * @param type OpenGL type of an attribute.
+	 * @return true for signed and unsigned integer scalars and vectors.
+	 */
+	static bool IsInteger(unsigned int type);
+
+	/**
+	 * @brief Gets the number of attribute locations a value of a type takes.
+	 *
+	 * @param type OpenGL type of an attribute.
+	 * @return unsigned int One per matrix column, 1 otherwise.
+	 */
+	static unsigned int GetLocationCount(unsigned int type);
+
+	/**
+	 * @brief Gets the number of components a type reads from each attribute location.
+	 *
+	 * @param type OpenGL type of an attribute.
+	 * @return unsigned int Components per location, from 1 to 4.
+	 */
+	static unsigned int GetComponentCount(unsigned int type);
+};
+
+/**
+ * @brief Tells which uniform types a C++ type can be set to. Only the specialized types have
+ * typed handles.
+ *
+ * @tparam T The C++ type of the value.
+ */
+template<typename T>
+struct UniformType;
+
+template<> struct UniformType<int> {
+	static bool Accepts(unsigned int type) { return type == GL_INT || type == GL_BOOL || ShaderReflection::IsSampler(type); }
+};
+template<> struct UniformType<float> {
+	static bool Accepts(unsigned int type) { return type == GL_FLOAT; }
+};
+template<> struct UniformType<glm::vec2> {
+	static bool Accepts(unsigned int type) { return type == GL_FLOAT_VEC2; }
+};
+template<> struct UniformType<glm::vec3> {
+	static bool Accepts(unsigned int type) { return type == GL_FLOAT_VEC3; }
+};
+template<> struct UniformType<glm::vec4> {
+	static bool Accepts(unsigned int type) { return type == GL_FLOAT_VEC4; }
+};
+template<> struct UniformType<glm::mat4> {
+	static bool Accepts(unsigned int type) { return type == GL_FLOAT_MAT4; }
+};
+
+/**
+ * @brief Typed handle to a uniform of the default block, resolved once at setup by
+ * Shader::GetUniform. Setting a value through it needs no lookup at all.
+ *
+ * @tparam T The C++ type of the value: int (also samplers), float, glm::vec2, glm::vec3,
+ * glm::vec4 or glm::mat4.
+ */
+template<typename T>
+struct UniformHandle {
+	int location = -1; ///< Location of the uniform, -1 if it is not active or has another type.
+	int arraySize = 0; ///< Number of array elements, 0 if the handle is not valid.
+
+	/**
+	 * @brief Tells whether the handle refers to an active uniform of the right type.
+	 *
+	 * @return true if values set through the handle reach the program.
+	 */
+	inline bool IsValid() const { return location != -1; }
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include "glm/glm.hpp"
+
+/**
+ * @brief Size and base alignment of a type in a std140 uniform block.
+ *
+ * Only types whose C++ representation matches std140 are defined, so a member of any other
+ * type (glm::mat3, bool, arrays of scalars...) fails to compile instead of silently reading
+ * garbage on the GPU.
+ *
+ * @tparam T The C++ type of a block member.
+ */
+template<typename T>
+struct Std140Type;
+
+template<> struct Std140Type<float> { static constexpr size_t Size = 4; static constexpr size_t Alignment = 4; };
+template<> struct Std140Type<int> { static constexpr size_t Size = 4; static constexpr size_t Alignment = 4; };
+template<> struct Std140Type<unsigned int> { static constexpr size_t Size = 4; static constexpr size_t Alignment = 4; };
+template<> struct Std140Type<glm::vec2> { static constexpr size_t Size = 8; static constexpr size_t Alignment = 8; };
+template<> struct Std140Type<glm::ivec2> { static constexpr size_t Size = 8; static constexpr size_t Alignment = 8; };
+template<> struct Std140Type<glm::vec3> { static constexpr size_t Size = 12; static constexpr size_t Alignment = 16; };
+template<> struct Std140Type<glm::ivec3> { static constexpr size_t Size = 12; static constexpr size_t Alignment = 16; };
+template<> struct Std140Type<glm::vec4> { static constexpr size_t Size = 16; static constexpr size_t Alignment = 16; };
+template<> struct Std140Type<glm::ivec4> { static constexpr size_t Size = 16; static constexpr size_t Alignment = 16; };
+template<> struct Std140Type<glm::mat4> { static constexpr size_t Size = 64; static constexpr size_t Alignment = 16; };
+
+/**
+ * @brief Arrays are aligned to 16 bytes and so is every element, which only matches C++ when the
+ * element size is already a multiple of 16.
+ */
+template<typename T, size_t N>
+struct Std140Type<T[N]> {
+	static_assert(Std140Type<T>::Size % 16 == 0, "std140 pads array elements to 16 bytes, use an array of vec4, ivec4 or mat4");
+	static constexpr size_t Size = N * Std140Type<T>::Size;
+	static constexpr size_t Alignment = 16;
+};
+
+/**
+ * @brief A member of a uniform block struct: its type and where the C++ compiler put it.
+ *
+ * @tparam T Type of the member.
+ * @tparam Offset Offset of the member in the struct, in bytes.
+ */
+template<typename T, size_t Offset>
+struct Std140Field {
+	typedef T Type; ///< Type of the member.
+	static constexpr size_t offset = Offset; ///< Offset of the member in the struct.
+};
+
+/// Describes a member of a uniform block struct for STD140_BLOCK.
+#define STD140_FIELD(Struct, member) Std140Field<decltype(Struct::member), offsetof(Struct, member)>
+
+/**
+ * @brief Computes the std140 layout of a list of members and compares it to the C++ layout.
+ *
+ * @tparam Fields The members of the block in declaration order, as Std140Field.
+ */
+template<typename... Fields>
+struct Std140Layout {
+	static_assert(sizeof...(Fields) > 0, "A uniform block needs at least one member");
+
+	/**
+	 * @brief Checks that every member sits at the offset std140 gives it.
+	 *
+	 * @return bool True if the C++ struct can be copied into the uniform buffer as is.
+	 */
+	static constexpr bool Matches()
+	{
+		constexpr size_t sizes[] = { Std140Type<typename Fields::Type>::Size... };
+		constexpr size_t alignments[] = { Std140Type<typename Fields::Type>::Alignment... };
+		constexpr size_t offsets[] = { Fields::offset... };
+
+		size_t offset = 0;
+		for (size_t i = 0; i < sizeof...(Fields); i++) {
+			offset = (offset + alignments[i] - 1) / alignments[i] * alignments[i];
+			if (offset != offsets[i])
+				return false;
+			offset += sizes[i];
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Computes the size of the block: the end of the last member, rounded up to 16 bytes
+	 * as std140 pads the block to the alignment of a vec4.
+	 *
+	 * @return size_t Size of the block in bytes.
+	 */
+	static constexpr size_t Size()
+	{
+		constexpr size_t sizes[] = { Std140Type<typename Fields::Type>::Size... };
+		constexpr size_t offsets[] = { Fields::offset... };
+
+		const size_t end = offsets[sizeof...(Fields) - 1] + sizes[sizeof...(Fields) - 1];
+		return (end + 15) / 16 * 16;
+	}
+};
+
+/**
+ * @brief Declares which C++ structs are uniform blocks. Specialized by STD140_BLOCK.
+ *
+ * @tparam T The struct.
+ */
+template<typename T>
+struct UniformBlock {
+	static constexpr bool Declared = false; ///< Whether the layout of T was checked with STD140_BLOCK.
+};
+
+/**
+ * @brief Declares a struct as a uniform block and checks at compile time that it has the std140
+ * layout, listing its members with STD140_FIELD. The last member listed must be the last one of
+ * the struct, and the struct must be padded to a multiple of 16 bytes. Must be used at global
+ * scope, for example:
+ *
+ *     struct CameraBlock {
+ *         glm::mat4 viewProjection;
+ *         glm::vec3 position;
+ *         float time;
+ *     };
+ *     STD140_BLOCK(CameraBlock, STD140_FIELD(CameraBlock, viewProjection),
+ *         STD140_FIELD(CameraBlock, position), STD140_FIELD(CameraBlock, time));
+ */
+#define STD140_BLOCK(Struct, ...) \
+	template<> struct UniformBlock<Struct> { \
+		static_assert(std::is_standard_layout<Struct>::value && std::is_trivially_copyable<Struct>::value, #Struct " must be a plain struct"); \
+		static_assert(Std140Layout<__VA_ARGS__>::Matches(), #Struct " does not follow std140, reorder its members or add padding"); \
+		static_assert(Std140Layout<__VA_ARGS__>::Size() == sizeof(Struct), #Struct " has members missing from STD140_BLOCK or is not padded to 16 bytes"); \
+		static constexpr bool Declared = true; \
+	}
@@ -0,0 +1,150 @@
+#include "StreamingBuffer.h"
+#include "FramePacer.h"
+#include "Renderer.h"
+#include "GLStateCache.h"
+
+/**
+ * @brief Constructs a StreamingBuffer and allocates its storage.
+ *
+ * @param target Target the buffer is bound to, such as GL_ARRAY_BUFFER or GL_UNIFORM_BUFFER.
+ * @param regionSize Size of a region in bytes, the largest possible allocation.
+ * @param regionCount Number of regions. One more than the frames in flight never waits.
+ */
+StreamingBuffer::StreamingBuffer(unsigned int target, unsigned int regionSize, unsigned int regionCount)
+	: m_rendererID(0), m_target(target), m_regionSize(regionSize), m_fences(regionCount > 0 ? regionCount : 1, nullptr),
+	m_region(0), m_head(0), m_mapped(nullptr)
+{
+	const GLsizeiptr size = (GLsizeiptr)m_regionSize * m_fences.size();
+
+	// GL_COPY_WRITE_BUFFER does not touch the element buffer of the bound vertex array
+	GLCall(glGenBuffers(1, &m_rendererID));
+	GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, m_rendererID);
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLCall(glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags));
+		GLCall(m_mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+	}
+	else {
+		GLCall(glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW));
+	}
+	GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/**
+ * @brief Destroys the StreamingBuffer and deletes the buffer and its fences.
+ */
+StreamingBuffer::~StreamingBuffer()
+{
+	for (GLsync fence : m_fences) {
+		if (fence) {
+			GLCall(glDeleteSync(fence));
+		}
+	}
+
+	// Deleting a buffer unmaps it
+	GLCall(glDeleteBuffers(1, &m_rendererID));
+	GLStateCache::OnBufferDeleted(m_rendererID);
+}
+
+/**
+ * @brief Allocates a range from the current region, moving to the next region if it does not fit.
+ *
+ * @param size Size of the range in bytes, at most the size of a region.
+ * @param alignment Alignment of the offset in bytes, not necessarily a power of two.
+ * @return StreamingRange The range; data is nullptr if size exceeds the region size.
+ */
+StreamingRange StreamingBuffer::Allocate(unsigned int size, unsigned int alignment)
+{
+	StreamingRange range;
+	if (size == 0 || size > m_regionSize) {
+		ASSERT(size <= m_regionSize);
+		return range;
+	}
+	if (alignment == 0)
+		alignment = 1;
+
+	// Offsets are aligned in the whole buffer, regions need not start on a multiple of the alignment
+	unsigned int regionStart = m_region * m_regionSize;
+	unsigned int offset = (regionStart + m_head + alignment - 1) / alignment * alignment;
+	if (offset + size > regionStart + m_regionSize) {
+		m_stats.overflowCount++;
+		NextRegion();
+		regionStart = m_region * m_regionSize;
+		offset = (regionStart + alignment - 1) / alignment * alignment;
+		if (offset + size > regionStart + m_regionSize)
+			return range; // The alignment padding left too little room
+	}
+
+	range.offset = offset;
+	range.size = size;
+	if (m_mapped) {
+		range.data = m_mapped + offset;
+	}
+	else {
+		// The fences guarantee the GPU is done with the range, so the driver need not check
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+		GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, m_rendererID);
+		GLCall(range.data = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size, flags));
+	}
+
+	m_head = offset + size - regionStart;
+	m_stats.allocatedBytes += size;
+	m_stats.allocationCount++;
+	return range;
+}
+
+/**
+ * @brief Makes the data written to a range visible to the GPU.
+ *
+ * @param range The range returned by Allocate.
+ */
+void StreamingBuffer::Commit(const StreamingRange& range)
+{
+	// Coherent mappings need nothing, writes are visible to commands issued afterwards
+	if (m_mapped || !range.data)
+		return;
+
+	GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, m_rendererID);
+	GLCall(glUnmapBuffer(GL_COPY_WRITE_BUFFER));
+}
+
+/**
+ * @brief Fences the current region and moves to the next one.
+ */
+void StreamingBuffer::EndFrame()
+{
+	if (m_head > 0)
+		NextRegion();
+}
+
+/**
+ * @brief Binds the buffer to its target.
+ */
+void StreamingBuffer::Bind() const
+{
+	GLStateCache::BindBuffer(m_target, m_rendererID);
+}
+
+/**
+ * @brief Unbinds the buffer from its target.
+ */
+void StreamingBuffer::Unbind() const
+{
+	GLStateCache::BindBuffer(m_target, 0);
+}
+
+/**
+ * @brief Fences the current region, moves to the next one and waits until the GPU is done with it.
+ */
+void StreamingBuffer::NextRegion()
+{
+	GLCall(m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	m_region = (m_region + 1) % (unsigned int)m_fences.size();
+	m_head = 0;
+
+	const double waitMs = FramePacer::WaitAndDelete(m_fences[m_region]);
+	if (waitMs > 0.0) {
+		m_stats.waitCount++;
+		m_stats.waitMs += waitMs;
+	}
+}
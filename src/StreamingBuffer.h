@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+/**
+ * @brief Range of a StreamingBuffer returned by Allocate.
+ */
+struct StreamingRange {
+	void* data = nullptr;    ///< Where to write the data, nullptr if the allocation failed.
+	unsigned int offset = 0; ///< Offset of the range in the buffer, in bytes.
+	unsigned int size = 0;   ///< Size of the range in bytes.
+};
+
+/**
+ * @brief StreamingBuffer class for data rewritten every frame (dynamic geometry, uniforms...).
+ *
+ * The buffer is split into regions used one after the other as a ring. Callers allocate
+ * transient ranges from the current region and write straight into mapped memory, with no
+ * glBufferSubData copy. When a region is done (EndFrame, or when it is full) a fence is placed
+ * behind it, and the region is only written again once that fence has signalled, so the CPU
+ * never overwrites data the GPU still reads.
+ *
+ * With OpenGL 4.4 or ARB_buffer_storage the whole buffer is mapped once, persistently and
+ * coherently. Otherwise every range is mapped unsynchronized (the fences already guarantee the
+ * GPU is done with it) and must be committed, which unmaps it.
+ */
+class StreamingBuffer {
+public:
+	/**
+	 * @brief Streaming statistics since the last ResetStats.
+	 */
+	struct Stats {
+		unsigned int allocatedBytes = 0; ///< Bytes allocated.
+		unsigned int allocationCount = 0; ///< Ranges allocated.
+		unsigned int overflowCount = 0;  ///< Times a region filled up before EndFrame.
+		unsigned int waitCount = 0;      ///< Times a region was still in use by the GPU.
+		double waitMs = 0.0;             ///< Time spent waiting for regions.
+	};
+
+private:
+	unsigned int m_rendererID; ///< Renderer ID of the buffer
+	unsigned int m_target; ///< Target the buffer is bound to by Bind
+	unsigned int m_regionSize; ///< Size of a region in bytes
+	std::vector<GLsync> m_fences; ///< Fence placed after the last use of each region, nullptr if none
+	unsigned int m_region; ///< Index of the current region
+	unsigned int m_head; ///< Offset of the first free byte in the current region
+	unsigned char* m_mapped; ///< Persistent mapping of the whole buffer, nullptr in the fallback
+	Stats m_stats; ///< Streaming statistics
+
+public:
+	/**
+	 * @brief Constructs a StreamingBuffer and allocates its storage.
+	 *
+	 * @param target Target the buffer is bound to, such as GL_ARRAY_BUFFER or GL_UNIFORM_BUFFER.
+	 * @param regionSize Size of a region in bytes, the largest possible allocation.
+	 * @param regionCount Number of regions. One more than the frames in flight never waits.
+	 */
+	StreamingBuffer(unsigned int target, unsigned int regionSize, unsigned int regionCount = 3);
+
+	/**
+	 * @brief Destroys the StreamingBuffer and deletes the buffer and its fences.
+	 */
+	~StreamingBuffer();
+
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+	/**
+	 * @brief Allocates a range from the current region, moving to the next region if it does
+	 * not fit. The range is valid until the region comes around again.
+	 *
+	 * @param size Size of the range in bytes, at most the size of a region.
+	 * @param alignment Alignment of the offset in bytes. Need not be a power of two, so the
+	 * vertex stride can be used to draw with a base vertex.
+	 * @return StreamingRange The range; data is nullptr if size exceeds the region size.
+	 */
+	StreamingRange Allocate(unsigned int size, unsigned int alignment = 1);
+
+	/**
+	 * @brief Makes the data written to a range visible to the GPU. Must be called before the
+	 * range is drawn from.
+	 *
+	 * @param range The range returned by Allocate.
+	 */
+	void Commit(const StreamingRange& range);
+
+	/**
+	 * @brief Fences the current region and moves to the next one. Call once per frame after
+	 * the last draw using the buffer.
+	 */
+	void EndFrame();
+
+	/**
+	 * @brief Binds the buffer to its target.
+	 */
+	void Bind() const;
+
+	/**
+	 * @brief Unbinds the buffer from its target.
+	 */
+	void Unbind() const;
+
+	/**
+	 * @brief Gets the renderer ID of the buffer.
+	 *
+	 * @return unsigned int The renderer ID.
+	 */
+	inline unsigned int GetRendererID() const { return m_rendererID; }
+
+	/**
+	 * @brief Tells whether the buffer is persistently mapped.
+	 *
+	 * @return true with OpenGL 4.4 or ARB_buffer_storage.
+	 */
+	inline bool IsPersistent() const { return m_mapped != nullptr; }
+
+	/**
+	 * @brief Gets the streaming statistics.
+	 *
+	 * @return const Stats& The statistics.
+	 */
+	inline const Stats& GetStats() const { return m_stats; }
+
+	/**
+	 * @brief Resets the streaming statistics.
+	 */
+	inline void ResetStats() { m_stats = Stats(); }
+
+private:
+	/**
+	 * @brief Fences the current region, moves to the next one and waits until the GPU is done with it.
+	 */
+	void NextRegion();
+};
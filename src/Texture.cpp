@@ -1,4 +1,6 @@
 #include "Texture.h"
+#include "GLStateCache.h"
+#include "CpuProfiler.h"
 #include "stb_image/stb_image.h"
 
 /**
@@ -7,29 +9,67 @@
  * @param path Path to the texture image file.
  */
 Texture::Texture(const std::string& path)
-	: m_rendererID(0), m_filepath(path), m_localBuffer(nullptr), m_width(0), m_height(0), m_BPP(0)
+	: Texture(Decode(path))
 {
-	stbi_set_flip_vertically_on_load(1);
-	m_localBuffer = stbi_load(path.c_str(), &m_width, &m_height, &m_BPP, 4);
+}
+
+/**
+ * @brief Constructs a Texture object from an image decoded by Decode.
+ *
+ * @param image The decoded image.
+ */
+Texture::Texture(const TextureImage& image)
+	: m_rendererID(0), m_filepath(image.path), m_localBuffer(nullptr), m_width(image.width), m_height(image.height), m_BPP(4)
+{
+	PROFILE_FUNCTION();
 
-	if (m_localBuffer == 0) {
+	if (!image.pixels) {
 		std::cout << "Texture not found!!!" << std::endl;
 	}
 
-	GLCall(glGenTextures(1, &m_rendererID));
-	GLCall(glBindTexture(GL_TEXTURE_2D, m_rendererID));
+	Upload(image.pixels.get());
+}
 
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+/**
+ * @brief Frees pixels allocated by stb_image.
+ *
+ * @param pixels The pixels returned by stbi_load.
+ */
+void TextureImage::Deleter::operator()(unsigned char* pixels) const
+{
+	stbi_image_free(pixels);
+}
+
+/**
+ * @brief Decodes an image file into RGBA8 pixels. Safe to call from any thread: the vertical
+ * flip is set for the calling thread only.
+ *
+ * @param path Path to the texture image file.
+ * @return TextureImage The decoded image, without pixels if the file could not be read.
+ */
+TextureImage Texture::Decode(const std::string& path)
+{
+	PROFILE_FUNCTION();
 
-	GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_localBuffer));
-	GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+	TextureImage image;
+	image.path = path;
+	int channels = 0;
+	stbi_set_flip_vertically_on_load_thread(1);
+	image.pixels.reset(stbi_load(path.c_str(), &image.width, &image.height, &channels, 4));
+	return image;
+}
 
-	if (m_localBuffer) {
-		stbi_image_free(m_localBuffer);
-	}
+/**
+ * @brief Constructs a Texture object from RGBA8 pixels in memory.
+ *
+ * @param width Width of the texture in pixels.
+ * @param height Height of the texture in pixels.
+ * @param data Pointer to width * height RGBA8 pixels, bottom row first.
+ */
+Texture::Texture(int width, int height, const void* data)
+	: m_rendererID(0), m_localBuffer(nullptr), m_width(width), m_height(height), m_BPP(4)
+{
+	Upload(data);
 }
 
 /**
@@ -38,6 +78,7 @@ Texture::Texture(const std::string& path)
 Texture::~Texture()
 {
 	GLCall(glDeleteTextures(1, &m_rendererID));
+	GLStateCache::OnTextureDeleted(m_rendererID);
 }
 
 /**
@@ -47,14 +88,32 @@ Texture::~Texture()
  */
 void Texture::Bind(unsigned int slot) const
 {
-	GLCall(glActiveTexture(GL_TEXTURE0 + slot));
-	GLCall(glBindTexture(GL_TEXTURE_2D, m_rendererID));
+	GLStateCache::BindTexture(slot, m_rendererID);
 }
 
 /**
- * @brief Unbinds the texture.
+ * @brief Unbinds the texture from the active texture slot.
  */
 void Texture::Unbind() const
 {
-	GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+	GLStateCache::BindTexture(GLStateCache::GetActiveTexture(), 0);
+}
+
+/**
+ * @brief Creates the OpenGL texture and uploads the given pixels to it.
+ *
+ * @param data Pointer to m_width * m_height RGBA8 pixels.
+ */
+void Texture::Upload(const void* data)
+{
+	GLCall(glGenTextures(1, &m_rendererID));
+	GLStateCache::BindTexture(GLStateCache::GetActiveTexture(), m_rendererID);
+
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+	GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data));
+	GLStateCache::BindTexture(GLStateCache::GetActiveTexture(), 0);
 }
\ No newline at end of file
@@ -1,8 +1,29 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include "Renderer.h"
 
+/**
+ * @brief Decoded pixels of an image file, ready to be uploaded by Texture.
+ *
+ * Decoding needs no OpenGL context, so images can be decoded on a worker thread while the
+ * render thread does something else, such as waiting for shaders to compile.
+ */
+struct TextureImage {
+	std::string path; ///< Path of the image file
+	int width = 0; ///< Width of the image in pixels
+	int height = 0; ///< Height of the image in pixels
+
+	/**
+	 * @brief Frees pixels allocated by stb_image.
+	 */
+	struct Deleter {
+		void operator()(unsigned char* pixels) const;
+	};
+	std::unique_ptr<unsigned char, Deleter> pixels; ///< RGBA8 pixels, bottom row first, nullptr if the file could not be read
+};
+
 /**
  * @brief Texture class to manage OpenGL textures.
  */
@@ -21,6 +42,22 @@ public:
 	 */
 	Texture(const std::string& path);
 
+	/**
+	 * @brief Constructs a Texture object from an image decoded by Decode.
+	 *
+	 * @param image The decoded image.
+	 */
+	Texture(const TextureImage& image);
+
+	/**
+	 * @brief Constructs a Texture object from RGBA8 pixels in memory.
+	 *
+	 * @param width Width of the texture in pixels.
+	 * @param height Height of the texture in pixels.
+	 * @param data Pointer to width * height RGBA8 pixels, bottom row first.
+	 */
+	Texture(int width, int height, const void* data);
+
 	/**
 	 * @brief Destructor for the Texture object. Deletes the texture from the GPU.
 	 */
@@ -34,10 +71,27 @@ public:
 	void Bind(unsigned int slot = 0) const;
 
 	/**
-	 * @brief Unbinds the texture.
+	 * @brief Unbinds the texture from the active texture slot.
 	 */
 	void Unbind() const;
 
 	inline int GetWidth() const { return m_width; } ///< Gets the width of the texture
 	inline int GetHeight() const { return m_height; } ///< Gets the height of the texture
+	inline unsigned int GetRendererID() const { return m_rendererID; } ///< Gets the renderer ID of the texture
+
+	/**
+	 * @brief Decodes an image file into RGBA8 pixels. Safe to call from any thread.
+	 *
+	 * @param path Path to the texture image file.
+	 * @return TextureImage The decoded image, without pixels if the file could not be read.
+	 */
+	static TextureImage Decode(const std::string& path);
+
+private:
+	/**
+	 * @brief Creates the OpenGL texture and uploads the given pixels to it.
+	 *
+	 * @param data Pointer to m_width * m_height RGBA8 pixels.
+	 */
+	void Upload(const void* data);
 };
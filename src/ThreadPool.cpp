@@ -0,0 +1,103 @@
+#include "ThreadPool.h"
+
+/**
+ * @brief Constructs a ThreadPool and starts its workers.
+ *
+ * @param threadCount Total number of threads working on a loop, including the caller.
+ */
+ThreadPool::ThreadPool(unsigned int threadCount)
+	: m_task(nullptr), m_count(0), m_generation(0), m_pending(0), m_stop(false)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	for (unsigned int i = 0; i + 1 < threadCount; i++)
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+/**
+ * @brief Stops and joins the workers.
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& worker : m_workers)
+		worker.join();
+}
+
+/**
+ * @brief Runs task over [0, count) split into GetThreadCount() chunks and waits for all of them.
+ *
+ * @param count Size of the range.
+ * @param task Function called once per chunk, empty chunks included.
+ */
+void ThreadPool::ParallelFor(size_t count, const Task& task)
+{
+	if (!m_workers.empty()) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_task = &task;
+			m_count = count;
+			m_pending = (unsigned int)m_workers.size();
+			m_generation++;
+		}
+		m_wake.notify_all();
+	}
+
+	RunChunk(task, count, 0);
+
+	if (!m_workers.empty()) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this] { return m_pending == 0; });
+		m_task = nullptr;
+	}
+}
+
+/**
+ * @brief Runs the given chunk of the current loop.
+ *
+ * @param task The task of the loop.
+ * @param count Size of the range of the loop.
+ * @param chunk Index of the chunk, also reported as the worker index.
+ */
+void ThreadPool::RunChunk(const Task& task, size_t count, unsigned int chunk) const
+{
+	const size_t chunks = GetThreadCount();
+	const size_t begin = count * chunk / chunks;
+	const size_t end = count * (chunk + 1) / chunks;
+	task(begin, end, chunk);
+}
+
+/**
+ * @brief Body of worker thread index, which runs chunk index + 1 of every loop.
+ *
+ * @param index Index of the worker thread.
+ */
+void ThreadPool::WorkerLoop(unsigned int index)
+{
+	unsigned int seenGeneration = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_wake.wait(lock, [&] { return m_stop || m_generation != seenGeneration; });
+		if (m_stop)
+			return;
+
+		seenGeneration = m_generation;
+		const Task& task = *m_task;
+		const size_t count = m_count;
+
+		lock.unlock();
+		RunChunk(task, count, index + 1);
+		lock.lock();
+
+		if (--m_pending == 0)
+			m_done.notify_one();
+	}
+}
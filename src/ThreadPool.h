@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief ThreadPool class that splits loops across a fixed set of worker threads.
+ *
+ * ParallelFor divides a range into one contiguous chunk per thread, with chunk 0 run on the
+ * calling thread. Chunk i always covers the same part of the range and is always reported
+ * with worker index i, so results written per worker can be combined in a deterministic order.
+ * ParallelFor must only be called from one thread at a time.
+ */
+class ThreadPool {
+public:
+	/// Work function receiving a chunk [begin, end) and the index of the worker running it.
+	typedef std::function<void(size_t begin, size_t end, unsigned int worker)> Task;
+
+private:
+	std::vector<std::thread> m_workers; ///< Worker threads, in addition to the calling thread
+	std::mutex m_mutex; ///< Guards the fields below
+	std::condition_variable m_wake; ///< Signals workers that a new loop started or the pool stops
+	std::condition_variable m_done; ///< Signals the caller that every worker finished its chunk
+	const Task* m_task; ///< Task of the current loop
+	size_t m_count; ///< Size of the range of the current loop
+	unsigned int m_generation; ///< Incremented for every loop so workers notice new work
+	unsigned int m_pending; ///< Number of workers still running their chunk
+	bool m_stop; ///< Whether the workers should exit
+
+public:
+	/**
+	 * @brief Constructs a ThreadPool and starts its workers.
+	 *
+	 * @param threadCount Total number of threads working on a loop, including the caller.
+	 * 0 uses one thread per hardware thread.
+	 */
+	ThreadPool(unsigned int threadCount = 0);
+
+	/**
+	 * @brief Stops and joins the workers.
+	 */
+	~ThreadPool();
+
+	/**
+	 * @brief Runs task over [0, count) split into GetThreadCount() chunks and waits for all of them.
+	 *
+	 * @param count Size of the range.
+	 * @param task Function called once per chunk, empty chunks included.
+	 */
+	void ParallelFor(size_t count, const Task& task);
+
+	/**
+	 * @brief Gets the number of threads working on a loop, including the caller.
+	 *
+	 * @return unsigned int Number of threads, and of chunks per loop.
+	 */
+	inline unsigned int GetThreadCount() const { return (unsigned int)m_workers.size() + 1; }
+
+private:
+	/**
+	 * @brief Runs the given chunk of the current loop.
+	 *
+	 * @param task The task of the loop.
+	 * @param count Size of the range of the loop.
+	 * @param chunk Index of the chunk, also reported as the worker index.
+	 */
+	void RunChunk(const Task& task, size_t count, unsigned int chunk) const;
+
+	/**
+	 * @brief Body of worker thread index, which runs chunk index + 1 of every loop.
+	 *
+	 * @param index Index of the worker thread.
+	 */
+	void WorkerLoop(unsigned int index);
+};
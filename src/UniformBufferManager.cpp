@@ -0,0 +1,63 @@
+#include "UniformBufferManager.h"
+#include "Renderer.h"
+#include "GLStateCache.h"
+#include <cstring>
+
+/**
+ * @brief Constructs a UniformBufferManager and allocates its ring buffer.
+ *
+ * @param frameSize Bytes of uniform data a frame may upload before the ring moves on.
+ * @param regionCount Number of regions of the ring. One more than the frames in flight never waits.
+ */
+UniformBufferManager::UniformBufferManager(unsigned int frameSize, unsigned int regionCount)
+	: m_buffer(GL_UNIFORM_BUFFER, frameSize, regionCount), m_alignment(256)
+{
+	int alignment = 0;
+	GLCall(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+	if (alignment > 0)
+		m_alignment = (unsigned int)alignment;
+}
+
+/**
+ * @brief Copies raw block data into the ring. The range is rounded up to 16 bytes, the size
+ * std140 gives the block, so the whole block is always inside the bound range.
+ *
+ * @param data Pointer to the data.
+ * @param size Size of the data in bytes.
+ * @return UniformBufferRange Where the data was written, size 0 if it is larger than a region.
+ */
+UniformBufferRange UniformBufferManager::Upload(const void* data, unsigned int size)
+{
+	UniformBufferRange result;
+	const StreamingRange range = m_buffer.Allocate((size + 15) & ~15u, m_alignment);
+	if (!range.data)
+		return result;
+
+	memcpy(range.data, data, size);
+	m_buffer.Commit(range);
+	result.offset = range.offset;
+	result.size = range.size;
+	return result;
+}
+
+/**
+ * @brief Binds an uploaded block to a binding point (glBindBufferRange).
+ *
+ * @param binding The uniform buffer binding point.
+ * @param range A range returned by Upload.
+ */
+void UniformBufferManager::Bind(unsigned int binding, const UniformBufferRange& range) const
+{
+	ASSERT(range.size > 0);
+	if (range.size == 0)
+		return;
+	GLStateCache::BindBufferRange(GL_UNIFORM_BUFFER, binding, m_buffer.GetRendererID(), range.offset, range.size);
+}
+
+/**
+ * @brief Fences the uniform data of the frame. Call once per frame after the last draw.
+ */
+void UniformBufferManager::EndFrame()
+{
+	m_buffer.EndFrame();
+}
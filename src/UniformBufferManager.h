@@ -0,0 +1,96 @@
+#pragma once
+
+#include "StreamingBuffer.h"
+#include "Std140.h"
+
+/**
+ * @brief Range of the uniform ring buffer holding one uploaded block.
+ */
+struct UniformBufferRange {
+	unsigned int offset = 0; ///< Offset of the block in the buffer, in bytes.
+	unsigned int size = 0;   ///< Size of the range in bytes, 0 if the upload failed.
+};
+
+/**
+ * @brief UniformBufferManager class that uploads uniform blocks through a StreamingBuffer.
+ *
+ * Blocks are C++ structs declared with STD140_BLOCK, so their layout is checked at compile time
+ * and they are copied into the buffer as is. Every upload gets a fresh range of the ring, aligned
+ * to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, and is bound to a binding point with glBindBufferRange.
+ *
+ * Blocks shared by every program (camera, time...) are uploaded once per frame with SetShared
+ * and stay bound for all draws, instead of being set on each program with glUniform* calls.
+ * Programs connect their blocks to binding points with Shader::SetUniformBlockBinding.
+ */
+class UniformBufferManager {
+private:
+	StreamingBuffer m_buffer; ///< Ring the blocks are written to
+	unsigned int m_alignment; ///< Required alignment of the offset of a bound range
+
+public:
+	/**
+	 * @brief Constructs a UniformBufferManager and allocates its ring buffer.
+	 *
+	 * @param frameSize Bytes of uniform data a frame may upload before the ring moves on.
+	 * @param regionCount Number of regions of the ring. One more than the frames in flight never waits.
+	 */
+	UniformBufferManager(unsigned int frameSize = 64 * 1024, unsigned int regionCount = 3);
+
+	UniformBufferManager(const UniformBufferManager&) = delete;
+	UniformBufferManager& operator=(const UniformBufferManager&) = delete;
+
+	/**
+	 * @brief Copies a uniform block into the ring.
+	 *
+	 * @tparam T A struct declared with STD140_BLOCK.
+	 * @param block The block.
+	 * @return UniformBufferRange Where the block was written, valid until the ring comes around.
+	 */
+	template<typename T>
+	UniformBufferRange Upload(const T& block) {
+		static_assert(UniformBlock<T>::Declared, "Declare the layout of the block with STD140_BLOCK");
+		return Upload(&block, sizeof(T));
+	}
+
+	/**
+	 * @brief Uploads a uniform block and binds it to a binding point for every following draw.
+	 *
+	 * @tparam T A struct declared with STD140_BLOCK.
+	 * @param binding The uniform buffer binding point.
+	 * @param block The block.
+	 */
+	template<typename T>
+	void SetShared(unsigned int binding, const T& block) {
+		Bind(binding, Upload(block));
+	}
+
+	/**
+	 * @brief Binds an uploaded block to a binding point (glBindBufferRange).
+	 *
+	 * @param binding The uniform buffer binding point.
+	 * @param range A range returned by Upload.
+	 */
+	void Bind(unsigned int binding, const UniformBufferRange& range) const;
+
+	/**
+	 * @brief Fences the uniform data of the frame. Call once per frame after the last draw.
+	 */
+	void EndFrame();
+
+	/**
+	 * @brief Gets the ring buffer the blocks are written to.
+	 *
+	 * @return const StreamingBuffer& The buffer.
+	 */
+	inline const StreamingBuffer& GetBuffer() const { return m_buffer; }
+
+private:
+	/**
+	 * @brief Copies raw block data into the ring.
+	 *
+	 * @param data Pointer to the data.
+	 * @param size Size of the data in bytes.
+	 * @return UniformBufferRange Where the data was written, size 0 if it is larger than a region.
+	 */
+	UniformBufferRange Upload(const void* data, unsigned int size);
+};
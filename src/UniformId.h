@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Identifies a uniform by a hash of its name, which can be computed at compile time.
+ *
+ * Shader looks uniforms up by this hash in a flat table, so setting a uniform by UniformId does
+ * not build a std::string. Create one with the _u literal:
+ *
+ *     shader.SetUniformMat4f("u_MVP"_u, mvp);
+ *
+ * The hash is only guaranteed to be computed at compile time in a constant expression. Passed
+ * straight to a function, the literal is usually folded by the optimizer but may be hashed at
+ * run time in debug builds. Declare the id constexpr where that matters:
+ *
+ *     static constexpr UniformId mvpId = "u_MVP"_u;
+ */
+struct UniformId {
+	uint32_t hash;    ///< 32-bit FNV-1a hash of the name.
+	const char* name; ///< The name, only read to report a uniform that does not exist.
+
+	/**
+	 * @brief Constructs the UniformId of the empty name.
+	 */
+	constexpr UniformId()
+		: hash(Hash("", 0)), name("") {}
+
+	/**
+	 * @brief Constructs a UniformId from a name of known length.
+	 *
+	 * @param name The name of the uniform.
+	 * @param length Number of characters of the name.
+	 */
+	constexpr UniformId(const char* name, size_t length)
+		: hash(Hash(name, length)), name(name) {}
+
+	/**
+	 * @brief Constructs a UniformId from a null-terminated name.
+	 *
+	 * @param name The name of the uniform.
+	 */
+	explicit constexpr UniformId(const char* name)
+		: hash(Hash(name, Length(name))), name(name) {}
+
+	/**
+	 * @brief Hashes a name with 32-bit FNV-1a.
+	 *
+	 * @param name The name.
+	 * @param length Number of characters of the name.
+	 * @return uint32_t The hash.
+	 */
+	static constexpr uint32_t Hash(const char* name, size_t length) {
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < length; i++)
+			hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+		return hash;
+	}
+
+private:
+	/**
+	 * @brief Counts the characters of a null-terminated name.
+	 *
+	 * @param name The name.
+	 * @return size_t Number of characters before the terminator.
+	 */
+	static constexpr size_t Length(const char* name) {
+		size_t length = 0;
+		while (name[length] != '\0')
+			length++;
+		return length;
+	}
+};
+
+/**
+ * @brief Makes a UniformId from a string literal, for example "u_MVP"_u.
+ *
+ * @param name The name of the uniform.
+ * @param length Number of characters of the name.
+ * @return UniformId The id.
+ */
+constexpr UniformId operator""_u(const char* name, size_t length)
+{
+	return UniformId(name, length);
+}
+
+// Fails to compile if the hash stops being a constant expression
+static_assert("u_MVP"_u.hash == 0x4a5da266u, "UniformId must be computable at compile time");
@@ -0,0 +1,51 @@
+#include "UniformTable.h"
+
+/**
+ * @brief Adds a uniform to the table, growing it if it is half full.
+ *
+ * @param hash Hash of the uniform name.
+ * @param location Location of the uniform, -1 to remember that it is not active.
+ * @return bool False if the hash was already in the table, which is left unchanged.
+ */
+bool UniformTable::Insert(uint32_t hash, int location)
+{
+	int existing;
+	if (Find(hash, existing))
+		return false;
+
+	if ((m_count + 1) * 2 > m_entries.size())
+		Rehash(m_entries.empty() ? 16 : (unsigned int)m_entries.size() * 2);
+
+	const uint32_t mask = (uint32_t)m_entries.size() - 1;
+	uint32_t i = hash & mask;
+	while (m_entries[i].location != EmptySlot)
+		i = (i + 1) & mask;
+	m_entries[i] = { hash, location };
+	m_count++;
+	return true;
+}
+
+/**
+ * @brief Removes every uniform.
+ */
+void UniformTable::Clear()
+{
+	m_entries.clear();
+	m_count = 0;
+}
+
+/**
+ * @brief Reallocates the slots and inserts every entry again.
+ *
+ * @param capacity New number of slots, a power of two.
+ */
+void UniformTable::Rehash(unsigned int capacity)
+{
+	std::vector<Entry> entries(capacity, Entry{ 0, EmptySlot });
+	entries.swap(m_entries);
+	m_count = 0;
+	for (const Entry& entry : entries) {
+		if (entry.location != EmptySlot)
+			Insert(entry.hash, entry.location);
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief UniformTable class mapping uniform name hashes to locations.
+ *
+ * A flat open-addressing table with linear probing: entries are stored inline in a power-of-two
+ * array kept at most half full, so a lookup is a few comparisons in one or two cache lines with
+ * no allocation. Names are not stored, two names with the same hash share an entry.
+ */
+class UniformTable {
+private:
+	/**
+	 * @brief A slot of the table.
+	 */
+	struct Entry {
+		uint32_t hash;  ///< Hash of the uniform name.
+		int location;   ///< Location of the uniform, -1 if not active, EmptySlot if the slot is free.
+	};
+
+	static const int EmptySlot = -2; ///< Location of a free slot.
+
+	std::vector<Entry> m_entries; ///< Slots, a power of two of them
+	unsigned int m_count; ///< Number of used slots
+
+public:
+	/**
+	 * @brief Constructs an empty UniformTable.
+	 */
+	UniformTable()
+		: m_count(0) {}
+
+	/**
+	 * @brief Looks a uniform up.
+	 *
+	 * @param hash Hash of the uniform name.
+	 * @param location Receives the location of the uniform if it is in the table.
+	 * @return bool True if the uniform is in the table.
+	 */
+	bool Find(uint32_t hash, int& location) const
+	{
+		if (m_entries.empty())
+			return false;
+
+		const uint32_t mask = (uint32_t)m_entries.size() - 1;
+		for (uint32_t i = hash & mask; m_entries[i].location != EmptySlot; i = (i + 1) & mask) {
+			if (m_entries[i].hash == hash) {
+				location = m_entries[i].location;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Adds a uniform to the table, growing it if it is half full.
+	 *
+	 * @param hash Hash of the uniform name.
+	 * @param location Location of the uniform, -1 to remember that it is not active.
+	 * @return bool False if the hash was already in the table, which is left unchanged.
+	 */
+	bool Insert(uint32_t hash, int location);
+
+	/**
+	 * @brief Removes every uniform.
+	 */
+	void Clear();
+
+	/**
+	 * @brief Gets the number of uniforms in the table.
+	 *
+	 * @return unsigned int Number of uniforms.
+	 */
+	inline unsigned int GetCount() const { return m_count; }
+
+private:
+	/**
+	 * @brief Reallocates the slots and inserts every entry again.
+	 *
+	 * @param capacity New number of slots, a power of two.
+	 */
+	void Rehash(unsigned int capacity);
+};
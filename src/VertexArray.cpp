@@ -1,11 +1,16 @@
 #include "VertexArray.h"
 #include "VertexBufferLayout.h"
 #include "Renderer.h"
+#include "GLStateCache.h"
+#include "StreamingBuffer.h"
+#include <algorithm>
+#include <cstdint>
 
 /**
  * @brief Constructs a VertexArray object and generates a new vertex array object (VAO).
  */
 VertexArray::VertexArray()
+	: m_attributeCount(0)
 {
 	GLCall(glGenVertexArrays(1, &m_rendererID));
 }
@@ -16,26 +21,95 @@ VertexArray::VertexArray()
 VertexArray::~VertexArray()
 {
 	GLCall(glDeleteVertexArrays(1, &m_rendererID));
+	GLStateCache::OnVertexArrayDeleted(m_rendererID);
 }
 
 /**
- * @brief Adds a vertex buffer and its layout to the vertex array object (VAO).
+ * @brief Adds a vertex buffer and its layout to the vertex array object (VAO), after the
+ * attributes of the previously added buffers.
  *
  * @param vb The VertexBuffer object to add.
  * @param layout The VertexBufferLayout object that describes the layout of the vertex buffer.
  */
 void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout)
+{
+	AddBuffer(vb, layout, m_attributeCount);
+}
+
+/**
+ * @brief Adds a vertex buffer and its layout to the vertex array object (VAO), starting at
+ * the given attribute index.
+ *
+ * @param vb The VertexBuffer object to add.
+ * @param layout The VertexBufferLayout object that describes the layout of the vertex buffer.
+ * @param firstAttribute Attribute index of the first element of the layout.
+ */
+void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout, unsigned int firstAttribute)
 {
 	Bind();
 	vb.Bind();
+	SetAttributes(layout, firstAttribute, vb.GetRendererID());
+}
+
+/**
+ * @brief Adds a streaming buffer and its layout to the vertex array object (VAO), after the
+ * attributes of the previously added buffers.
+ *
+ * @param buffer The StreamingBuffer object to add.
+ * @param layout The VertexBufferLayout object that describes the layout of the buffer.
+ */
+void VertexArray::AddBuffer(const StreamingBuffer& buffer, const VertexBufferLayout& layout)
+{
+	Bind();
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, buffer.GetRendererID());
+	SetAttributes(layout, m_attributeCount, buffer.GetRendererID());
+}
+
+/**
+ * @brief Sets up the attributes of a layout for the buffer bound to GL_ARRAY_BUFFER.
+ *
+ * @param layout The VertexBufferLayout object that describes the layout of the buffer.
+ * @param firstAttribute Attribute index of the first element of the layout.
+ * @param buffer Renderer ID of the buffer bound to GL_ARRAY_BUFFER.
+ */
+void VertexArray::SetAttributes(const VertexBufferLayout& layout, unsigned int firstAttribute, unsigned int buffer)
+{
 	const auto& elements = layout.GetElements();
-	unsigned int offset = 0;
+	uintptr_t offset = 0;
 	for (unsigned int i = 0; i < elements.size(); i++) {
 		const auto& element = elements[i];
-		GLCall(glEnableVertexAttribArray(i));
-		GLCall(glVertexAttribPointer(i, element.count, element.type, element.normalized, layout.GetStride(), (const void*)offset));
+		const unsigned int attribute = firstAttribute + i;
+		// A reused attribute index forgets what was attached there before
+		m_instanceAttributes.erase(std::remove_if(m_instanceAttributes.begin(), m_instanceAttributes.end(),
+			[attribute](const InstanceAttribute& previous) { return previous.index == attribute; }), m_instanceAttributes.end());
+		GLCall(glEnableVertexAttribArray(attribute));
+		GLCall(glVertexAttribPointer(attribute, element.count, element.type, element.normalized, layout.GetStride(), (const void*)offset));
+		// Always set, so a slot that held per-instance data goes back to per-vertex
+		GLCall(glVertexAttribDivisor(attribute, layout.GetDivisor()));
+		if (layout.GetDivisor() != 0)
+			m_instanceAttributes.push_back({ attribute, buffer, element.count, element.type, element.normalized, layout.GetStride(), offset });
 		offset += element.count * VertexBufferElement::GetSizeOfType(element.type);
 	}
+	m_attributeCount = std::max(m_attributeCount, firstAttribute + (unsigned int)elements.size());
+}
+
+/**
+ * @brief Points the per-instance attributes at the given instance row, for contexts that
+ * cannot pass a base instance to the draw (no OpenGL 4.2 or ARB_base_instance).
+ *
+ * Instance i of a draw then reads row baseInstance + i / divisor, as with a base instance.
+ * Binds the vertex array. Call with 0 once done to restore the attributes.
+ *
+ * @param baseInstance Row of the per-instance buffers read by instance 0.
+ */
+void VertexArray::SetBaseInstance(unsigned int baseInstance) const
+{
+	Bind();
+	for (const InstanceAttribute& attribute : m_instanceAttributes) {
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, attribute.buffer);
+		const uintptr_t offset = attribute.offset + (uintptr_t)baseInstance * attribute.stride;
+		GLCall(glVertexAttribPointer(attribute.index, attribute.count, attribute.type, attribute.normalized, attribute.stride, (const void*)offset));
+	}
 }
 
 /**
@@ -43,7 +117,7 @@ void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& la
  */
 void VertexArray::Bind() const
 {
-	GLCall(glBindVertexArray(m_rendererID));
+	GLStateCache::BindVertexArray(m_rendererID);
 }
 
 /**
@@ -51,5 +125,5 @@ void VertexArray::Bind() const
  */
 void VertexArray::Unbind() const
 {
-	GLCall(glBindVertexArray(0));
+	GLStateCache::BindVertexArray(0);
 }
\ No newline at end of file
@@ -1,8 +1,24 @@
 #pragma once
 
 #include "VertexBuffer.h"
+#include <vector>
+#include <cstdint>
 
 class VertexBufferLayout;
+class StreamingBuffer;
+
+/**
+ * @brief A per-instance attribute of a VertexArray, kept to offset it with SetBaseInstance.
+ */
+struct InstanceAttribute {
+	unsigned int index;       ///< Attribute index.
+	unsigned int buffer;      ///< Renderer ID of the buffer the attribute reads.
+	unsigned int count;       ///< Number of components.
+	unsigned int type;        ///< OpenGL type of the components.
+	unsigned char normalized; ///< Whether the components are normalized.
+	unsigned int stride;      ///< Stride of the buffer in bytes.
+	uintptr_t offset;         ///< Offset of the attribute in the first instance row.
+};
 
 /**
  * @brief VertexArray class to manage OpenGL vertex array objects (VAOs).
@@ -10,6 +26,8 @@ class VertexBufferLayout;
 class VertexArray {
 private:
 	unsigned int m_rendererID; ///< Renderer ID of the vertex array object
+	unsigned int m_attributeCount; ///< Next free vertex attribute index
+	std::vector<InstanceAttribute> m_instanceAttributes; ///< Attributes with a non-zero divisor
 
 public:
 	/**
@@ -25,11 +43,36 @@ public:
 	/**
 	 * @brief Adds a vertex buffer and its layout to the vertex array object (VAO).
 	 *
+	 * The attributes of the layout continue after those of the previously added buffers, so a
+	 * per-vertex buffer and a per-instance buffer can be attached to the same VAO.
+	 *
 	 * @param vb The VertexBuffer object to add.
 	 * @param layout The VertexBufferLayout object that describes the layout of the vertex buffer.
 	 */
 	void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout);
 
+	/**
+	 * @brief Adds a vertex buffer and its layout to the vertex array object (VAO), starting at
+	 * the given attribute index.
+	 *
+	 * @param vb The VertexBuffer object to add.
+	 * @param layout The VertexBufferLayout object that describes the layout of the vertex buffer.
+	 * @param firstAttribute Attribute index of the first element of the layout.
+	 */
+	void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout, unsigned int firstAttribute);
+
+	/**
+	 * @brief Adds a streaming buffer and its layout to the vertex array object (VAO), after the
+	 * attributes of the previously added buffers.
+	 *
+	 * Attributes start at offset 0 of the buffer: draw ranges allocated with the vertex stride
+	 * as alignment by passing offset / stride as the base vertex.
+	 *
+	 * @param buffer The StreamingBuffer object to add.
+	 * @param layout The VertexBufferLayout object that describes the layout of the buffer.
+	 */
+	void AddBuffer(const StreamingBuffer& buffer, const VertexBufferLayout& layout);
+
 	/**
 	 * @brief Binds the vertex array object (VAO).
 	 */
@@ -39,4 +82,45 @@ public:
 	 * @brief Unbinds the vertex array object (VAO).
 	 */
 	void Unbind() const;
+
+	/**
+	 * @brief Gets the renderer ID of the vertex array object (VAO).
+	 *
+	 * @return unsigned int Renderer ID of the VAO.
+	 */
+	inline unsigned int GetRendererID() const { return m_rendererID; }
+
+	/**
+	 * @brief Gets the number of attribute locations set up by the added buffers.
+	 *
+	 * @return unsigned int One past the highest attribute index in use.
+	 */
+	inline unsigned int GetAttributeCount() const { return m_attributeCount; }
+
+	/**
+	 * @brief Points the per-instance attributes at the given instance row, for contexts that
+	 * cannot pass a base instance to the draw (no OpenGL 4.2 or ARB_base_instance).
+	 *
+	 * Binds the vertex array. Call with 0 once done to restore the attributes.
+	 *
+	 * @param baseInstance Row of the per-instance buffers read by instance 0.
+	 */
+	void SetBaseInstance(unsigned int baseInstance) const;
+
+	/**
+	 * @brief Tells whether any attribute of the vertex array is per instance.
+	 *
+	 * @return bool True if an added layout has a non-zero divisor.
+	 */
+	inline bool HasInstanceAttributes() const { return !m_instanceAttributes.empty(); }
+
+private:
+	/**
+	 * @brief Sets up the attributes of a layout for the buffer bound to GL_ARRAY_BUFFER.
+	 *
+	 * @param layout The VertexBufferLayout object that describes the layout of the buffer.
+	 * @param firstAttribute Attribute index of the first element of the layout.
+	 * @param buffer Renderer ID of the buffer bound to GL_ARRAY_BUFFER.
+	 */
+	void SetAttributes(const VertexBufferLayout& layout, unsigned int firstAttribute, unsigned int buffer);
 };
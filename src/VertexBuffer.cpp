@@ -1,5 +1,6 @@
 #include "VertexBuffer.h"
 #include "Renderer.h"
+#include "GLStateCache.h"
 
 /**
  * @brief Constructs a VertexBuffer object and initializes it with data.
@@ -8,18 +9,33 @@
  * @param size Size of the vertex data in bytes.
  */
 VertexBuffer::VertexBuffer(const void* data, unsigned int size)
+	: m_size(size), m_usage(GL_STATIC_DRAW)
 {
 	GLCall(glGenBuffers(1, &m_rendererID));
-	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_rendererID));
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_rendererID);
 	GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
 }
 
+/**
+ * @brief Constructs an empty dynamic VertexBuffer object to be filled with SetData.
+ *
+ * @param size Size of the buffer in bytes.
+ */
+VertexBuffer::VertexBuffer(unsigned int size)
+	: m_size(size), m_usage(GL_DYNAMIC_DRAW)
+{
+	GLCall(glGenBuffers(1, &m_rendererID));
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_rendererID);
+	GLCall(glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW));
+}
+
 /**
  * @brief Destructor for the VertexBuffer object. Deletes the vertex buffer object (VBO).
  */
 VertexBuffer::~VertexBuffer()
 {
 	GLCall(glDeleteBuffers(1, &m_rendererID));
+	GLStateCache::OnBufferDeleted(m_rendererID);
 }
 
 /**
@@ -27,7 +43,7 @@ VertexBuffer::~VertexBuffer()
  */
 void VertexBuffer::Bind() const
 {
-	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_rendererID));
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_rendererID);
 }
 
 /**
@@ -35,5 +51,19 @@ void VertexBuffer::Bind() const
  */
 void VertexBuffer::Unbind() const
 {
-	GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Replaces the start of the buffer with new data, orphaning the previous storage.
+ *
+ * @param data Pointer to the vertex data.
+ * @param size Size of the vertex data in bytes, at most the size of the buffer.
+ */
+void VertexBuffer::SetData(const void* data, unsigned int size)
+{
+	ASSERT(size <= m_size);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_rendererID);
+	GLCall(glBufferData(GL_ARRAY_BUFFER, m_size, nullptr, m_usage));
+	GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, size, data));
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 class VertexBuffer {
 private:
 	unsigned int m_rendererID; ///< Renderer ID of the vertex buffer object
+	unsigned int m_size; ///< Size of the buffer in bytes
+	unsigned int m_usage; ///< OpenGL usage hint the buffer was created with
 
 public:
 	/**
@@ -16,6 +18,13 @@ public:
 	 */
 	VertexBuffer(const void* data, unsigned int size);
 
+	/**
+	 * @brief Constructs an empty dynamic VertexBuffer object to be filled with SetData.
+	 *
+	 * @param size Size of the buffer in bytes.
+	 */
+	VertexBuffer(unsigned int size);
+
 	/**
 	 * @brief Destructor for the VertexBuffer object. Deletes the vertex buffer object (VBO).
 	 */
@@ -30,4 +39,29 @@ public:
 	 * @brief Unbinds the vertex buffer object (VBO).
 	 */
 	void Unbind() const;
+
+	/**
+	 * @brief Replaces the start of the buffer with new data.
+	 *
+	 * The previous storage is orphaned first, so the GPU can keep reading it for draws that
+	 * are still in flight instead of stalling the upload.
+	 *
+	 * @param data Pointer to the vertex data.
+	 * @param size Size of the vertex data in bytes, at most the size of the buffer.
+	 */
+	void SetData(const void* data, unsigned int size);
+
+	/**
+	 * @brief Gets the size of the buffer.
+	 *
+	 * @return unsigned int Size of the buffer in bytes.
+	 */
+	inline unsigned int GetSize() const { return m_size; }
+
+	/**
+	 * @brief Gets the renderer ID of the vertex buffer object (VBO).
+	 *
+	 * @return unsigned int Renderer ID of the VBO.
+	 */
+	inline unsigned int GetRendererID() const { return m_rendererID; }
 };
@@ -36,13 +36,17 @@ class VertexBufferLayout {
 private:
 	std::vector<VertexBufferElement> m_elements; ///< Elements in the vertex buffer layout.
 	unsigned int m_stride;                      ///< Total stride of the vertex buffer layout.
+	unsigned int m_divisor;                     ///< Attribute divisor of every element (0 = per vertex).
 
 public:
 	/**
 	 * @brief Constructs a VertexBufferLayout object.
+	 *
+	 * @param divisor 0 for per-vertex data, or the number of instances that share each
+	 * element when the layout describes per-instance data (usually 1).
 	 */
-	VertexBufferLayout()
-		: m_stride(0) {}
+	explicit VertexBufferLayout(unsigned int divisor = 0)
+		: m_stride(0), m_divisor(divisor) {}
 
 	/**
 	 * @brief Adds a new element to the vertex buffer layout.
@@ -88,6 +92,19 @@ public:
 		m_stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_BYTE);
 	}
 
+	/**
+	 * @brief Adds mat4 elements to the vertex buffer layout.
+	 *
+	 * Each matrix takes four consecutive attribute locations, one per column.
+	 *
+	 * @param count Number of matrices.
+	 */
+	template<>
+	void Push<glm::mat4>(unsigned int count) {
+		for (unsigned int i = 0; i < count * 4; i++)
+			Push<float>(4);
+	}
+
 	/**
 	 * @brief Gets the elements in the vertex buffer layout.
 	 *
@@ -101,4 +118,11 @@ public:
 	 * @return Stride of the vertex buffer layout in bytes.
 	 */
 	inline unsigned int GetStride() const { return m_stride; }
+
+	/**
+	 * @brief Gets the attribute divisor of the vertex buffer layout.
+	 *
+	 * @return 0 for per-vertex data, otherwise the number of instances sharing each element.
+	 */
+	inline unsigned int GetDivisor() const { return m_divisor; }
 };